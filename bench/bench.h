@@ -0,0 +1,30 @@
+#ifndef _LTV_BENCH_H
+#define _LTV_BENCH_H
+
+// Minimal timing helpers shared by the benchmarks.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Monotonic time in nanoseconds.
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Keep the optimizer from discarding a computed value.
+static volatile uint64_t bench_sink;
+
+// Print one result line: total time, time per iteration and optional throughput.
+static inline void bench_report(const char *name, uint64_t elapsed_ns, uint64_t iterations, uint64_t bytes) {
+    double per_iter = (double)elapsed_ns / (double)iterations;
+    printf("%-40s %10.1f ns/op", name, per_iter);
+    if (bytes > 0) {
+        printf("  %8.1f MB/s", (double)bytes / ((double)elapsed_ns / 1e9) / 1e6);
+    }
+    printf("\n");
+}
+
+#endif //_LTV_BENCH_H
@@ -0,0 +1,66 @@
+// Conversion benchmark: encoding double and int64_t data as F32 and I16 
+// vectors with a scalar loop into a temporary array, versus the chunked
+// SIMD conversion encoders.
+
+#include "litevectors.h"
+#include "litevectors_convert.h"
+#include "bench.h"
+
+#include <stdlib.h>
+
+#define COUNT (1 << 20)
+#define ITERATIONS 50
+
+int main() {
+    double *f64 = malloc(COUNT * sizeof(double));
+    int64_t *i64 = malloc(COUNT * sizeof(int64_t));
+    float *f32 = malloc(COUNT * sizeof(float));
+    int16_t *i16 = malloc(COUNT * sizeof(int16_t));
+    uint8_t *out = malloc(COUNT * sizeof(float) + 64);
+    ltv_encoder_t e;
+    uint64_t start;
+
+    for (int i = 0; i < COUNT; i++) {
+        f64[i] = i * 0.001;
+        i64[i] = (i % 70000) - 35000;
+    }
+
+    start = bench_now_ns();
+    for (int n = 0; n < ITERATIONS; n++) {
+        for (int i = 0; i < COUNT; i++) {
+            f32[i] = (float) f64[i];
+        }
+        ltv_encoder_init_memory(&e, out, COUNT * sizeof(float) + 64);
+        ltv_f32_vec(&e, f32, COUNT);
+    }
+    bench_report("f64->f32: scalar loop + ltv_f32_vec", bench_now_ns() - start, ITERATIONS, (uint64_t) ITERATIONS * COUNT * 8);
+
+    start = bench_now_ns();
+    for (int n = 0; n < ITERATIONS; n++) {
+        ltv_encoder_init_memory(&e, out, COUNT * sizeof(float) + 64);
+        ltv_f64_to_f32_vec(&e, f64, COUNT);
+    }
+    bench_report("f64->f32: ltv_f64_to_f32_vec", bench_now_ns() - start, ITERATIONS, (uint64_t) ITERATIONS * COUNT * 8);
+
+    start = bench_now_ns();
+    for (int n = 0; n < ITERATIONS; n++) {
+        for (int i = 0; i < COUNT; i++) {
+            int64_t v = i64[i];
+            i16[i] = v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v;
+        }
+        ltv_encoder_init_memory(&e, out, COUNT * sizeof(float) + 64);
+        ltv_i16_vec(&e, i16, COUNT);
+    }
+    bench_report("i64->i16: scalar loop + ltv_i16_vec", bench_now_ns() - start, ITERATIONS, (uint64_t) ITERATIONS * COUNT * 8);
+
+    start = bench_now_ns();
+    for (int n = 0; n < ITERATIONS; n++) {
+        ltv_encoder_init_memory(&e, out, COUNT * sizeof(float) + 64);
+        ltv_i64_to_i16_vec(&e, i64, COUNT, LTV_CONVERT_SATURATE);
+    }
+    bench_report("i64->i16: ltv_i64_to_i16_vec", bench_now_ns() - start, ITERATIONS, (uint64_t) ITERATIONS * COUNT * 8);
+
+    bench_sink += out[100];
+    free(f64); free(i64); free(f32); free(i16); free(out);
+    return 0;
+}
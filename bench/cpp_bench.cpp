@@ -0,0 +1,184 @@
+// C++ wrapper benchmark: the same record encoded and decoded with the C API
+// and with litevectors.hpp. The writer is compared with a C buffered encoder
+// (staging buffer, ltv_writer callback when it fills) and with the inline
+// memory encoder; decoding compares a C ltv_next loop against range-for
+// with typed views.
+
+#include "litevectors.hpp"
+#include "bench.h"
+
+#include <cstring>
+#include <vector>
+
+#define ITERATIONS 200000
+
+static const ltv_key_t KEY_NAME = LTV_KEY("Name");
+static const ltv_key_t KEY_SETTING_A = LTV_KEY("Setting_A");
+static const ltv_key_t KEY_SETTING_B = LTV_KEY("Setting_B");
+static const ltv_key_t KEY_SETTING_C = LTV_KEY("Setting_C");
+static const ltv_key_t KEY_CALIBRATION_VECTOR = LTV_KEY("CalibrationVector");
+
+struct record {
+    char name[32];
+    uint32_t a;
+    int32_t b;
+    float c;
+    std::vector<float> calibration;
+};
+
+// Output for every encoder: a fixed buffer that is rewound each iteration.
+static uint8_t out[1 << 16];
+static size_t out_len;
+
+static int c_sink(const uint8_t *buf, size_t len, void *user_data) {
+    (void) user_data;
+    memcpy(out + out_len, buf, len);
+    out_len += len;
+    return 0;
+}
+
+static void encode_c(ltv_encoder_t *e, const record &r) {
+    ltv_struct_start(e);
+    ltv_key(e, &KEY_NAME); ltv_string(e, r.name);
+    ltv_key(e, &KEY_SETTING_A); ltv_u32(e, r.a);
+    ltv_key(e, &KEY_SETTING_B); ltv_i32(e, r.b);
+    ltv_key(e, &KEY_SETTING_C); ltv_f32(e, r.c);
+    ltv_key(e, &KEY_CALIBRATION_VECTOR); ltv_f32_vec(e, (float*)r.calibration.data(), r.calibration.size());
+    ltv_struct_end(e);
+}
+
+static void encode_mem(ltv_encoder_t *e, const record &r) {
+    ltv_mem_struct_start(e);
+    ltv_mem_key(e, &KEY_NAME); ltv_mem_string(e, r.name);
+    ltv_mem_key(e, &KEY_SETTING_A); ltv_mem_u32(e, r.a);
+    ltv_mem_key(e, &KEY_SETTING_B); ltv_mem_i32(e, r.b);
+    ltv_mem_key(e, &KEY_SETTING_C); ltv_mem_f32(e, r.c);
+    ltv_mem_key(e, &KEY_CALIBRATION_VECTOR); ltv_mem_f32_vec(e, r.calibration.data(), r.calibration.size());
+    ltv_mem_struct_end(e);
+}
+
+template <class Writer>
+static void encode_cpp(Writer &w, const record &r) {
+    w.struct_start();
+    w.key(KEY_NAME); w.value(r.name);
+    w.key(KEY_SETTING_A); w.value(r.a);
+    w.key(KEY_SETTING_B); w.value(r.b);
+    w.key(KEY_SETTING_C); w.value(r.c);
+    w.key(KEY_CALIBRATION_VECTOR); w.value(r.calibration);
+    w.struct_end();
+}
+
+// Sum every number in the data, the C way.
+static double sum_c(const uint8_t *buf, size_t len) {
+    ltv_decoder_t d;
+    ltv_data_t v;
+    double sum = 0;
+    ltv_decoder_init(&d, buf, len);
+    while (ltv_next(&d, &v) == LTV_SUCCESS) {
+        if (v.size_code == LTV_SINGLE) {
+            switch (v.type_code) {
+                case LTV_U32: sum += v.val.v_uint; break;
+                case LTV_I32: sum += v.val.v_int; break;
+                case LTV_F32: sum += v.val.v_float32; break;
+            }
+        } else if (v.type_code == LTV_F32) {
+            const float *f = (const float*)v.val.v_buffer;
+            for (size_t i = 0; i < v.length / sizeof(float); i++) {
+                sum += f[i];
+            }
+        }
+    }
+    return sum;
+}
+
+static double sum_cpp(const uint8_t *buf, size_t len) {
+    ltv_decoder_t d;
+    double sum = 0;
+    ltv_decoder_init(&d, buf, len);
+    for (const ltv_data_t &v : ltv::values(d)) {
+        if (ltv::is<uint32_t>(v)) sum += ltv::get<uint32_t>(v);
+        else if (ltv::is<int32_t>(v)) sum += ltv::get<int32_t>(v);
+        else if (ltv::is<float>(v)) sum += ltv::get<float>(v);
+        else {
+            for (float f : ltv::view<float>(v)) sum += f;
+        }
+    }
+    return sum;
+}
+
+static void run_encode(const char *name, int kind, const record &r, size_t *len) {
+    static uint8_t stage[4096];
+    ltv_encoder_t e;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        out_len = 0;
+        if (kind == 0) {
+            ltv_encoder_init_buffered(&e, c_sink, NULL, stage, sizeof(stage));
+            encode_c(&e, r);
+            ltv_flush(&e);
+        } else if (kind == 1) {
+            ltv_encoder_init_memory(&e, out, sizeof(out));
+            encode_mem(&e, r);
+            out_len = e.offset;
+        } else {
+            ltv::writer w([](const uint8_t *buf, size_t n) {
+                memcpy(out + out_len, buf, n);
+                out_len += n;
+            });
+            encode_cpp(w, r);
+            w.flush();
+        }
+        bench_sink = bench_sink + out_len;
+    }
+    bench_report(name, bench_now_ns() - start, ITERATIONS, 0);
+    *len = out_len;
+}
+
+int main() {
+    record r = { "SensorMcSenseFace", 5, -5, 7.89f, std::vector<float>(16) };
+    for (size_t i = 0; i < r.calibration.size(); i++) {
+        r.calibration[i] = i + 0.123f + ((float)i * 2);
+    }
+
+    size_t c_len, mem_len, cpp_len;
+    static uint8_t expected[sizeof(out)];
+    run_encode("small record: C buffered encoder", 0, r, &c_len);
+    memcpy(expected, out, c_len);
+    run_encode("small record: C inline memory encoder", 1, r, &mem_len);
+    run_encode("small record: ltv::writer", 2, r, &cpp_len);
+    if (mem_len != c_len || cpp_len != c_len || memcmp(out, expected, c_len) != 0) {
+        printf("encodings differ\n");
+        return 1;
+    }
+
+    r.calibration.resize(2000);
+    run_encode("8KB vector: C buffered encoder", 0, r, &c_len);
+    run_encode("8KB vector: C inline memory encoder", 1, r, &mem_len);
+    memcpy(expected, out, c_len);
+    run_encode("8KB vector: ltv::writer", 2, r, &cpp_len);
+    if (cpp_len != c_len || memcmp(out, expected, c_len) != 0) {
+        printf("encodings differ\n");
+        return 1;
+    }
+
+    // Decode the large record.
+    double c_sum = 0, cpp_sum = 0;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        c_sum = sum_c(out, cpp_len);
+    }
+    bench_report("sum values: C ltv_next loop", bench_now_ns() - start, ITERATIONS, (uint64_t)cpp_len * ITERATIONS);
+
+    start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        cpp_sum = sum_cpp(out, cpp_len);
+    }
+    bench_report("sum values: ltv::values and ltv::view", bench_now_ns() - start, ITERATIONS, (uint64_t)cpp_len * ITERATIONS);
+
+    if (c_sum != cpp_sum) {
+        printf("sums differ\n");
+        return 1;
+    }
+    bench_sink = bench_sink + (uint64_t)c_sum;
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Decoder benchmark: walks every element of a few representative streams
+// with ltv_next. Telemetry messages (mixed keys, scalars and vectors), a
+// list of integer scalars, and vectors separated by long NOP padding runs.
+// The scalar list is also decoded with the batch APIs. Also compares
+// reading two fields from a config struct with a large nested
+// member, stepping over it with ltv_next versus ltv_skip.
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MESSAGES 64
+#define ITERATIONS 2000
+
+static float samples[256];
+static int16_t levels[64];
+static uint8_t nops[64];
+
+// Encode one message, the same shape as encode_bench.
+static void encode_message(ltv_encoder_t *e, uint32_t seq) {
+    ltv_struct_start(e);
+    ltv_string(e, "sequence"); ltv_u32(e, seq);
+    ltv_string(e, "timestamp"); ltv_u64(e, 1700000000000ull + seq);
+    ltv_string(e, "temperature"); ltv_f32(e, 21.5f);
+    ltv_string(e, "pressure"); ltv_f64(e, 1013.25);
+    ltv_string(e, "status"); ltv_string(e, "nominal");
+    ltv_string(e, "flags"); ltv_u8(e, 3);
+    ltv_string(e, "offset"); ltv_i16(e, -12);
+    ltv_string(e, "channels");
+    ltv_list_start(e);
+    for (int i = 0; i < 8; i++) {
+        ltv_struct_start(e);
+        ltv_string(e, "id"); ltv_u8(e, i);
+        ltv_string(e, "gain"); ltv_f32(e, 1.0f + i);
+        ltv_string(e, "enabled"); ltv_bool(e, i & 1);
+        ltv_struct_end(e);
+    }
+    ltv_list_end(e);
+    ltv_string(e, "levels"); ltv_i16_vec(e, levels, 64);
+    ltv_string(e, "samples"); ltv_f32_vec(e, samples, 256);
+    ltv_struct_end(e);
+}
+
+// Decode the whole buffer, returning the number of elements.
+static uint64_t decode_all(const uint8_t *buf, size_t len) {
+    ltv_decoder_t d;
+    ltv_data_t data;
+    uint64_t count = 0;
+    int status;
+
+    ltv_decoder_init(&d, buf, len);
+    while ((status = ltv_next(&d, &data)) == LTV_SUCCESS) {
+        bench_sink += data.val.v_uint;
+        count++;
+    }
+    if (status != LTV_DECODE_EOF) {
+        printf("decode error %d\n", status);
+        exit(1);
+    }
+    return count;
+}
+
+#define BATCH 256
+
+// Decode the whole buffer in batches, returning the number of elements.
+static uint64_t decode_batches(const uint8_t *buf, size_t len, bool soa) {
+    static ltv_data_t out[BATCH];
+    static uint8_t tags[BATCH];
+    static size_t offsets[BATCH], lengths[BATCH];
+    const ltv_batch_t arrays = { tags, offsets, lengths };
+    ltv_decoder_t d;
+    uint64_t count = 0;
+    size_t n;
+    int status;
+
+    ltv_decoder_init(&d, buf, len);
+    do {
+        if (soa) {
+            status = ltv_next_batch_soa(&d, &arrays, BATCH, &n);
+            for (size_t i = 0; i < n; i++) {
+                bench_sink += offsets[i];
+            }
+        } else {
+            status = ltv_next_batch(&d, out, BATCH, &n);
+            for (size_t i = 0; i < n; i++) {
+                bench_sink += out[i].val.v_uint;
+            }
+        }
+        count += n;
+    } while (status == LTV_SUCCESS);
+
+    if (status != LTV_DECODE_EOF) {
+        printf("decode error %d\n", status);
+        exit(1);
+    }
+    return count;
+}
+
+static void run_batches(const char *name, const uint8_t *buf, size_t len, bool soa) {
+    uint64_t start = bench_now_ns();
+    uint64_t elements = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        elements += decode_batches(buf, len, soa);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    bench_report(name, elapsed, ITERATIONS, (uint64_t)len * ITERATIONS);
+    printf("%-40s %10.2f ns/element\n", "", (double)elapsed / (double)elements);
+}
+
+// Read "version" and "name" from the config, stepping over other members.
+static uint64_t read_config(const uint8_t *buf, size_t len, bool use_skip) {
+    ltv_decoder_t d;
+    ltv_data_t data;
+    uint64_t found = 0;
+
+    ltv_decoder_init(&d, buf, len);
+    ltv_next(&d, &data);
+    while (ltv_next(&d, &data) == LTV_SUCCESS && data.type_code != LTV_END) {
+        if (is_string_eq(&data, "version") || is_string_eq(&data, "name")) {
+            ltv_next(&d, &data);
+            found += data.val.v_uint;
+        } else if (use_skip) {
+            ltv_skip(&d);
+        } else {
+            size_t depth = d.nest_depth;
+            do {
+                ltv_next(&d, &data);
+            } while (d.nest_depth > depth);
+        }
+    }
+    return found;
+}
+
+static void run_config(const char *name, const uint8_t *buf, size_t len, bool use_skip) {
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        bench_sink += read_config(buf, len, use_skip);
+    }
+    bench_report(name, bench_now_ns() - start, ITERATIONS, (uint64_t)len * ITERATIONS);
+}
+
+static void run(const char *name, const uint8_t *buf, size_t len) {
+    uint64_t start = bench_now_ns();
+    uint64_t elements = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        elements += decode_all(buf, len);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    bench_report(name, elapsed, ITERATIONS, (uint64_t)len * ITERATIONS);
+    printf("%-40s %10.2f ns/element\n", "", (double)elapsed / (double)elements);
+}
+
+int main() {
+    ltv_encoder_t e;
+    dynamic_buffer_t messages, scalars, padded, config;
+
+    for (int i = 0; i < 256; i++) samples[i] = i * 0.5f;
+    for (int i = 0; i < 64; i++) levels[i] = i - 32;
+    memset(nops, LTV_NOP_TAG, sizeof(nops));
+
+    dynamic_buffer_init(&messages, 0, NULL);
+    ltv_encoder_init(&e, dynamic_buffer_writer, &messages);
+    for (uint32_t i = 0; i < MESSAGES; i++) {
+        encode_message(&e, i);
+    }
+
+    dynamic_buffer_init(&scalars, 0, NULL);
+    ltv_encoder_init(&e, dynamic_buffer_writer, &scalars);
+    ltv_list_start(&e);
+    for (int i = 0; i < 4096; i++) {
+        switch (i & 3) {
+            case 0: ltv_i8(&e, -i); break;
+            case 1: ltv_u16(&e, i); break;
+            case 2: ltv_i32(&e, -i * 1000); break;
+            case 3: ltv_u64(&e, (uint64_t)i << 40); break;
+        }
+    }
+    ltv_list_end(&e);
+
+    dynamic_buffer_init(&padded, 0, NULL);
+    ltv_encoder_init(&e, dynamic_buffer_writer, &padded);
+    ltv_list_start(&e);
+    for (int i = 0; i < 256; i++) {
+        ltv_write(&e, nops, 1 + (i % 63));
+        ltv_i16_vec(&e, levels, 4);
+    }
+    ltv_list_end(&e);
+
+    dynamic_buffer_init(&config, 0, NULL);
+    ltv_encoder_init(&e, dynamic_buffer_writer, &config);
+    ltv_struct_start(&e);
+    ltv_string(&e, "version"); ltv_u32(&e, 3);
+    ltv_string(&e, "history");
+    ltv_list_start(&e);
+    for (int i = 0; i < 200; i++) {
+        ltv_struct_start(&e);
+        ltv_string(&e, "time"); ltv_u64(&e, 1700000000000ull + i);
+        ltv_string(&e, "user"); ltv_string(&e, "operator");
+        ltv_string(&e, "change"); ltv_string(&e, "adjusted calibration offset");
+        ltv_string(&e, "levels"); ltv_i16_vec(&e, levels, 16);
+        ltv_struct_end(&e);
+    }
+    ltv_list_end(&e);
+    ltv_string(&e, "name"); ltv_string(&e, "sensor-7");
+    ltv_struct_end(&e);
+
+    run("decode: telemetry messages", messages.data, messages.size);
+    run("decode: scalar list", scalars.data, scalars.size);
+    run_batches("decode: scalar list, ltv_next_batch", scalars.data, scalars.size, false);
+    run_batches("decode: scalar list, ltv_next_batch_soa", scalars.data, scalars.size, true);
+    run("decode: NOP padded vectors", padded.data, padded.size);
+    run_config("config: step over with ltv_next", config.data, config.size, false);
+    run_config("config: ltv_skip", config.data, config.size, true);
+
+    dynamic_buffer_free(&messages);
+    dynamic_buffer_free(&scalars);
+    dynamic_buffer_free(&padded);
+    dynamic_buffer_free(&config);
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Encoder benchmark: compares encoding a telemetry style message through a
+// writer callback, directly into memory, and the measuring (dry-run) pass 
+// used to compute the exact output size.
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ITERATIONS 200000
+
+static float samples[256];
+static int16_t levels[64];
+
+// Encode one message.
+static void encode_message(ltv_encoder_t *e, uint32_t seq) {
+    ltv_struct_start(e);
+    ltv_string(e, "sequence"); ltv_u32(e, seq);
+    ltv_string(e, "timestamp"); ltv_u64(e, 1700000000000ull + seq);
+    ltv_string(e, "temperature"); ltv_f32(e, 21.5f);
+    ltv_string(e, "pressure"); ltv_f64(e, 1013.25);
+    ltv_string(e, "status"); ltv_string(e, "nominal");
+    ltv_string(e, "flags"); ltv_u8(e, 3);
+    ltv_string(e, "offset"); ltv_i16(e, -12);
+    ltv_string(e, "channels");
+    ltv_list_start(e);
+    for (int i = 0; i < 8; i++) {
+        ltv_struct_start(e);
+        ltv_string(e, "id"); ltv_u8(e, i);
+        ltv_string(e, "gain"); ltv_f32(e, 1.0f + i);
+        ltv_string(e, "enabled"); ltv_bool(e, i & 1);
+        ltv_struct_end(e);
+    }
+    ltv_list_end(e);
+    ltv_string(e, "levels"); ltv_i16_vec(e, levels, 64);
+    ltv_string(e, "samples"); ltv_f32_vec(e, samples, 256);
+    ltv_struct_end(e);
+}
+
+int main() {
+    static static_buffer_t sbuf;
+    static uint8_t mbuf[8192];
+    ltv_encoder_t e;
+    uint64_t start, bytes = 0;
+
+    for (int i = 0; i < 256; i++) samples[i] = i * 0.5f;
+    for (int i = 0; i < 64; i++) levels[i] = i - 32;
+
+    // Writer callback (static_buffer_writer)
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        sbuf.size = 0;
+        ltv_encoder_init(&e, static_buffer_writer, &sbuf);
+        encode_message(&e, i);
+        bytes += e.offset;
+    }
+    bench_report("encode: static_buffer_writer", bench_now_ns() - start, ITERATIONS, bytes);
+
+    // Memory encoder
+    bytes = 0;
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        ltv_encoder_init_memory(&e, mbuf, sizeof(mbuf));
+        encode_message(&e, i);
+        bytes += e.offset;
+    }
+    bench_report("encode: memory encoder", bench_now_ns() - start, ITERATIONS, bytes);
+
+    // Measuring pass
+    bytes = 0;
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        ltv_encoder_init_measure(&e);
+        encode_message(&e, i);
+        bytes += e.offset;
+    }
+    bench_report("measure: exact size", bench_now_ns() - start, ITERATIONS, bytes);
+
+    // Measure, then encode into an exact size allocation
+    bytes = 0;
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        ltv_encoder_init_measure(&e);
+        encode_message(&e, i);
+
+        size_t size = e.offset;
+        uint8_t *buf = malloc(size);
+        ltv_encoder_init_memory(&e, buf, size);
+        encode_message(&e, i);
+        if (e.status != 0 || e.offset != size) {
+            printf("measured size mismatch\n");
+            return 1;
+        }
+        bench_sink += buf[size - 1];
+        bytes += size;
+        free(buf);
+    }
+    bench_report("measure + malloc + encode", bench_now_ns() - start, ITERATIONS, bytes);
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+// File decoding benchmark: time to the first decoded element, and to the
+// end of the file, for a large capture file. Reading the whole file into
+// a malloc'd buffer first (as ltv2json used to) versus mapped_file_open.
+// Each is run with the file in the page cache, and again after dropping
+// it from the cache with posix_fadvise.
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "bench.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define FILE_PATH "/tmp/ltv_file_bench.ltv"
+#define RECORDS 200000
+#define RUNS 3
+
+static float samples[256];
+
+static void drop_cache(void) {
+    int fd = open(FILE_PATH, O_RDONLY);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// Decode the rest of the file, returning the number of elements.
+static uint64_t decode_rest(ltv_decoder_t *d) {
+    ltv_data_t data;
+    uint64_t count = 0;
+    int status;
+    while ((status = ltv_next(d, &data)) == LTV_SUCCESS) {
+        count++;
+    }
+    if (status != LTV_DECODE_EOF) {
+        printf("decode error %d\n", status);
+        exit(1);
+    }
+    return count;
+}
+
+// The previous ltv2json approach: fseek/ftell, malloc, fread.
+static void run_read(uint64_t *first_ns, uint64_t *total_ns) {
+    ltv_decoder_t d;
+    ltv_data_t data;
+    uint64_t start = bench_now_ns();
+
+    FILE *fp = fopen(FILE_PATH, "rb");
+    fseek(fp, 0L, SEEK_END);
+    size_t size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t *buf = malloc(size);
+    if (fread(buf, 1, size, fp) != size) {
+        printf("read failed\n");
+        exit(1);
+    }
+    fclose(fp);
+
+    ltv_decoder_init(&d, buf, size);
+    ltv_next(&d, &data);
+    *first_ns = bench_now_ns() - start;
+    bench_sink += decode_rest(&d);
+    *total_ns = bench_now_ns() - start;
+    free(buf);
+}
+
+static void run_mapped(uint64_t *first_ns, uint64_t *total_ns) {
+    mapped_file_t f;
+    ltv_data_t data;
+    uint64_t start = bench_now_ns();
+
+    if (mapped_file_open(&f, FILE_PATH, LTV_VALIDATE_FULL) != 0) {
+        printf("map failed\n");
+        exit(1);
+    }
+    ltv_next(&f.decoder, &data);
+    *first_ns = bench_now_ns() - start;
+    bench_sink += decode_rest(&f.decoder);
+    *total_ns = bench_now_ns() - start;
+    mapped_file_close(&f);
+}
+
+static void run(const char *name, void (*fn)(uint64_t*, uint64_t*), bool cold, size_t size) {
+    uint64_t first = 0, total = 0;
+    for (int i = 0; i < RUNS; i++) {
+        uint64_t f, t;
+        if (cold) {
+            drop_cache();
+        }
+        fn(&f, &t);
+        first += f;
+        total += t;
+    }
+    printf("%-40s %10.1f us to first element\n", name, (double)first / RUNS / 1000.0);
+    bench_report("", total, RUNS, (uint64_t)size * RUNS);
+}
+
+int main() {
+    ltv_encoder_t e;
+    int fd = open(FILE_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    for (int i = 0; i < 256; i++) samples[i] = i * 0.5f;
+
+    ltv_encoder_init(&e, fd_writer, &fd);
+    ltv_list_start(&e);
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        ltv_struct_start(&e);
+        ltv_string(&e, "sequence"); ltv_u32(&e, i);
+        ltv_string(&e, "timestamp"); ltv_u64(&e, 1700000000000ull + i);
+        ltv_string(&e, "status"); ltv_string(&e, "nominal");
+        ltv_string(&e, "samples"); ltv_f32_vec(&e, samples, 256);
+        ltv_struct_end(&e);
+    }
+    ltv_list_end(&e);
+    size_t size = e.offset;
+    fsync(fd);
+    close(fd);
+    printf("file size %.1f MB\n", size / 1e6);
+
+    run("file: malloc + fread, cached", run_read, false, size);
+    run("file: mapped_file_open, cached", run_mapped, false, size);
+    run("file: malloc + fread, cold", run_read, true, size);
+    run("file: mapped_file_open, cold", run_mapped, true, size);
+
+    unlink(FILE_PATH);
+    return 0;
+}
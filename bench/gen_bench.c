@@ -0,0 +1,236 @@
+// Generated code benchmark: encode and decode MyData from examples/basic.c
+// with the hand-written functions (is_string_eq key chain), the generic
+// schema encoder and decoder, and the code tools/ltvgen.py generates from
+// mydata.ltvs. The wider record shows how each scales with the key count.
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_schema.h"
+#include "mydata_gen.h"
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ITERATIONS 200000
+
+static const ltv_key_t KEY_NAME = LTV_KEY("Name");
+static const ltv_key_t KEY_SETTING_A = LTV_KEY("Setting_A");
+static const ltv_key_t KEY_SETTING_B = LTV_KEY("Setting_B");
+static const ltv_key_t KEY_SETTING_C = LTV_KEY("Setting_C");
+static const ltv_key_t KEY_CALIBRATION_VECTOR = LTV_KEY("CalibrationVector");
+
+static const ltv_field_t MyData_fields[] = {
+    LTV_FIELD_STRING(MyData, Name),
+    LTV_FIELD(MyData, Setting_A, LTV_U32),
+    LTV_FIELD(MyData, Setting_B, LTV_I32),
+    LTV_FIELD(MyData, Setting_C, LTV_F32),
+    LTV_FIELD_ARRAY(MyData, CalibrationVector, LTV_F32),
+};
+static const ltv_schema_t MyData_schema = LTV_SCHEMA(MyData, MyData_fields);
+
+static void MyData_serialize(ltv_encoder_t *enc, const MyData *d) {
+    ltv_struct_start(enc);
+    ltv_key(enc, &KEY_NAME); ltv_string(enc, d->Name);
+    ltv_key(enc, &KEY_SETTING_A); ltv_u32(enc, d->Setting_A);
+    ltv_key(enc, &KEY_SETTING_B); ltv_i32(enc, d->Setting_B);
+    ltv_key(enc, &KEY_SETTING_C); ltv_f32(enc, d->Setting_C);
+    ltv_key(enc, &KEY_CALIBRATION_VECTOR); ltv_f32_vec(enc, (float*)d->CalibrationVector, 16);
+    ltv_struct_end(enc);
+}
+
+static bool MyData_deserialize(ltv_decoder_t *dec, MyData *d) {
+    ltv_data_t k, v;
+    if (ltv_next(dec, &k) != LTV_SUCCESS || k.type_code != LTV_STRUCT) return false;
+    if (ltv_next(dec, &k) != LTV_SUCCESS) return false;
+
+    while (k.type_code != LTV_END) {
+        if (ltv_next(dec, &v) != LTV_SUCCESS) return false;
+
+        if (is_string_eq(&k, "Name")) {
+            if (v.type_code != LTV_STRING || v.length > sizeof(d->Name) - 1) return false;
+            memcpy(d->Name, v.val.v_buffer, v.length);
+            d->Name[v.length] = 0;
+        } else if (is_string_eq(&k, "Setting_A")) {
+            if (!is_uint_bound(&v, 0, UINT32_MAX)) return false;
+            d->Setting_A = (uint32_t)v.val.v_uint;
+        } else if (is_string_eq(&k, "Setting_B")) {
+            if (!is_int_bound(&v, INT32_MIN, INT32_MAX)) return false;
+            d->Setting_B = (int32_t)v.val.v_int;
+        } else if (is_string_eq(&k, "Setting_C")) {
+            if (!is_float(&v)) return false;
+            d->Setting_C = v.val.v_float32;
+        } else if (is_string_eq(&k, "CalibrationVector")) {
+            if (!(v.type_code == LTV_F32 && v.size_code > LTV_SINGLE) || v.length > sizeof(d->CalibrationVector)) return false;
+            memcpy(d->CalibrationVector, v.val.v_buffer, v.length);
+        }
+
+        if (ltv_next(dec, &k) != LTV_SUCCESS) return false;
+    }
+    return true;
+}
+
+// The wide record, as a field table and hand-written.
+#define WIDE_SCALARS 24
+
+static char wide_names[WIDE_SCALARS][24];
+static ltv_field_t wide_fields[WIDE_SCALARS + 1];
+
+static const ltv_field_t wide_channel_fields[] = {
+    LTV_FIELD(WideChannel, id, LTV_U16),
+    LTV_FIELD(WideChannel, gain, LTV_F32),
+    LTV_FIELD(WideChannel, offset, LTV_I32),
+};
+static const ltv_schema_t wide_channel_schema = LTV_SCHEMA(WideChannel, wide_channel_fields);
+static ltv_schema_t wide_schema = { wide_fields, WIDE_SCALARS + 1, sizeof(Wide), NULL };
+
+static void wide_setup(void) {
+    for (int i = 0; i < WIDE_SCALARS; i++) {
+        snprintf(wide_names[i], sizeof(wide_names[i]), "sensor_reading_%02d", i);
+        ltv_key_init(&wide_fields[i].key, wide_names[i]);
+        wide_fields[i].offset = offsetof(Wide, sensor_reading_00) + i * sizeof(uint32_t);
+        wide_fields[i].type_code = LTV_U32;
+    }
+    wide_fields[WIDE_SCALARS] = (ltv_field_t)LTV_FIELD_STRUCT_ARRAY(Wide, channels, wide_channel_schema);
+}
+
+static bool wide_channel_deserialize(ltv_decoder_t *dec, WideChannel *c) {
+    ltv_data_t k, v;
+    while (ltv_next(dec, &k) == LTV_SUCCESS && k.type_code != LTV_END) {
+        if (ltv_next(dec, &v) != LTV_SUCCESS) return false;
+        if (is_string_eq(&k, "id")) {
+            if (!is_uint_bound(&v, 0, UINT16_MAX)) return false;
+            c->id = (uint16_t)v.val.v_uint;
+        } else if (is_string_eq(&k, "gain")) {
+            if (!is_float(&v)) return false;
+            c->gain = v.val.v_float32;
+        } else if (is_string_eq(&k, "offset")) {
+            if (!is_int_bound(&v, INT32_MIN, INT32_MAX)) return false;
+            c->offset = (int32_t)v.val.v_int;
+        }
+    }
+    return true;
+}
+
+static bool wide_deserialize(ltv_decoder_t *dec, Wide *w) {
+    ltv_data_t k, v;
+    uint32_t *values = &w->sensor_reading_00;
+    if (ltv_next(dec, &k) != LTV_SUCCESS || k.type_code != LTV_STRUCT) return false;
+
+    while (ltv_next(dec, &k) == LTV_SUCCESS && k.type_code != LTV_END) {
+        if (ltv_next(dec, &v) != LTV_SUCCESS) return false;
+
+        if (is_string_eq(&k, "channels")) {
+            size_t n = 0;
+            while (ltv_next(dec, &v) == LTV_SUCCESS && v.type_code == LTV_STRUCT && n < 8) {
+                if (!wide_channel_deserialize(dec, &w->channels[n++])) return false;
+            }
+            continue;
+        }
+        for (int i = 0; i < WIDE_SCALARS; i++) {
+            if (is_string_eq(&k, wide_names[i])) {
+                if (!is_uint_bound(&v, 0, UINT32_MAX)) return false;
+                values[i] = (uint32_t)v.val.v_uint;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+enum { HAND, SCHEMA, GENERATED };
+
+static void run_encode(const char *name, int kind, const MyData *data) {
+    static uint8_t buf[4096];
+    ltv_encoder_t e;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_encoder_init_memory(&e, buf, sizeof(buf));
+        switch (kind) {
+            case HAND: MyData_serialize(&e, data); break;
+            case SCHEMA: ltv_schema_encode(&e, &MyData_schema, data); break;
+            case GENERATED: MyData_encode(&e, data); break;
+        }
+        bench_sink += e.offset;
+    }
+    bench_report(name, bench_now_ns() - start, ITERATIONS, 0);
+}
+
+static void run_decode(const char *name, int kind, const uint8_t *buf, size_t len, const MyData *expected) {
+    MyData out;
+    ltv_decoder_t d;
+    memset(&out, 0, sizeof(out));
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_decoder_init(&d, buf, len);
+        switch (kind) {
+            case HAND: bench_sink += MyData_deserialize(&d, &out); break;
+            case SCHEMA: bench_sink += ltv_schema_decode(&d, &MyData_schema, &out); break;
+            case GENERATED: bench_sink += MyData_decode(&d, &out); break;
+        }
+    }
+    bench_report(name, bench_now_ns() - start, ITERATIONS, 0);
+    if (memcmp(&out, expected, sizeof(out)) != 0) {
+        printf("%s: mismatch\n", name);
+        exit(1);
+    }
+}
+
+static void run_wide_decode(const char *name, int kind, const uint8_t *buf, size_t len, const Wide *expected) {
+    static Wide out;
+    ltv_decoder_t d;
+    memset(&out, 0, sizeof(out));
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_decoder_init(&d, buf, len);
+        switch (kind) {
+            case HAND: bench_sink += wide_deserialize(&d, &out); break;
+            case SCHEMA: bench_sink += ltv_schema_decode(&d, &wide_schema, &out); break;
+            case GENERATED: bench_sink += Wide_decode(&d, &out); break;
+        }
+    }
+    bench_report(name, bench_now_ns() - start, ITERATIONS, 0);
+    if (memcmp(&out, expected, sizeof(out)) != 0) {
+        printf("%s: mismatch\n", name);
+        exit(1);
+    }
+}
+
+int main() {
+    static uint8_t buf[4096];
+    MyData data;
+    ltv_encoder_t e;
+
+    memset(&data, 0, sizeof(data));
+    strcpy(data.Name, "SensorMcSenseFace");
+    data.Setting_A = 5;
+    data.Setting_B = 5;
+    data.Setting_C = 7.89f;
+    for (int i = 0; i < 16; i++) {
+        data.CalibrationVector[i] = i + 0.123f + ((float)i * 2);
+    }
+
+    run_encode("MyData encode: hand-written", HAND, &data);
+    run_encode("MyData encode: schema", SCHEMA, &data);
+    run_encode("MyData encode: generated", GENERATED, &data);
+
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    MyData_serialize(&e, &data);
+    run_decode("MyData decode: hand-written", HAND, buf, e.offset, &data);
+    run_decode("MyData decode: schema", SCHEMA, buf, e.offset, &data);
+    run_decode("MyData decode: generated", GENERATED, buf, e.offset, &data);
+
+    // Wide record
+    static Wide wide;
+    uint32_t *values = &wide.sensor_reading_00;
+    wide_setup();
+    for (int i = 0; i < WIDE_SCALARS; i++) values[i] = i * 1000;
+    for (int i = 0; i < 8; i++) wide.channels[i] = (WideChannel){ i, i * 0.5f, -i };
+
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    Wide_encode(&e, &wide);
+    run_wide_decode("wide decode: hand-written", HAND, buf, e.offset, &wide);
+    run_wide_decode("wide decode: schema", SCHEMA, buf, e.offset, &wide);
+    run_wide_decode("wide decode: generated", GENERATED, buf, e.offset, &wide);
+    return 0;
+}
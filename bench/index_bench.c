@@ -0,0 +1,117 @@
+// Structural index benchmark: random lookups of one field of the Nth record
+// in a list of records, by scanning with ltv_next each time versus building
+// the index once and querying it.
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_index.h"
+#include "bench.h"
+
+#include <stdlib.h>
+
+#define RECORDS 1000
+#define QUERIES 20000
+
+static int16_t history[16];
+
+// Linear scan for records[n].value
+static uint64_t scan_value(const uint8_t *buf, size_t len, size_t n) {
+    ltv_decoder_t d;
+    ltv_data_t data;
+    size_t record = 0;
+
+    ltv_decoder_init(&d, buf, len);
+    ltv_next(&d, &data);
+    while (ltv_next(&d, &data) == LTV_SUCCESS) {
+        // Each record is a struct directly inside the top level list.
+        if (data.type_code == LTV_STRUCT && d.nest_depth == 2 && record++ == n) {
+            while (ltv_next(&d, &data) == LTV_SUCCESS) {
+                if (d.nest_depth == 2 && is_string_eq(&data, "value")) {
+                    ltv_next(&d, &data);
+                    return data.val.v_uint;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main() {
+    ltv_encoder_t e;
+    dynamic_buffer_t buf;
+    uint64_t start, sum;
+
+    dynamic_buffer_init(&buf, 0, NULL);
+    ltv_encoder_init(&e, dynamic_buffer_writer, &buf);
+    ltv_list_start(&e);
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        ltv_struct_start(&e);
+        ltv_string(&e, "id"); ltv_u32(&e, i);
+        ltv_string(&e, "name"); ltv_string(&e, "sensor record");
+        ltv_string(&e, "tags");
+        ltv_list_start(&e);
+        ltv_string(&e, "outdoor"); ltv_string(&e, "calibrated");
+        ltv_list_end(&e);
+        ltv_string(&e, "history"); ltv_i16_vec(&e, history, 16);
+        ltv_string(&e, "value"); ltv_u64(&e, i * 3);
+        ltv_struct_end(&e);
+    }
+    ltv_list_end(&e);
+
+    // Repeated linear scans
+    sum = 0;
+    start = bench_now_ns();
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        sum += scan_value(buf.data, buf.size, (q * 7919) % RECORDS);
+    }
+    bench_report("query: linear ltv_next scan", bench_now_ns() - start, QUERIES, 0);
+    bench_sink += sum;
+
+    // Index build
+    size_t entries_size = 16;
+    ltv_index_entry_t *entries = malloc(entries_size * sizeof(ltv_index_entry_t));
+    ltv_index_t x;
+    int status;
+
+    start = bench_now_ns();
+    ltv_index_init(&x, buf.data, buf.size, LTV_VALIDATE_FULL, entries, entries_size);
+    while ((status = ltv_index_build(&x)) == LTV_INDEX_FULL) {
+        entries_size *= 2;
+        entries = realloc(entries, entries_size * sizeof(ltv_index_entry_t));
+        ltv_index_resize(&x, entries, entries_size);
+    }
+    if (status != LTV_DECODE_EOF) {
+        printf("index build failed: %d\n", status);
+        return 1;
+    }
+    bench_report("index: build (growing entries)", bench_now_ns() - start, 1, buf.size);
+
+    // Rebuild into the array that is now big enough
+    start = bench_now_ns();
+    ltv_index_init(&x, buf.data, buf.size, LTV_VALIDATE_FULL, entries, entries_size);
+    if (ltv_index_build(&x) != LTV_DECODE_EOF) {
+        printf("index rebuild failed\n");
+        return 1;
+    }
+    bench_report("index: build (preallocated)", bench_now_ns() - start, 1, buf.size);
+
+    // Indexed queries
+    uint64_t check = 0;
+    start = bench_now_ns();
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        ltv_data_t data;
+        size_t record = ltv_index_element(&x, 0, (q * 7919) % RECORDS);
+        ltv_index_get(&x, ltv_index_field(&x, record, "value"), &data);
+        check += data.val.v_uint;
+    }
+    bench_report("query: index lookup", bench_now_ns() - start, QUERIES, 0);
+
+    if (check != sum) {
+        printf("index query mismatch\n");
+        return 1;
+    }
+
+    free(entries);
+    dynamic_buffer_free(&buf);
+    return 0;
+}
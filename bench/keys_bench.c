@@ -0,0 +1,119 @@
+// Struct key lookup benchmark: map each key of a 10, 50 and 200 field
+// struct to its field index, comparing against every name with
+// is_string_eq versus a key_matcher_t, with keys in the expected order and
+// shuffled.
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "bench.h"
+
+#include <stdlib.h>
+
+#define ITERATIONS 2000
+#define MAX_FIELDS 200
+
+static char storage[MAX_FIELDS][32];
+static const char *names[MAX_FIELDS];
+
+// Names shaped like real field names, several sharing long prefixes.
+static void make_names(size_t count) {
+    static const char *prefixes[] = {"", "sensor_", "calibration_", "channel_gain_"};
+    for (size_t i = 0; i < count; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "%sfield_%zu", prefixes[i % 4], i);
+        names[i] = storage[i];
+    }
+}
+
+// Encode a struct of 'count' u32 fields, in order or shuffled.
+static void encode(dynamic_buffer_t *buf, size_t count, bool shuffled) {
+    ltv_encoder_t e;
+    dynamic_buffer_reset(buf);
+    ltv_encoder_init(&e, dynamic_buffer_writer, buf);
+    ltv_struct_start(&e);
+    for (size_t i = 0; i < count; i++) {
+        size_t n = shuffled ? (i * 37 + 11) % count : i;
+        ltv_string(&e, names[n]);
+        ltv_u32(&e, n);
+    }
+    ltv_struct_end(&e);
+}
+
+static uint64_t lookup_linear(const uint8_t *buf, size_t len, size_t count) {
+    ltv_decoder_t d;
+    ltv_data_t k, v;
+    uint64_t sum = 0;
+
+    ltv_decoder_init(&d, buf, len);
+    ltv_next(&d, &k);
+    while (ltv_next(&d, &k) == LTV_SUCCESS && k.type_code != LTV_END) {
+        ltv_next(&d, &v);
+        for (size_t i = 0; i < count; i++) {
+            if (is_string_eq(&k, names[i])) {
+                sum += i;
+                break;
+            }
+        }
+    }
+    return sum;
+}
+
+static uint64_t lookup_matcher(key_matcher_t *m, const uint8_t *buf, size_t len) {
+    ltv_decoder_t d;
+    ltv_data_t k, v;
+    uint64_t sum = 0;
+
+    ltv_decoder_init(&d, buf, len);
+    ltv_next(&d, &k);
+    while (ltv_next(&d, &k) == LTV_SUCCESS && k.type_code != LTV_END) {
+        ltv_next(&d, &v);
+        sum += key_matcher_find(m, &k);
+    }
+    return sum;
+}
+
+static void run(size_t count, bool shuffled) {
+    dynamic_buffer_t buf;
+    key_matcher_t m;
+    char name[64];
+    uint64_t expected = count * (count - 1) / 2;
+    uint64_t sum = 0;
+
+    make_names(count);
+    dynamic_buffer_init(&buf, 0, NULL);
+    encode(&buf, count, shuffled);
+    key_matcher_init(&m, names, count);
+
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sum += lookup_linear(buf.data, buf.size, count);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    snprintf(name, sizeof(name), "keys: %zu fields%s, is_string_eq", count, shuffled ? " shuffled" : "");
+    bench_report(name, elapsed, ITERATIONS, 0);
+    printf("%-40s %10.2f ns/key\n", "", (double)elapsed / ITERATIONS / count);
+
+    start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sum += lookup_matcher(&m, buf.data, buf.size);
+    }
+    elapsed = bench_now_ns() - start;
+    snprintf(name, sizeof(name), "keys: %zu fields%s, key_matcher", count, shuffled ? " shuffled" : "");
+    bench_report(name, elapsed, ITERATIONS, 0);
+    printf("%-40s %10.2f ns/key\n", "", (double)elapsed / ITERATIONS / count);
+
+    if (sum != expected * ITERATIONS * 2) {
+        printf("lookup mismatch\n");
+        exit(1);
+    }
+    key_matcher_free(&m);
+    dynamic_buffer_free(&buf);
+}
+
+int main() {
+    static const size_t counts[] = {10, 50, 200};
+    for (size_t i = 0; i < 3; i++) {
+        run(counts[i], false);
+        run(counts[i], true);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Path query benchmark: pull "channels[3].gain" out of every telemetry
+// message, with a compiled query versus a hand-written ltv_next scan that
+// decodes every element.
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_query.h"
+#include "bench.h"
+
+#include <stdlib.h>
+
+#define MESSAGES 64
+#define ITERATIONS 2000
+
+static float samples[256];
+static int16_t levels[64];
+
+// Encode one message, the same shape as encode_bench.
+static void encode_message(ltv_encoder_t *e, uint32_t seq) {
+    ltv_struct_start(e);
+    ltv_string(e, "sequence"); ltv_u32(e, seq);
+    ltv_string(e, "timestamp"); ltv_u64(e, 1700000000000ull + seq);
+    ltv_string(e, "temperature"); ltv_f32(e, 21.5f);
+    ltv_string(e, "pressure"); ltv_f64(e, 1013.25);
+    ltv_string(e, "status"); ltv_string(e, "nominal");
+    ltv_string(e, "flags"); ltv_u8(e, 3);
+    ltv_string(e, "offset"); ltv_i16(e, -12);
+    ltv_string(e, "channels");
+    ltv_list_start(e);
+    for (int i = 0; i < 8; i++) {
+        ltv_struct_start(e);
+        ltv_string(e, "id"); ltv_u8(e, i);
+        ltv_string(e, "gain"); ltv_f32(e, 1.0f + i);
+        ltv_string(e, "enabled"); ltv_bool(e, i & 1);
+        ltv_struct_end(e);
+    }
+    ltv_list_end(e);
+    ltv_string(e, "levels"); ltv_i16_vec(e, levels, 64);
+    ltv_string(e, "samples"); ltv_f32_vec(e, samples, 256);
+    ltv_struct_end(e);
+}
+
+// Decode everything, picking out channels[3].gain by tracking the position.
+static double scan(const uint8_t *buf, size_t len) {
+    ltv_decoder_t d;
+    ltv_data_t data;
+    double sum = 0;
+    bool in_channels = false;
+    int channel = -1;
+
+    ltv_decoder_init(&d, buf, len);
+    while (ltv_next(&d, &data) == LTV_SUCCESS) {
+        if (d.nest_depth == 1 && is_string_eq(&data, "channels")) {
+            in_channels = true;
+            channel = -1;
+        } else if (in_channels && d.nest_depth == 3 && data.type_code == LTV_STRUCT) {
+            channel++;
+        } else if (in_channels && d.nest_depth == 1) {
+            in_channels = false;
+        } else if (channel == 3 && d.nest_depth == 3 && is_string_eq(&data, "gain")) {
+            ltv_next(&d, &data);
+            sum += data.val.v_float32;
+        }
+    }
+    return sum;
+}
+
+static double query(const ltv_query_t *q, const uint8_t *buf, size_t len) {
+    ltv_decoder_t d;
+    ltv_data_t data;
+    double sum = 0;
+
+    ltv_decoder_init(&d, buf, len);
+    while (ltv_query_first(q, &d, &data) == LTV_SUCCESS) {
+        sum += data.val.v_float32;
+    }
+    return sum;
+}
+
+int main() {
+    ltv_encoder_t e;
+    dynamic_buffer_t messages;
+    ltv_query_t q;
+
+    for (int i = 0; i < 256; i++) samples[i] = i * 0.5f;
+    for (int i = 0; i < 64; i++) levels[i] = i - 32;
+
+    dynamic_buffer_init(&messages, 0, NULL);
+    ltv_encoder_init(&e, dynamic_buffer_writer, &messages);
+    for (uint32_t i = 0; i < MESSAGES; i++) {
+        encode_message(&e, i);
+    }
+
+    if (ltv_query_compile(&q, "channels[3].gain") != LTV_SUCCESS) {
+        printf("compile failed\n");
+        return 1;
+    }
+
+    double expected = 4.0 * MESSAGES;
+    double sum = 0;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sum += scan(messages.data, messages.size);
+    }
+    bench_report("query: ltv_next scan", bench_now_ns() - start, ITERATIONS, (uint64_t)messages.size * ITERATIONS);
+    if (sum != expected * ITERATIONS) {
+        printf("scan mismatch: %f\n", sum);
+        return 1;
+    }
+
+    sum = 0;
+    start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sum += query(&q, messages.data, messages.size);
+    }
+    bench_report("query: compiled path", bench_now_ns() - start, ITERATIONS, (uint64_t)messages.size * ITERATIONS);
+    if (sum != expected * ITERATIONS) {
+        printf("query mismatch: %f\n", sum);
+        return 1;
+    }
+
+    start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_query_compile(&q, "channels[3].gain");
+    }
+    bench_report("query: compile", bench_now_ns() - start, ITERATIONS, 0);
+
+    dynamic_buffer_free(&messages);
+    return 0;
+}
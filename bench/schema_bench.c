@@ -0,0 +1,277 @@
+// Schema binding benchmark: encode and decode the MyData struct from
+// examples/basic.c with hand-written functions (is_string_eq key chain)
+// versus the generic schema encoder and decoder. A larger struct with more
+// fields and a nested array shows how the key chain scales.
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_schema.h"
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ITERATIONS 200000
+
+struct MyData {
+    char Name[32];
+    uint32_t Setting_A;
+    int32_t Setting_B;
+    float Setting_C;
+    float CalibrationVector[16];
+};
+
+static const ltv_key_t KEY_NAME = LTV_KEY("Name");
+static const ltv_key_t KEY_SETTING_A = LTV_KEY("Setting_A");
+static const ltv_key_t KEY_SETTING_B = LTV_KEY("Setting_B");
+static const ltv_key_t KEY_SETTING_C = LTV_KEY("Setting_C");
+static const ltv_key_t KEY_CALIBRATION_VECTOR = LTV_KEY("CalibrationVector");
+
+static const ltv_field_t MyData_fields[] = {
+    LTV_FIELD_STRING(struct MyData, Name),
+    LTV_FIELD(struct MyData, Setting_A, LTV_U32),
+    LTV_FIELD(struct MyData, Setting_B, LTV_I32),
+    LTV_FIELD(struct MyData, Setting_C, LTV_F32),
+    LTV_FIELD_ARRAY(struct MyData, CalibrationVector, LTV_F32),
+};
+static const ltv_schema_t MyData_schema = LTV_SCHEMA(struct MyData, MyData_fields);
+
+static void MyData_serialize(ltv_encoder_t *enc, const struct MyData *d) {
+    ltv_struct_start(enc);
+    ltv_key(enc, &KEY_NAME); ltv_string(enc, d->Name);
+    ltv_key(enc, &KEY_SETTING_A); ltv_u32(enc, d->Setting_A);
+    ltv_key(enc, &KEY_SETTING_B); ltv_i32(enc, d->Setting_B);
+    ltv_key(enc, &KEY_SETTING_C); ltv_f32(enc, d->Setting_C);
+    ltv_key(enc, &KEY_CALIBRATION_VECTOR); ltv_f32_vec(enc, (float*)d->CalibrationVector, 16);
+    ltv_struct_end(enc);
+}
+
+// The same checks as the schema decoder, keyed with is_string_eq.
+static bool MyData_deserialize(ltv_decoder_t *dec, struct MyData *d) {
+    ltv_data_t k, v;
+    if (ltv_next(dec, &k) != LTV_SUCCESS || k.type_code != LTV_STRUCT) return false;
+    if (ltv_next(dec, &k) != LTV_SUCCESS) return false;
+
+    while (k.type_code != LTV_END) {
+        if (ltv_next(dec, &v) != LTV_SUCCESS) return false;
+
+        if (is_string_eq(&k, "Name")) {
+            if (v.type_code != LTV_STRING || v.length > sizeof(d->Name) - 1) return false;
+            memcpy(d->Name, v.val.v_buffer, v.length);
+            d->Name[v.length] = 0;
+        } else if (is_string_eq(&k, "Setting_A")) {
+            if (!is_uint_bound(&v, 0, UINT32_MAX)) return false;
+            d->Setting_A = (uint32_t)v.val.v_uint;
+        } else if (is_string_eq(&k, "Setting_B")) {
+            if (!is_int_bound(&v, INT32_MIN, INT32_MAX)) return false;
+            d->Setting_B = (int32_t)v.val.v_int;
+        } else if (is_string_eq(&k, "Setting_C")) {
+            if (!is_float(&v)) return false;
+            d->Setting_C = v.val.v_float32;
+        } else if (is_string_eq(&k, "CalibrationVector")) {
+            if (!(v.type_code == LTV_F32 && v.size_code > LTV_SINGLE) || v.length > sizeof(d->CalibrationVector)) return false;
+            memcpy(d->CalibrationVector, v.val.v_buffer, v.length);
+        }
+
+        if (ltv_next(dec, &k) != LTV_SUCCESS) return false;
+    }
+    return true;
+}
+
+// A wider record: 24 scalar fields and a list of 8 nested structs.
+#define WIDE_SCALARS 24
+
+typedef struct {
+    uint16_t id;
+    float gain;
+    int32_t offset;
+} wide_channel_t;
+
+typedef struct {
+    uint32_t values[WIDE_SCALARS];
+    wide_channel_t channels[8];
+} wide_t;
+
+static char wide_names[WIDE_SCALARS][24];
+static ltv_field_t wide_fields[WIDE_SCALARS + 1];
+
+static const ltv_field_t wide_channel_fields[] = {
+    LTV_FIELD(wide_channel_t, id, LTV_U16),
+    LTV_FIELD(wide_channel_t, gain, LTV_F32),
+    LTV_FIELD(wide_channel_t, offset, LTV_I32),
+};
+static const ltv_schema_t wide_channel_schema = LTV_SCHEMA(wide_channel_t, wide_channel_fields);
+static ltv_schema_t wide_schema = { wide_fields, WIDE_SCALARS + 1, sizeof(wide_t), NULL };
+
+static void wide_setup(void) {
+    for (int i = 0; i < WIDE_SCALARS; i++) {
+        snprintf(wide_names[i], sizeof(wide_names[i]), "sensor_reading_%02d", i);
+        ltv_key_init(&wide_fields[i].key, wide_names[i]);
+        wide_fields[i].offset = offsetof(wide_t, values) + i * sizeof(uint32_t);
+        wide_fields[i].type_code = LTV_U32;
+    }
+    wide_fields[WIDE_SCALARS] = (ltv_field_t)LTV_FIELD_STRUCT_ARRAY(wide_t, channels, wide_channel_schema);
+}
+
+static bool wide_channel_deserialize(ltv_decoder_t *dec, wide_channel_t *c) {
+    ltv_data_t k, v;
+    while (ltv_next(dec, &k) == LTV_SUCCESS && k.type_code != LTV_END) {
+        if (ltv_next(dec, &v) != LTV_SUCCESS) return false;
+        if (is_string_eq(&k, "id")) {
+            if (!is_uint_bound(&v, 0, UINT16_MAX)) return false;
+            c->id = (uint16_t)v.val.v_uint;
+        } else if (is_string_eq(&k, "gain")) {
+            if (!is_float(&v)) return false;
+            c->gain = v.val.v_float32;
+        } else if (is_string_eq(&k, "offset")) {
+            if (!is_int_bound(&v, INT32_MIN, INT32_MAX)) return false;
+            c->offset = (int32_t)v.val.v_int;
+        }
+    }
+    return true;
+}
+
+static bool wide_deserialize(ltv_decoder_t *dec, wide_t *w) {
+    ltv_data_t k, v;
+    if (ltv_next(dec, &k) != LTV_SUCCESS || k.type_code != LTV_STRUCT) return false;
+
+    while (ltv_next(dec, &k) == LTV_SUCCESS && k.type_code != LTV_END) {
+        if (ltv_next(dec, &v) != LTV_SUCCESS) return false;
+
+        if (is_string_eq(&k, "channels")) {
+            size_t n = 0;
+            while (ltv_next(dec, &v) == LTV_SUCCESS && v.type_code == LTV_STRUCT && n < 8) {
+                if (!wide_channel_deserialize(dec, &w->channels[n++])) return false;
+            }
+            continue;
+        }
+        for (int i = 0; i < WIDE_SCALARS; i++) {
+            if (is_string_eq(&k, wide_names[i])) {
+                if (!is_uint_bound(&v, 0, UINT32_MAX)) return false;
+                w->values[i] = (uint32_t)v.val.v_uint;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+static void run_encode(const char *name, const ltv_schema_t *schema, const void *obj,
+                       void (*hand)(ltv_encoder_t*, const void*)) {
+    static uint8_t buf[4096];
+    ltv_encoder_t e;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_encoder_init_memory(&e, buf, sizeof(buf));
+        if (hand != NULL) {
+            hand(&e, obj);
+        } else {
+            ltv_schema_encode(&e, schema, obj);
+        }
+        bench_sink += e.offset;
+    }
+    bench_report(name, bench_now_ns() - start, ITERATIONS, 0);
+}
+
+static void MyData_serialize_any(ltv_encoder_t *e, const void *obj) {
+    MyData_serialize(e, obj);
+}
+
+int main() {
+    static uint8_t buf[4096];
+    struct MyData data = { .Name = "SensorMcSenseFace", .Setting_A = 5, .Setting_B = 5, .Setting_C = 7.89f };
+    struct MyData out;
+    ltv_encoder_t e;
+    ltv_decoder_t d;
+    uint64_t start;
+
+    for (int i = 0; i < 16; i++) {
+        data.CalibrationVector[i] = i + 0.123f + ((float)i * 2);
+    }
+
+    run_encode("MyData encode: hand-written", NULL, &data, MyData_serialize_any);
+    run_encode("MyData encode: schema", &MyData_schema, &data, NULL);
+
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    MyData_serialize(&e, &data);
+    size_t len = e.offset;
+
+    start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_decoder_init(&d, buf, len);
+        bench_sink += MyData_deserialize(&d, &out);
+    }
+    bench_report("MyData decode: hand-written", bench_now_ns() - start, ITERATIONS, 0);
+
+    start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_decoder_init(&d, buf, len);
+        bench_sink += ltv_schema_decode(&d, &MyData_schema, &out);
+    }
+    bench_report("MyData decode: schema", bench_now_ns() - start, ITERATIONS, 0);
+    if (memcmp(&out, &data, sizeof(out)) != 0) {
+        printf("MyData mismatch\n");
+        return 1;
+    }
+
+    // Wide record
+    static wide_t wide, wide_out;
+    wide_setup();
+    for (int i = 0; i < WIDE_SCALARS; i++) wide.values[i] = i * 1000;
+    for (int i = 0; i < 8; i++) wide.channels[i] = (wide_channel_t){ i, i * 0.5f, -i };
+
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_schema_encode(&e, &wide_schema, &wide);
+    len = e.offset;
+
+    start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_decoder_init(&d, buf, len);
+        bench_sink += wide_deserialize(&d, &wide_out);
+    }
+    bench_report("wide decode: hand-written", bench_now_ns() - start, ITERATIONS, 0);
+
+    memset(&wide_out, 0, sizeof(wide_out));
+    start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_decoder_init(&d, buf, len);
+        bench_sink += ltv_schema_decode(&d, &wide_schema, &wide_out);
+    }
+    bench_report("wide decode: schema", bench_now_ns() - start, ITERATIONS, 0);
+    if (memcmp(&wide_out, &wide, sizeof(wide)) != 0) {
+        printf("wide mismatch\n");
+        return 1;
+    }
+
+    // The same record from another writer, with the scalars in reverse order:
+    // every key misses the expected next field.
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_struct_start(&e);
+    for (int i = WIDE_SCALARS; i-- > 0; ) {
+        ltv_key(&e, &wide_fields[i].key);
+        ltv_u32(&e, wide.values[i]);
+    }
+    ltv_struct_end(&e);
+    len = e.offset;
+
+    for (int indexed = 0; indexed < 2; indexed++) {
+        if (indexed && !ltv_schema_index(&wide_schema)) {
+            printf("index failed\n");
+            return 1;
+        }
+        memset(&wide_out, 0, sizeof(wide_out));
+        start = bench_now_ns();
+        for (int i = 0; i < ITERATIONS; i++) {
+            ltv_decoder_init(&d, buf, len);
+            bench_sink += ltv_schema_decode(&d, &wide_schema, &wide_out);
+        }
+        bench_report(indexed ? "reversed wide decode: indexed schema" : "reversed wide decode: schema",
+                     bench_now_ns() - start, ITERATIONS, 0);
+        if (memcmp(wide_out.values, wide.values, sizeof(wide.values)) != 0) {
+            printf("reversed wide mismatch\n");
+            return 1;
+        }
+    }
+    ltv_schema_index_free(&wide_schema);
+    return 0;
+}
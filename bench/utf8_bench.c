@@ -0,0 +1,67 @@
+// UTF-8 validation benchmark: decodes a large string element built from
+// ASCII, mixed Latin and CJK heavy text. With LTV_VALIDATE_UTF_8 on, nearly
+// all of the decode time is spent validating.
+
+#include "litevectors.h"
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXT_LEN (64 * 1024)
+#define ITERATIONS 2000
+
+static uint8_t text[TEXT_LEN];
+static uint8_t encoded[TEXT_LEN + 16];
+
+// Fill the text from a list of words until it is full, returning its length.
+static size_t fill(const char **words, size_t count) {
+    size_t len = 0;
+    for (size_t i = 0; ; i++) {
+        const char *w = words[(i * 7) % count];
+        size_t n = strlen(w);
+        if (len + n + 1 > TEXT_LEN) {
+            return len;
+        }
+        memcpy(&text[len], w, n);
+        text[len + n] = ' ';
+        len += n + 1;
+    }
+}
+
+static void run(const char *name, size_t len) {
+    ltv_encoder_t e;
+    ltv_decoder_t d;
+    ltv_data_t data;
+
+    ltv_encoder_init_memory(&e, encoded, sizeof(encoded));
+    ltv_string_n(&e, (const char*)text, len);
+
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ltv_decoder_init(&d, encoded, e.offset);
+        if (ltv_next(&d, &data) != LTV_SUCCESS) {
+            printf("%s: decode failed\n", name);
+            exit(1);
+        }
+        bench_sink += data.length;
+    }
+    bench_report(name, bench_now_ns() - start, ITERATIONS, (uint64_t)len * ITERATIONS);
+}
+
+int main() {
+    static const char *ascii[] = {
+        "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "telemetry", "sensor"
+    };
+    static const char *mixed[] = {
+        "the", "café", "naïve", "über", "résumé", "sensor", "Zürich", "déjà", "vu", "piñata"
+    };
+    static const char *cjk[] = {
+        "データ", "温度", "圧力", "センサー", "測定値", "状態", "正常", "기록", "数据", "传感器"
+    };
+
+    run("utf8: ascii", fill(ascii, 10));
+    run("utf8: mixed latin", fill(mixed, 10));
+    run("utf8: cjk", fill(cjk, 10));
+    return 0;
+}
@@ -4,12 +4,14 @@
 //
 // Deserializing a buffer back into a structure is demonstrated, along with
 // some techniques for validating the incoming data and handling data that isn't
-// exactly the same type.
+// exactly the same type. When only one field is needed, a compiled path query
+// finds it without a hand-written key loop.
 
 #include <stdio.h>
 #include <string.h>
 #include "litevectors.h"
 #include "litevectors_util.h"
+#include "litevectors_query.h"
 
 #define ARRAY_LEN(x) sizeof(x)/sizeof(x[0])
 
@@ -39,17 +41,30 @@ void MyData_print(struct MyData *d) {
     printf("]\n");
 }
 
+// Struct keys, encoded once at compile time.
+static const ltv_key_t KEY_NAME = LTV_KEY("Name");
+static const ltv_key_t KEY_SETTING_A = LTV_KEY("Setting_A");
+static const ltv_key_t KEY_SETTING_B = LTV_KEY("Setting_B");
+static const ltv_key_t KEY_SETTING_C = LTV_KEY("Setting_C");
+static const ltv_key_t KEY_CALIBRATION_VECTOR = LTV_KEY("CalibrationVector");
+
+// Field names for deserializing, and a matcher that maps a decoded key to
+// its position here. It is built once, in main.
+enum { FIELD_NAME, FIELD_SETTING_A, FIELD_SETTING_B, FIELD_SETTING_C, FIELD_CALIBRATION_VECTOR };
+static const char *const MyData_fields[] = { "Name", "Setting_A", "Setting_B", "Setting_C", "CalibrationVector" };
+static key_matcher_t MyData_keys;
+
 // Function to serialize the data structure into a LiteVector.
 void MyData_serialize(ltv_encoder_t *enc, struct MyData *d) {
 
     // Use a struct for name/value pairs
     ltv_struct_start(enc);
 
-    ltv_string(enc, "Name"); ltv_string(enc, d->Name);
-    ltv_string(enc, "Setting_A"); ltv_u64(enc, d->Setting_A);
-    ltv_string(enc, "Setting_B"); ltv_i32(enc, d->Setting_B);
-    ltv_string(enc, "Setting_C"); ltv_f32(enc, d->Setting_C);
-    ltv_string(enc, "CalibrationVector"); ltv_f32_vec(enc, d->CalibrationVector, ARRAY_LEN(d->CalibrationVector));
+    ltv_key(enc, &KEY_NAME); ltv_string(enc, d->Name);
+    ltv_key(enc, &KEY_SETTING_A); ltv_u64(enc, d->Setting_A);
+    ltv_key(enc, &KEY_SETTING_B); ltv_i32(enc, d->Setting_B);
+    ltv_key(enc, &KEY_SETTING_C); ltv_f32(enc, d->Setting_C);
+    ltv_key(enc, &KEY_CALIBRATION_VECTOR); ltv_f32_vec(enc, d->CalibrationVector, ARRAY_LEN(d->CalibrationVector));
 
     ltv_struct_end(enc);
 }
@@ -84,8 +99,10 @@ bool MyData_deserialize(ltv_decoder_t *dec,  struct MyData *d) {
         // Read value
         if (ltv_next(dec, &v) != LTV_SUCCESS) return false;
 
-        // Switch on struct key
-        if (is_string_eq(&k, "Name")) {
+        // Switch on struct key. The matcher finds it with one comparison, 
+        // rather than comparing against each field name in turn.
+        size_t field = key_matcher_find(&MyData_keys, &k);
+        if (field == FIELD_NAME) {
 
             // Validate type
             if  (v.type_code != LTV_STRING) {
@@ -102,7 +119,7 @@ bool MyData_deserialize(ltv_decoder_t *dec,  struct MyData *d) {
             memcpy(d->Name, v.val.v_buffer, v.length);
             d->Name[v.length] = 0;
 
-        } else if (is_string_eq(&k, "Setting_A")) {
+        } else if (field == FIELD_SETTING_A) {
             
             // Validate Setting_A - can be any valid value
             if (!is_uint_bound(&v, 0, UINT32_MAX)) {
@@ -112,7 +129,7 @@ bool MyData_deserialize(ltv_decoder_t *dec,  struct MyData *d) {
 
             d->Setting_A = (uint32_t)v.val.v_uint; 
 
-        } else if (is_string_eq(&k, "Setting_B")) {
+        } else if (field == FIELD_SETTING_B) {
 
             // Validate Setting_B- must be between -10 and 50 (for example)
             if (!is_int_bound(&v, -10, 50)) {
@@ -122,7 +139,7 @@ bool MyData_deserialize(ltv_decoder_t *dec,  struct MyData *d) {
 
             d->Setting_B = (int32_t)v.val.v_int;
 
-        } else if (is_string_eq(&k, "Setting_C")) {
+        } else if (field == FIELD_SETTING_C) {
 
             // Validate Setting_C - any number is taken
             if (is_float(&v)) {
@@ -139,7 +156,7 @@ bool MyData_deserialize(ltv_decoder_t *dec,  struct MyData *d) {
                 return false;
             }
 
-        } else if (is_string_eq(&k, "CalibrationVector")) {
+        } else if (field == FIELD_CALIBRATION_VECTOR) {
             // Require a vector of 32-bit floating point numbers.
             if  (!(v.type_code == LTV_F32 && v.size_code > LTV_SINGLE)) {
                 printf("Invalid type for CalibrationVector\n");
@@ -161,6 +178,11 @@ bool MyData_deserialize(ltv_decoder_t *dec,  struct MyData *d) {
 int main() {
     printf("LiteVector Basic Example\n\n");
 
+    if (!key_matcher_init(&MyData_keys, MyData_fields, ARRAY_LEN(MyData_fields))) {
+        printf("Unable to build the MyData key matcher\n");
+        return 1;
+    }
+
     struct MyData data = {
         .Name = "SensorMcSenseFace",
         .Setting_A = 5,
@@ -203,4 +225,15 @@ int main() {
     } else {
         printf("Unable to deserialize MyData\n");
     }
+
+    // Read just one field. The query can be compiled once and reused.
+    ltv_query_t query;
+    ltv_data_t v;
+    ltv_query_compile(&query, "Setting_B");
+    ltv_decoder_init(&dec, staticBuf.data, staticBuf.size);
+    if (ltv_query_first(&query, &dec, &v) == LTV_SUCCESS && is_int_bound(&v, -10, 50)) {
+        printf("\nQueried Setting_B: %d\n", (int32_t)v.val.v_int);
+    }
+
+    key_matcher_free(&MyData_keys);
 }
\ No newline at end of file
@@ -16,9 +16,6 @@
 #define JS_MAX_SAFE_INT  9007199254740991
 #define JS_MIN_SAFE_INT -9007199254740991
 
-// Element lengths in bytes
-static const int ltv_type_sizes[] = {0, 0, 0, 0, 1, 1, 1, 2, 4, 8, 1, 2, 4, 8, 4, 8};
-
 void print_indent(int level) {
     int indent = level * 4;
     for(int i=0; i < indent; i++) {
@@ -343,38 +340,23 @@ int64_t print_ltv(const uint8_t *buf, size_t bufLen) {
 
 
 void print_ltv_file(const char* filename) {
-    FILE *fd = fopen(filename, "rb");
-    if (fd == NULL) {
-        printf("Error: Unable to open data file\n");
-        return;
-    }
-
-    // Get the file size
-    fseek(fd, 0L, SEEK_END);
-    size_t fileSize = ftell(fd);
-    fseek(fd, 0, SEEK_SET);
-
-    // Create a buffer for the file contents
-    uint8_t *buf = malloc(fileSize);
-    if (buf == NULL) {
-        printf("Error: Unable to allocate buffer for file (size %zu)\n", fileSize);
+    // Map the file rather than reading it all first, so output starts 
+    // straight away. "-" reads standard input.
+    mapped_file_t f;
+    int status;
+    if (strcmp(filename, "-") == 0) {
+        status = mapped_file_open_fd(&f, 0, LTV_VALIDATE_FULL);
+    } else {
+        status = mapped_file_open(&f, filename, LTV_VALIDATE_FULL);
     }
 
-    // Read the file into memory
-    size_t nread = fread(buf, 1, fileSize, fd);
-    fclose(fd);
-    
-    if (nread < fileSize) {
-        if (feof(fd))
-            printf("Error: unexpected end of file\n");
-        else if (ferror(fd)) {
-            perror("Error: reading");
-        }
-
+    if (status != 0) {
+        printf("Error: Unable to read data file: %s\n", strerror(status));
         return;
     }
 
     // Print the vector
-    print_ltv(buf, nread);
+    print_ltv_r(&f.decoder, 0, false, true);
     printf("\n");
+    mapped_file_close(&f);
 }
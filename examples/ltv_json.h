@@ -6,7 +6,7 @@
 // Print a LiteVector, returns the number of bytes consumed.
 int64_t print_ltv(const uint8_t *buf, size_t bufSize);
 
-// Print a LiteVector file
+// Print a LiteVector file, or standard input if 'filename' is "-".
 void print_ltv_file(const char* filename);
 
 #endif
\ No newline at end of file
@@ -4,6 +4,11 @@
 
 #include "litevectors.h"
 
+#if defined(LTV_VALIDATE_UTF_8) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LTV_UTF8_X86
+#include <immintrin.h>
+#endif
+
 // Assertion: LITTLE ENDIAN ARCHITECTURE
 
 // Size assertions for the unfixed types we're using
@@ -13,7 +18,12 @@ _Static_assert(sizeof(float) == 4, "unexpected float datatype size");
 _Static_assert(sizeof(double) == 8, "unexpected double datatype size");
 
 // Element lengths in bytes
-static const int ltv_type_sizes[] = {0, 0, 0, 0, 1, 1, 1, 2, 4, 8, 1, 2, 4, 8, 4, 8};
+const uint8_t ltv_type_sizes[16] = {0, 0, 0, 0, 1, 1, 1, 2, 4, 8, 1, 2, 4, 8, 4, 8};
+
+// Incremental vector states
+#define LTV_VECTOR_CLOSED   0
+#define LTV_VECTOR_SIZED    1
+#define LTV_VECTOR_UNSIZED  2
                                     
 ////////////////////////////////////////////////////////////////////////////////
 // Encoder
@@ -24,6 +34,116 @@ void ltv_encoder_init(ltv_encoder_t *e, ltv_writer writer, void *user_data) {
     e->user_data = user_data;
     e->offset = 0;
     e->status = 0;
+    e->stage = NULL;
+    e->stage_size = 0;
+    e->stage_len = 0;
+    e->cursor = NULL;
+    e->end = NULL;
+    e->gather_writer = NULL;
+    e->iov = NULL;
+    e->iov_size = 0;
+    e->iov_len = 0;
+    e->patcher = NULL;
+    e->vec_state = LTV_VECTOR_CLOSED;
+    e->vec_type = 0;
+    e->vec_start = 0;
+    e->vec_remaining = 0;
+    e->align_records = NULL;
+    e->align_records_size = 0;
+    e->align_records_len = 0;
+}
+
+void ltv_encoder_init_buffered(ltv_encoder_t *e, ltv_writer writer, void *user_data, 
+                               uint8_t *stage, size_t stage_size) {
+    ltv_encoder_init(e, writer, user_data);
+    e->stage = stage;
+    e->stage_size = stage == NULL ? 0 : stage_size;
+}
+
+void ltv_encoder_init_memory(ltv_encoder_t *e, uint8_t *buf, size_t buf_len) {
+    ltv_encoder_init(e, NULL, NULL);
+    e->cursor = buf;
+    e->end = buf == NULL ? NULL : buf + buf_len;
+}
+
+void ltv_encoder_init_measure(ltv_encoder_t *e) {
+    ltv_encoder_init(e, NULL, NULL);
+}
+
+void ltv_encoder_init_gather(ltv_encoder_t *e, ltv_gather_writer writer, void* user_data,
+                             uint8_t *stage, size_t stage_size, ltv_iovec_t *iov, size_t iov_size) {
+    ltv_encoder_init(e, NULL, user_data);
+    e->gather_writer = writer;
+    e->stage = stage;
+    e->stage_size = stage_size;
+    e->iov = iov;
+    e->iov_size = iov_size;
+    if (stage == NULL || stage_size < LTV_GATHER_COPY_LIMIT || iov == NULL || iov_size < 2) {
+        e->status = LTV_ENCODE_GATHER_BUFFERS;
+    }
+}
+
+int ltv_flush(ltv_encoder_t *e) {
+    if (e->gather_writer != NULL) {
+        if (e->iov_len > 0 && e->status == 0) {
+            e->status = e->gather_writer(e->iov, e->iov_len, e->user_data);
+        }
+        e->iov_len = 0;
+        e->stage_len = 0;
+        return e->status;
+    }
+
+    if (e->stage_len > 0) {
+        if (e->status == 0) {
+            e->status = e->writer(e->stage, e->stage_len, e->user_data);
+        }
+        e->stage_len = 0;
+    }
+    return e->status;
+}
+
+// Add a write to the pending segments of a gather encoder.
+static void ltv_write_gather(ltv_encoder_t *e, const uint8_t *buf, size_t count) {
+    e->offset += count;
+    if (count == 0) {
+        return;
+    }
+
+    // Reference large writes in place. Anything smaller may be a temporary
+    // (an encoded tag or length), so it is always copied.
+    if (count >= LTV_GATHER_COPY_LIMIT) {
+        if (e->iov_len == e->iov_size && ltv_flush(e) != 0) {
+            return;
+        }
+        e->iov[e->iov_len].base = buf;
+        e->iov[e->iov_len].len = count;
+        e->iov_len++;
+        return;
+    }
+
+    // Copy small writes into the staging buffer
+    if (count > e->stage_size - e->stage_len && ltv_flush(e) != 0) {
+        return;
+    }
+
+    // Extend the last segment if it ends where the new bytes go
+    uint8_t *dst = &e->stage[e->stage_len];
+    ltv_iovec_t *last = e->iov_len > 0 ? &e->iov[e->iov_len-1] : NULL;
+    if (last == NULL || (const uint8_t*) last->base + last->len != dst) {
+        if (e->iov_len == e->iov_size) {
+            if (ltv_flush(e) != 0) {
+                return;
+            }
+            dst = e->stage;
+        }
+        last = &e->iov[e->iov_len++];
+        last->base = dst;
+        last->len = 0;
+    }
+
+    memcpy(dst, buf, count);
+    last->len += count;
+    e->stage_len += count;
 }
 
 void ltv_write(ltv_encoder_t *e, const uint8_t *buf, size_t count) {
@@ -31,8 +151,59 @@ void ltv_write(ltv_encoder_t *e, const uint8_t *buf, size_t count) {
         return;
     }
 
+    // Encoders without a writer callback
+    if (e->writer == NULL) {
+
+        // Gather encoder
+        if (e->gather_writer != NULL) {
+            ltv_write_gather(e, buf, count);
+            return;
+        }
+
+        // Measuring encoder
+        if (e->cursor == NULL) {
+            e->offset += count;
+            return;
+        }
+
+        // Memory encoder
+        if (count > (size_t)(e->end - e->cursor)) {
+            e->status = LTV_ENCODE_BUFFER_FULL;
+            return;
+        }
+        memcpy(e->cursor, buf, count);
+        e->cursor += count;
+        e->offset += count;
+        return;
+    }
+
     e->offset += count;
-    e->status = e->writer(buf, count, e->user_data);
+
+    // Unbuffered
+    if (e->stage_size == 0) {
+        e->status = e->writer(buf, count, e->user_data);
+        return;
+    }
+
+    // Stage the data if it fits
+    if (count <= e->stage_size - e->stage_len) {
+        memcpy(&e->stage[e->stage_len], buf, count);
+        e->stage_len += count;
+        return;
+    }
+
+    if (ltv_flush(e) != 0) {
+        return;
+    }
+
+    // Pass large writes straight through
+    if (count >= e->stage_size) {
+        e->status = e->writer(buf, count, e->user_data);
+        return;
+    }
+
+    memcpy(e->stage, buf, count);
+    e->stage_len = count;
 }
 
 void ltv_write_byte(ltv_encoder_t *e, uint8_t value) {
@@ -47,63 +218,61 @@ void ltv_write_tag(ltv_encoder_t *e, uint8_t type_code, uint8_t size_code) {
     ltv_write_byte(e, (type_code << 4) | size_code); 
 }
 
+// Write a tag and a single value of up to 8 bytes in one write.
+void ltv_write_single(ltv_encoder_t *e, uint8_t type_code, const void *val, size_t size) {
+    uint8_t buf[9];
+    buf[0] = (type_code << 4) | LTV_SINGLE;
+    memcpy(&buf[1], val, size);
+    ltv_write(e, buf, size + 1);
+}
+
 void ltv_nil(ltv_encoder_t *e) {
     ltv_write_tag(e, LTV_NIL, LTV_SINGLE);
 }
 
 void ltv_bool(ltv_encoder_t *e, bool value) {
-    ltv_write_tag(e, LTV_BOOL, LTV_SINGLE);
-    ltv_write_byte(e, value);
+    uint8_t val = value;
+    ltv_write_single(e, LTV_BOOL, &val, sizeof(uint8_t));
 }
 
 void ltv_i8(ltv_encoder_t *e, int8_t val) {
-    ltv_write_tag(e, LTV_I8, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(int8_t));
+    ltv_write_single(e, LTV_I8, &val, sizeof(int8_t));
 }
 
 void ltv_i16(ltv_encoder_t *e, int16_t val) {
-    ltv_write_tag(e, LTV_I16, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(int16_t));
+    ltv_write_single(e, LTV_I16, &val, sizeof(int16_t));
 }
 
 void ltv_i32(ltv_encoder_t *e, int32_t val) {
-    ltv_write_tag(e, LTV_I32, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(int32_t));
+    ltv_write_single(e, LTV_I32, &val, sizeof(int32_t));
 }
 
 void ltv_i64(ltv_encoder_t *e, int64_t val) {
-    ltv_write_tag(e, LTV_I64, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(int64_t));
+    ltv_write_single(e, LTV_I64, &val, sizeof(int64_t));
 }
 
 void ltv_u8(ltv_encoder_t *e, uint8_t val) {
-    ltv_write_tag(e, LTV_U8, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(uint8_t));
+    ltv_write_single(e, LTV_U8, &val, sizeof(uint8_t));
 }
 
 void ltv_u16(ltv_encoder_t *e, uint16_t val) {
-    ltv_write_tag(e, LTV_U16, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(uint16_t));
+    ltv_write_single(e, LTV_U16, &val, sizeof(uint16_t));
 }
 
 void ltv_u32(ltv_encoder_t *e, uint32_t val) {
-    ltv_write_tag(e, LTV_U32, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(uint32_t));
+    ltv_write_single(e, LTV_U32, &val, sizeof(uint32_t));
 }
 
 void ltv_u64(ltv_encoder_t *e, uint64_t val) {
-    ltv_write_tag(e, LTV_U64, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(uint64_t));
+    ltv_write_single(e, LTV_U64, &val, sizeof(uint64_t));
 }
 
 void ltv_f32(ltv_encoder_t *e, float val) {
-    ltv_write_tag(e, LTV_F32, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(float));
+    ltv_write_single(e, LTV_F32, &val, sizeof(float));
 }
 
 void ltv_f64(ltv_encoder_t *e, double val) {
-    ltv_write_tag(e, LTV_F64, LTV_SINGLE);
-    ltv_write(e, (const uint8_t*) &val, sizeof(double));
+    ltv_write_single(e, LTV_F64, &val, sizeof(double));
 }
 
 void ltv_struct_start(ltv_encoder_t *e) {
@@ -122,37 +291,84 @@ void ltv_list_end(ltv_encoder_t *e) {
     ltv_write_tag(e, LTV_END, LTV_SINGLE);
 }
 
-void ltv_write_vector(ltv_encoder_t *e, uint8_t type_code, const uint8_t* buf, size_t count) {
-
-    int typeSize = ltv_type_sizes[type_code];
-    size_t len = count * typeSize;
-
-    // Compute the number of bytes 2^n needed to store len
-    int exp = 3;
+// Compute the exponent n of the 2^n bytes needed to store len
+static int ltv_length_exp(size_t len) {
     if(len < INT8_MAX) {
-        exp = 0;
+        return 0;
     } else if (len < INT16_MAX) {
-        exp = 1;
+        return 1;
     } else if (len < INT32_MAX) {
-        exp = 2;
+        return 2;
     } 
+    return 3;
+}
 
-    int size_code = LTV_SIZE_1 + exp;
-    size_t lenSize = 1 << exp;
-
-    // Insert NOPs to align arrays to type size alignment.
+// Number of NOPs to insert before a vector tag at the current offset, so 
+// that the payload following the tag and length is aligned to its type size.
+static size_t ltv_padding_len(ltv_encoder_t *e, int typeSize, size_t lenSize) {
 #ifdef LTV_VECTOR_ALIGNMENT
     int alignmentDelta = (e->offset + 1 + lenSize) & (typeSize - 1);
     if (alignmentDelta != 0) {
-        int paddingLen = typeSize - alignmentDelta;
-        for(int i=0; i < paddingLen; i++) {
-            ltv_write_nop(e);
-        }
+        return typeSize - alignmentDelta;
     }
+#else
+    (void) e;
+    (void) typeSize;
+    (void) lenSize;
 #endif
+    return 0;
+}
+
+// Record the position of an alignment sensitive vector in a fragment encoder,
+// before its padding is written.
+static void ltv_record_alignment(ltv_encoder_t *e, size_t paddingLen, int typeSize) {
+#ifdef LTV_VECTOR_ALIGNMENT
+    if (e->align_records == NULL || typeSize == 1 || e->status != 0) {
+        return;
+    }
+
+    if (e->align_records_len == e->align_records_size) {
+        e->status = LTV_ENCODE_BUFFER_FULL;
+        return;
+    }
 
-    ltv_write_tag(e, type_code, size_code);
-    ltv_write(e, (const uint8_t*) &len, lenSize);
+    ltv_align_record_t *r = &e->align_records[e->align_records_len++];
+    r->offset = e->offset + paddingLen;
+    r->padding = paddingLen;
+#else
+    (void) e;
+    (void) paddingLen;
+    (void) typeSize;
+#endif
+}
+
+// Write the padding, tag and length that precede a vector payload, 
+// using a length field of 2^exp bytes.
+static void ltv_write_vector_header(ltv_encoder_t *e, uint8_t type_code, size_t len, int exp) {
+
+    int typeSize = ltv_type_sizes[type_code];
+    int size_code = LTV_SIZE_1 + exp;
+    size_t lenSize = 1 << exp;
+
+    // The header (padding, tag and length) is assembled here and written
+    // with a single call: at most 7 NOPs, 1 tag and 8 length bytes.
+    uint8_t header[16];
+
+    // Insert NOPs to align arrays to type size alignment.
+    size_t headerLen = ltv_padding_len(e, typeSize, lenSize);
+    memset(header, LTV_NOP_TAG, headerLen);
+    ltv_record_alignment(e, headerLen, typeSize);
+
+    header[headerLen++] = (type_code << 4) | size_code;
+    memcpy(&header[headerLen], &len, lenSize);
+    headerLen += lenSize;
+
+    ltv_write(e, header, headerLen);
+}
+
+void ltv_write_vector(ltv_encoder_t *e, uint8_t type_code, const uint8_t* buf, size_t count) {
+    size_t len = count * ltv_type_sizes[type_code];
+    ltv_write_vector_header(e, type_code, len, ltv_length_exp(len));
     ltv_write(e, buf, len);
 }
 
@@ -161,6 +377,10 @@ void ltv_string(ltv_encoder_t *e, const char* val) {
     ltv_write_vector(e, LTV_STRING, (const uint8_t*) val, len);
 }
 
+void ltv_string_n(ltv_encoder_t *e, const char* val, size_t len) {
+    ltv_write_vector(e, LTV_STRING, (const uint8_t*) val, len);
+}
+
 void ltv_bool_vec(ltv_encoder_t *e, bool *val, size_t count) {
     ltv_write_vector(e, LTV_BOOL, (const uint8_t*) val, count);
 }
@@ -206,6 +426,176 @@ void ltv_f64_vec(ltv_encoder_t *e, double *val, size_t count) {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Incremental vectors
+////////////////////////////////////////////////////////////////////////////////
+
+void ltv_encoder_set_patcher(ltv_encoder_t *e, ltv_patcher patcher) {
+    e->patcher = patcher;
+}
+
+// Overwrite 'len' bytes previously written at stream offset 'offset'.
+// Bytes still held by the encoder are patched in place, otherwise the
+// patcher is used.
+static void ltv_patch(ltv_encoder_t *e, size_t offset, const uint8_t *buf, size_t len) {
+    if (e->status != 0) {
+        return;
+    }
+
+    // Gather encoder: look for the bytes in a pending stage segment
+    if (e->gather_writer != NULL) {
+        size_t segEnd = e->offset;
+        for (size_t i = e->iov_len; i > 0; i--) {
+            const ltv_iovec_t *seg = &e->iov[i-1];
+            size_t segStart = segEnd - seg->len;
+            if (offset >= segStart) {
+                const uint8_t *base = seg->base;
+                if (offset + len <= segEnd && base >= e->stage && base < e->stage + e->stage_size) {
+                    memcpy(&e->stage[base - e->stage + (offset - segStart)], buf, len);
+                    return;
+                }
+                break;
+            }
+            segEnd = segStart;
+        }
+
+    // Memory and measuring encoders
+    } else if (e->writer == NULL) {
+        if (e->cursor != NULL) {
+            memcpy(e->cursor - (e->offset - offset), buf, len);
+        }
+        return;
+
+    // Buffered encoder: the bytes may still be staged
+    } else if (offset >= e->offset - e->stage_len) {
+        memcpy(&e->stage[e->stage_len - (e->offset - offset)], buf, len);
+        return;
+    }
+
+    if (e->patcher == NULL) {
+        e->status = LTV_ENCODE_NOT_SEEKABLE;
+        return;
+    }
+
+    e->status = e->patcher(offset, buf, len, e->user_data);
+}
+
+void ltv_vector_begin(ltv_encoder_t *e, uint8_t type_code, size_t count) {
+    size_t len = count * ltv_type_sizes[type_code];
+    ltv_write_vector_header(e, type_code, len, ltv_length_exp(len));
+
+    e->vec_state = LTV_VECTOR_SIZED;
+    e->vec_type = type_code;
+    e->vec_start = e->offset;
+    e->vec_remaining = len;
+}
+
+void ltv_vector_begin_unsized(ltv_encoder_t *e, uint8_t type_code) {
+
+    // Reserve an 8 byte length, filled in by ltv_vector_end.
+    ltv_write_vector_header(e, type_code, 0, 3);
+
+    e->vec_state = LTV_VECTOR_UNSIZED;
+    e->vec_type = type_code;
+    e->vec_start = e->offset;
+    e->vec_remaining = 0;
+}
+
+void ltv_vector_append(ltv_encoder_t *e, const void *buf, size_t count) {
+    size_t len = count * ltv_type_sizes[e->vec_type];
+
+    if (e->vec_state == LTV_VECTOR_CLOSED || 
+        (e->vec_state == LTV_VECTOR_SIZED && len > e->vec_remaining)) {
+        if (e->status == 0) {
+            e->status = LTV_ENCODE_VECTOR_LENGTH;
+        }
+        return;
+    }
+
+    e->vec_remaining -= e->vec_state == LTV_VECTOR_SIZED ? len : 0;
+    ltv_write(e, buf, len);
+}
+
+void ltv_vector_end(ltv_encoder_t *e) {
+    int state = e->vec_state;
+    e->vec_state = LTV_VECTOR_CLOSED;
+
+    if (state == LTV_VECTOR_UNSIZED) {
+        uint64_t len = e->offset - e->vec_start;
+        ltv_patch(e, e->vec_start - sizeof(len), (const uint8_t*) &len, sizeof(len));
+    } else if ((state == LTV_VECTOR_CLOSED || e->vec_remaining != 0) && e->status == 0) {
+        e->status = LTV_ENCODE_VECTOR_LENGTH;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fragments
+////////////////////////////////////////////////////////////////////////////////
+
+void ltv_fragment_init(ltv_fragment_t *f, uint8_t *buf, size_t buf_len, 
+                       ltv_align_record_t *records, size_t records_size) {
+    ltv_encoder_init_memory(&f->encoder, buf, buf_len);
+    f->encoder.align_records = records;
+    f->encoder.align_records_size = records_size;
+    f->buf = buf;
+}
+
+void ltv_fragment_splice(ltv_encoder_t *e, const ltv_fragment_t *f) {
+    const ltv_encoder_t *fe = &f->encoder;
+
+    if (e->status != 0) {
+        return;
+    }
+    if (fe->status != 0) {
+        e->status = fe->status;
+        return;
+    }
+
+    // Copy the fragment up to each alignment sensitive vector, replacing
+    // its padding with what is needed at the new offset.
+    size_t pos = 0;
+    for (size_t i = 0; i < fe->align_records_len; i++) {
+        const ltv_align_record_t *r = &fe->align_records[i];
+        ltv_write(e, &f->buf[pos], r->offset - r->padding - pos);
+
+        uint8_t tag = f->buf[r->offset];
+        int typeSize = ltv_type_sizes[tag >> 4];
+        size_t lenSize = 1 << ((tag & 0x0F) - LTV_SIZE_1);
+
+        uint8_t padding[8];
+        size_t paddingLen = ltv_padding_len(e, typeSize, lenSize);
+        memset(padding, LTV_NOP_TAG, paddingLen);
+        ltv_record_alignment(e, paddingLen, typeSize);
+        ltv_write(e, padding, paddingLen);
+
+        pos = r->offset;
+    }
+
+    ltv_write(e, &f->buf[pos], fe->offset - pos);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pre-encoded keys
+////////////////////////////////////////////////////////////////////////////////
+
+_Static_assert(LTV_KEY_MAX_LEN < INT8_MAX, "LTV_KEY_MAX_LEN must be less than INT8_MAX");
+
+bool ltv_key_init(ltv_key_t *key, const char *str) {
+    size_t len = strlen(str);
+    if (len > LTV_KEY_MAX_LEN) {
+        return false;
+    }
+
+    key->tag = (LTV_STRING << 4) | LTV_SIZE_1;
+    key->len = len;
+    memcpy(key->str, str, len);
+    return true;
+}
+
+void ltv_key(ltv_encoder_t *e, const ltv_key_t *key) {
+    ltv_write(e, &key->tag, 2 + key->len);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // UTF-8 Validation
 ////////////////////////////////////////////////////////////////////////////////
@@ -263,16 +653,278 @@ static const uint8_t utf8d[] = {
     12,36,12,12,12,12,12,12,12,12,12,12
 };
 
-// Check whether a string is valid UTF-8
-bool is_valid_utf8(const uint8_t *buf, size_t buf_len) {
-
-    uint32_t state = UTF8_ACCEPT;
+// Check a run of bytes with the DFA. Returns the new state.
+static inline uint32_t utf8_dfa(uint32_t state, const uint8_t *buf, size_t buf_len) {
     for(size_t i=0; i < buf_len; i++){
         uint32_t type = utf8d[buf[i]];
         state = utf8d[256 + state + type];
     }
+    return state;
+}
+
+// Portable validator: skips 16 byte blocks of ASCII between characters, and
+// runs the DFA over everything else.
+static bool is_valid_utf8_dfa(const uint8_t *buf, size_t buf_len) {
+    static const uint64_t high_bits = 0x8080808080808080ull;
+    uint32_t state = UTF8_ACCEPT;
+    size_t i = 0;
+
+    while (i < buf_len) {
+        if (state == UTF8_ACCEPT) {
+            uint64_t a, b;
+            while (buf_len - i >= 16) {
+                memcpy(&a, &buf[i], 8);
+                memcpy(&b, &buf[i + 8], 8);
+                if (((a | b) & high_bits) != 0) {
+                    break;
+                }
+                i += 16;
+            }
+        }
+
+        size_t n = buf_len - i < 16 ? buf_len - i : 16;
+        state = utf8_dfa(state, &buf[i], n);
+        if (state == UTF8_REJECT) {
+            return false;
+        }
+        i += n;
+    }
     return state == UTF8_ACCEPT;
 }
+
+#ifdef LTV_UTF8_X86
+
+// Vectorized validation using the lookup algorithm from "Validating UTF-8 
+// In Less Than One Instruction Per Byte" (Keiser & Lemire, 2021). Three 16
+// entry tables, indexed by the nibbles of each byte and the byte before it,
+// flag every invalid 2 byte sequence. The remaining errors (missing or extra
+// continuation bytes in 3 and 4 byte characters) are found by checking that
+// continuations appear exactly where earlier lead bytes require them.
+
+#define UTF8_TOO_SHORT      (1 << 0)
+#define UTF8_TOO_LONG       (1 << 1)
+#define UTF8_OVERLONG_3     (1 << 2)
+#define UTF8_TOO_LARGE      (1 << 3)
+#define UTF8_SURROGATE      (1 << 4)
+#define UTF8_OVERLONG_2     (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4     (1 << 6)
+#define UTF8_TWO_CONTS      (1 << 7)
+#define UTF8_CARRY          (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+// Table rows, repeated for both lanes of the AVX2 shuffles.
+#define UTF8_BYTE_1_HIGH \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, \
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2, \
+    UTF8_TOO_SHORT, \
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE, \
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+
+#define UTF8_BYTE_1_LOW \
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, \
+    UTF8_CARRY | UTF8_OVERLONG_2, \
+    UTF8_CARRY, \
+    UTF8_CARRY, \
+    UTF8_CARRY | UTF8_TOO_LARGE, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+
+#define UTF8_BYTE_2_HIGH \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+
+static const uint8_t utf8_byte_1_high[32] __attribute__((aligned(32))) = {UTF8_BYTE_1_HIGH, UTF8_BYTE_1_HIGH};
+static const uint8_t utf8_byte_1_low[32] __attribute__((aligned(32))) = {UTF8_BYTE_1_LOW, UTF8_BYTE_1_LOW};
+static const uint8_t utf8_byte_2_high[32] __attribute__((aligned(32))) = {UTF8_BYTE_2_HIGH, UTF8_BYTE_2_HIGH};
+
+// Subtracted (saturating) from the last bytes of a block: non-zero where a 
+// lead byte's character continues into the next block.
+static const uint8_t utf8_incomplete[32] __attribute__((aligned(32))) = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xEF, 0xDF, 0xBF
+};
+
+// Errors in one 16 byte block, given the block before it.
+__attribute__((target("sse4.1")))
+static inline __m128i utf8_block_sse(__m128i input, __m128i prev_input) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+
+    __m128i b1h = _mm_shuffle_epi8(_mm_load_si128((const __m128i*)utf8_byte_1_high),
+        _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i b1l = _mm_shuffle_epi8(_mm_load_si128((const __m128i*)utf8_byte_1_low),
+        _mm_and_si128(prev1, nibble));
+    __m128i b2h = _mm_shuffle_epi8(_mm_load_si128((const __m128i*)utf8_byte_2_high),
+        _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+
+    // Continuations required by a 3 or 4 byte lead two or three bytes back.
+    __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8((char)0xDF));
+    __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)0xEF));
+    __m128i must23 = _mm_cmpgt_epi8(_mm_or_si128(third, fourth), _mm_setzero_si128());
+    must23 = _mm_and_si128(must23, _mm_set1_epi8((char)0x80));
+
+    return _mm_xor_si128(must23, special);
+}
+
+__attribute__((target("sse4.1")))
+static bool is_valid_utf8_sse(const uint8_t *buf, size_t buf_len) {
+    const __m128i incomplete_max = _mm_loadu_si128((const __m128i*)&utf8_incomplete[16]);
+    __m128i error = _mm_setzero_si128();
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    uint8_t tail[16];
+    size_t i = 0;
+
+    for (;;) {
+        __m128i input;
+        if (i + 16 <= buf_len) {
+            input = _mm_loadu_si128((const __m128i*)&buf[i]);
+        } else if (i < buf_len) {
+            // Zero padding after the end flags any truncated character.
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, &buf[i], buf_len - i);
+            input = _mm_loadu_si128((const __m128i*)tail);
+        } else {
+            break;
+        }
+        i += 16;
+
+        // ASCII fast path. Only a character left open by the previous block 
+        // can make it invalid.
+        if (_mm_movemask_epi8(input) == 0) {
+            error = _mm_or_si128(error, prev_incomplete);
+            prev_incomplete = _mm_setzero_si128();
+        } else {
+            error = _mm_or_si128(error, utf8_block_sse(input, prev_input));
+            prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+        prev_input = input;
+
+        // Exit early on long strings.
+        if ((i & 1023) == 0 && !_mm_testz_si128(error, error)) {
+            return false;
+        }
+    }
+
+    error = _mm_or_si128(error, prev_incomplete);
+    return _mm_testz_si128(error, error);
+}
+
+// Errors in one 32 byte block, given the block before it.
+__attribute__((target("avx2")))
+static inline __m256i utf8_block_avx2(__m256i input, __m256i prev_input) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    // Shifting across lanes: 'shifted' is the high lane of prev_input followed
+    // by the low lane of input.
+    __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+    __m256i b1h = _mm256_shuffle_epi8(_mm256_load_si256((const __m256i*)utf8_byte_1_high),
+        _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i b1l = _mm256_shuffle_epi8(_mm256_load_si256((const __m256i*)utf8_byte_1_low),
+        _mm256_and_si256(prev1, nibble));
+    __m256i b2h = _mm256_shuffle_epi8(_mm256_load_si256((const __m256i*)utf8_byte_2_high),
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)0xDF));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)0xEF));
+    __m256i must23 = _mm256_cmpgt_epi8(_mm256_or_si256(third, fourth), _mm256_setzero_si256());
+    must23 = _mm256_and_si256(must23, _mm256_set1_epi8((char)0x80));
+
+    return _mm256_xor_si256(must23, special);
+}
+
+__attribute__((target("avx2")))
+static bool is_valid_utf8_avx2(const uint8_t *buf, size_t buf_len) {
+    const __m256i incomplete_max = _mm256_load_si256((const __m256i*)utf8_incomplete);
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    uint8_t tail[32];
+    size_t i = 0;
+
+    for (;;) {
+        __m256i input;
+        if (i + 32 <= buf_len) {
+            input = _mm256_loadu_si256((const __m256i*)&buf[i]);
+        } else if (i < buf_len) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, &buf[i], buf_len - i);
+            input = _mm256_loadu_si256((const __m256i*)tail);
+        } else {
+            break;
+        }
+        i += 32;
+
+        if (_mm256_movemask_epi8(input) == 0) {
+            error = _mm256_or_si256(error, prev_incomplete);
+            prev_incomplete = _mm256_setzero_si256();
+        } else {
+            error = _mm256_or_si256(error, utf8_block_avx2(input, prev_input));
+            prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+        }
+        prev_input = input;
+
+        if ((i & 1023) == 0 && !_mm256_testz_si256(error, error)) {
+            return false;
+        }
+    }
+
+    error = _mm256_or_si256(error, prev_incomplete);
+    return _mm256_testz_si256(error, error);
+}
+
+// 0 = portable, 1 = SSE4.1, 2 = AVX2
+static int utf8_simd_level(void) {
+    static int level = -1;
+    if (level < 0) {
+        level = __builtin_cpu_supports("avx2") ? 2 : __builtin_cpu_supports("sse4.1") ? 1 : 0;
+    }
+    return level;
+}
+
+#endif
+
+// Check whether a string is valid UTF-8
+bool is_valid_utf8(const uint8_t *buf, size_t buf_len) {
+
+    // Short strings (most struct keys) aren't worth the vector setup.
+#ifdef LTV_UTF8_X86
+    if (buf_len >= 16) {
+        int level = utf8_simd_level();
+        if (level == 2) {
+            return is_valid_utf8_avx2(buf, buf_len);
+        }
+        if (level == 1) {
+            return is_valid_utf8_sse(buf, buf_len);
+        }
+    }
+#endif
+    return is_valid_utf8_dfa(buf, buf_len);
+}
 #endif 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -280,10 +932,26 @@ bool is_valid_utf8(const uint8_t *buf, size_t buf_len) {
 ////////////////////////////////////////////////////////////////////////////////
 
 void ltv_decoder_init(ltv_decoder_t *d, const uint8_t* buf, size_t buf_len) {
+    ltv_decoder_init_validation(d, buf, buf_len, LTV_VALIDATE_FULL);
+}
+
+void ltv_decoder_init_validation(ltv_decoder_t *d, const uint8_t* buf, size_t buf_len, uint8_t validation) {
     d->buf = buf;
     d->buf_len = buf_len;
     d->idx = 0;
     d->nest_depth = 0;
+    d->validation = validation;
+}
+
+int ltv_validate_string(const ltv_data_t *data) {
+#ifdef LTV_VALIDATE_UTF_8
+    if (data->type_code == LTV_STRING && !is_valid_utf8(data->val.v_buffer, data->length)) {
+        return LTV_DECODE_INVALID_UTF8;
+    }
+#else
+    (void) data;
+#endif
+    return LTV_SUCCESS;
 }
 
 
@@ -293,166 +961,745 @@ bool is_out_of_bounds(size_t x, size_t y, size_t bound) {
     return sum < x || sum > bound;
 }
 
-int ltv_next(ltv_decoder_t *d, ltv_data_t *data) {
-    
-    // Load pass-through elements
-    int8_t i8;
-    int16_t i16;
-    int32_t i32;
-    int64_t i64;
+// Tag dispatch table. Every tag byte maps to what ltv_next has to do with it,
+// so decoding a tag is one lookup instead of a chain of type/size checks.
+#define LTV_TAG_INVALID  0  // Bad size code for the type
+#define LTV_TAG_NOP      1  // Padding, skipped
+#define LTV_TAG_NIL      2  // Standalone nil
+#define LTV_TAG_OPEN     3  // Struct or list start
+#define LTV_TAG_END      4  // Struct or list end
+#define LTV_TAG_UNSIGNED 5  // Single value, zero extended
+#define LTV_TAG_SIGNED   6  // Single value, sign extended
+#define LTV_TAG_CHAR     7  // Single string character, returned by reference
+#define LTV_TAG_VECTOR   8  // Vector payload, returned by reference
+#define LTV_TAG_STRING   9  // String payload, returned by reference
+
+typedef struct {
+    uint8_t kind;
+    // Payload size of a single value, or the width of a vector length field.
+    uint8_t size;
+    // 64 - 8 * size, used to extend a value read as a full 64 bit word.
+    uint8_t shift;
+    // Type size - 1. Vector lengths must not have any of these bits set.
+    uint8_t align;
+} ltv_tag_info_t;
+
+#define LTV_TAG_X {LTV_TAG_INVALID, 0, 0, 0}
+#define LTV_TAG_X5 LTV_TAG_X, LTV_TAG_X, LTV_TAG_X, LTV_TAG_X, LTV_TAG_X
+#define LTV_TAG_X10 LTV_TAG_X5, LTV_TAG_X5
+#define LTV_TAG_NOP_ENTRY {LTV_TAG_NOP, 0, 0, 0}
+
+// Struct, list, end and nil only have a single size code.
+#define LTV_TAG_ROW_STANDALONE(kind) {kind, 0, 0, 0}, LTV_TAG_X5, LTV_TAG_X10
+
+// Value types: a single value followed by the four vector length sizes.
+#define LTV_TAG_ROW(single, vector, n, last) \
+    {single, n, 64 - 8 * n, 0}, \
+    {vector, 1, 56, n - 1}, {vector, 2, 48, n - 1}, \
+    {vector, 4, 32, n - 1}, {vector, 8,  0, n - 1}, \
+    LTV_TAG_X10, last
+
+static const ltv_tag_info_t ltv_tag_table[256] = {
+    LTV_TAG_ROW_STANDALONE(LTV_TAG_NIL),
+    LTV_TAG_ROW_STANDALONE(LTV_TAG_OPEN),
+    LTV_TAG_ROW_STANDALONE(LTV_TAG_OPEN),
+    LTV_TAG_ROW_STANDALONE(LTV_TAG_END),
+    LTV_TAG_ROW(LTV_TAG_CHAR, LTV_TAG_STRING, 1, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_UNSIGNED, LTV_TAG_VECTOR, 1, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_UNSIGNED, LTV_TAG_VECTOR, 1, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_UNSIGNED, LTV_TAG_VECTOR, 2, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_UNSIGNED, LTV_TAG_VECTOR, 4, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_UNSIGNED, LTV_TAG_VECTOR, 8, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_SIGNED, LTV_TAG_VECTOR, 1, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_SIGNED, LTV_TAG_VECTOR, 2, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_SIGNED, LTV_TAG_VECTOR, 4, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_SIGNED, LTV_TAG_VECTOR, 8, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_UNSIGNED, LTV_TAG_VECTOR, 4, LTV_TAG_X),
+    LTV_TAG_ROW(LTV_TAG_UNSIGNED, LTV_TAG_VECTOR, 8, LTV_TAG_NOP_ENTRY),
+};
 
-    // Bounds check
-    if (d->idx == d->buf_len) {
-        return d->nest_depth == 0 ? LTV_DECODE_EOF : LTV_DECODE_UNEXPECTED_EOF;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define LTV_BIG_ENDIAN_HOST
+#endif
+
+// Read a value of t->size bytes in host byte order, zero extended to 64 bits.
+// 'avail' is the number of readable bytes at p, at least t->size.
+static inline uint64_t ltv_load(const uint8_t *p, size_t avail, const ltv_tag_info_t *t) {
+#ifdef LTV_BIG_ENDIAN_HOST
+    uint8_t u8; uint16_t u16; uint32_t u32; uint64_t u64;
+    (void)avail;
+    switch (t->size) {
+        case 1: memcpy(&u8, p, 1); return u8;
+        case 2: memcpy(&u16, p, 2); return u16;
+        case 4: memcpy(&u32, p, 4); return u32;
+        default: memcpy(&u64, p, 8); return u64;
+    }
+#else
+    uint64_t raw = 0;
+
+    // Load a whole word when the buffer allows, and shift out the extra bytes.
+    if (avail >= 8) {
+        memcpy(&raw, p, 8);
+        return (raw << t->shift) >> t->shift;
     }
+    memcpy(&raw, p, t->size);
+    return raw;
+#endif
+}
+
+// Skip a run of NOP tags starting at d->idx, a word at a time.
+static inline void ltv_skip_nops(ltv_decoder_t *d) {
+    static const uint64_t all_nops = ~(uint64_t)0;
+    uint64_t word;
 
-    // Skip NOP tags
-    while(d->buf[d->idx] == LTV_NOP_TAG) {
+    while (d->buf_len - d->idx >= 8) {
+        memcpy(&word, &d->buf[d->idx], 8);
+        if (word != all_nops) {
+            break;
+        }
+        d->idx += 8;
+    }
+    while (d->idx < d->buf_len && d->buf[d->idx] == LTV_NOP_TAG) {
         d->idx++;
-        if (d->idx == d->buf_len) {
-            return d->nest_depth == 0 ? LTV_DECODE_EOF : LTV_DECODE_UNEXPECTED_EOF;
+    }
+}
+
+// Inside a struct, keys and values alternate. The top of the stack holds
+// LTV_STRUCT when a key is expected and LTV_END when a value is.
+static inline int ltv_check_order(ltv_decoder_t *d, uint8_t type_code, bool *is_key) {
+    uint8_t *expect = &d->nest_stack[d->nest_depth-1];
+    if (*expect == LTV_STRUCT) {
+        if (type_code != LTV_STRING && type_code != LTV_END) {
+            return LTV_DECODE_INVALID_STRUCT_KEY;
+        }
+        *expect = LTV_END;
+        *is_key = true;
+    } else if (*expect == LTV_END) {
+        if (type_code == LTV_END) {
+            return LTV_DECODE_EXPECTED_STRUCT_VALUE;
         }
+        *expect = LTV_STRUCT;
     }
+    return LTV_SUCCESS;
+}
+
+#ifdef __GNUC__
+#define LTV_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define LTV_ALWAYS_INLINE inline
+#endif
+
+// Decode one element. Shared by ltv_next and the batch decoders, which call
+// it in a loop on a local copy of the decoder.
+static LTV_ALWAYS_INLINE int ltv_decode(ltv_decoder_t *d, ltv_data_t *data) {
+
+    // Bounds check
+    if (d->idx < d->buf_len && d->buf[d->idx] == LTV_NOP_TAG) {
+        ltv_skip_nops(d);
+    }
+    if (d->idx == d->buf_len) {
+        return d->nest_depth == 0 ? LTV_DECODE_EOF : LTV_DECODE_UNEXPECTED_EOF;
+    }
+
+    uint8_t tag = d->buf[d->idx++];
+    const ltv_tag_info_t *t = &ltv_tag_table[tag];
 
-    // Initialize the data element
-    memset(data, 0, sizeof(ltv_data_t));
-    data->type_code = d->buf[d->idx] >> 4;
-    data->size_code = d->buf[d->idx] & 0x0F;
-    d->idx++;
+    data->type_code = tag >> 4;
+    data->size_code = tag & 0x0F;
+    data->length = 0;
+    data->val.v_uint = 0;
 
-    // Validate size code
-    if (data->size_code > LTV_SIZE_8 || (data->type_code <= LTV_END && data->size_code != LTV_SINGLE)) {
+    if (t->kind == LTV_TAG_INVALID) {
         return LTV_DECODE_INVALID_SIZE_CODE;
     }
 
-    // Struct structure
-    if (d->nest_depth > 0) {
+    bool is_key = false;
+    if (d->nest_depth > 0 && d->validation != LTV_VALIDATE_TRUSTED) {
+        int status = ltv_check_order(d, data->type_code, &is_key);
+        if (status != LTV_SUCCESS) {
+            return status;
+        }
+    }
 
-        // Toggle struct/end tags to keep track of what is expected.
-        if (d->nest_stack[d->nest_depth-1] == LTV_STRUCT) {
-            if (data->type_code != LTV_STRING && data->type_code != LTV_END) {
-                return LTV_DECODE_INVALID_STRUCT_KEY;
+    size_t avail = d->buf_len - d->idx;
+    const uint8_t *p = &d->buf[d->idx];
+    uint64_t raw;
+
+    switch (t->kind) {
+        case LTV_TAG_UNSIGNED:
+            if (avail < t->size) {
+                return LTV_DECODE_UNEXPECTED_EOF;
             }
-            d->nest_stack[d->nest_depth-1] = LTV_END;
-        } else if (d->nest_stack[d->nest_depth-1] == LTV_END) {
-            if (data->type_code == LTV_END) {
-                return LTV_DECODE_EXPECTED_STRUCT_VALUE;
+            data->length = t->size;
+            data->val.v_uint = ltv_load(p, avail, t);
+            d->idx += t->size;
+            return LTV_SUCCESS;
+
+        case LTV_TAG_SIGNED:
+            if (avail < t->size) {
+                return LTV_DECODE_UNEXPECTED_EOF;
             }
-             d->nest_stack[d->nest_depth-1] = LTV_STRUCT;
-        }
+            data->length = t->size;
+            raw = ltv_load(p, avail, t);
+            data->val.v_int = (int64_t)(raw << t->shift) >> t->shift;
+            d->idx += t->size;
+            return LTV_SUCCESS;
+
+        case LTV_TAG_OPEN:
+            if (d->nest_depth >= LTV_MAX_NESTING_DEPTH) {
+                return LTV_DECODE_MAX_DEPTH_REACHED;
+            }
+            d->nest_stack[d->nest_depth++] = data->type_code;
+            return LTV_SUCCESS;
+
+        case LTV_TAG_END:
+            if (d->nest_depth == 0) {
+                return LTV_DECODE_NEST_MISMATCH;
+            }
+            d->nest_depth--;
+            return LTV_SUCCESS;
+
+        case LTV_TAG_NIL:
+            return LTV_SUCCESS;
+
+        case LTV_TAG_CHAR:
+            if (avail < 1) {
+                return LTV_DECODE_UNEXPECTED_EOF;
+            }
+            data->length = 1;
+            data->val.v_buffer = p;
+            d->idx++;
+            return LTV_SUCCESS;
+
+        default:
+            break;
     }
 
-    // Track struct/list nesting
-    if (data->type_code == LTV_STRUCT || data->type_code == LTV_LIST) {
-        if (d->nest_depth >= LTV_MAX_NESTING_DEPTH) {
-            return LTV_DECODE_MAX_DEPTH_REACHED;
-        }
-        d->nest_stack[d->nest_depth] = data->type_code;
-        d->nest_depth++;
+    // Vector (or string) payload. Check bounds for reading the length.
+    if (avail < t->size) {
+        return LTV_DECODE_UNEXPECTED_EOF;
     }
+    raw = ltv_load(p, avail, t);
+    avail -= t->size;
+
+    // The length must be a multiple of the type size, which is a power of two.
+    if ((raw & t->align) != 0 && d->validation != LTV_VALIDATE_TRUSTED) {
+        return LTV_DECODE_INVALID_VECTOR_LENGTH;
+    }
+
+    // Check to see if the full buffer has been loaded. Comparing against the
+    // remaining space can't overflow.
+    if (raw > avail) {
+        return LTV_DECODE_UNEXPECTED_EOF;
+    }
+
+    data->length = raw;
+    data->val.v_buffer = p + t->size;
+    d->idx += t->size + raw;
+
+    // UTF-8 string validation
+#ifdef LTV_VALIDATE_UTF_8
+    if (t->kind == LTV_TAG_STRING && 
+        (d->validation == LTV_VALIDATE_FULL || (d->validation == LTV_VALIDATE_KEYS && is_key)) &&
+        !is_valid_utf8(data->val.v_buffer, data->length)) {
+        return LTV_DECODE_INVALID_UTF8;
+    }
+#else
+    (void) is_key;
+#endif
 
-    // Pop nest element on an end tag.
-    if (data->type_code == LTV_END) {
-        if (d->nest_depth == 0) {
-            return LTV_DECODE_NEST_MISMATCH;
+    return LTV_SUCCESS;
+}
+
+int ltv_next(ltv_decoder_t *d, ltv_data_t *data) {
+    return ltv_decode(d, data);
+}
+
+// Batch decoding. Single numeric values, the bulk of most batches, are 
+// decoded inline with the position and struct state held in locals, since
+// stores to the output would otherwise force the decoder fields to be 
+// reloaded. Everything else, including every error, goes through 
+// ltv_decode, so the results match calling ltv_next repeatedly.
+static LTV_ALWAYS_INLINE int ltv_batch(ltv_decoder_t *d, ltv_data_t *out, const ltv_batch_t *soa,
+                                       size_t max, size_t *n) {
+    const uint8_t *buf = d->buf;
+    size_t buf_len = d->buf_len;
+    size_t idx = d->idx;
+    size_t depth = d->nest_depth;
+    bool trusted = d->validation == LTV_VALIDATE_TRUSTED;
+    int status = LTV_SUCCESS;
+    size_t i = 0;
+
+    // State of the innermost container, as in ltv_check_order. LTV_LIST also
+    // stands for the top level and the trusted policy, where nothing is tracked.
+    uint8_t expect = depth > 0 && !trusted ? d->nest_stack[depth-1] : LTV_LIST;
+
+    while (i < max) {
+        // The tag and a whole word must be readable.
+        if (buf_len - idx > 8 && expect != LTV_STRUCT) {
+            uint8_t tag = buf[idx];
+            const ltv_tag_info_t *t = &ltv_tag_table[tag];
+
+            if (t->kind == LTV_TAG_UNSIGNED || t->kind == LTV_TAG_SIGNED) {
+                uint64_t raw = ltv_load(&buf[idx + 1], 8, t);
+                if (t->kind == LTV_TAG_SIGNED) {
+                    raw = (uint64_t)((int64_t)(raw << t->shift) >> t->shift);
+                }
+                if (expect == LTV_END) {
+                    expect = LTV_STRUCT;
+                }
+
+                if (soa != NULL) {
+                    soa->tags[i] = tag;
+                    soa->offsets[i] = idx + 1;
+                    soa->lengths[i] = t->size;
+                } else {
+                    out[i].type_code = tag >> 4;
+                    out[i].size_code = tag & 0x0F;
+                    out[i].length = t->size;
+                    out[i].val.v_uint = raw;
+                }
+                idx += 1 + t->size;
+                i++;
+                continue;
+            }
         }
-        d->nest_depth--;
+
+        // Everything else
+        ltv_data_t data;
+        ltv_data_t *dst = soa != NULL ? &data : &out[i];
+
+        d->idx = idx;
+        if (depth > 0 && !trusted) {
+            d->nest_stack[depth-1] = expect;
+        }
+
+        status = ltv_decode(d, dst);
+
+        idx = d->idx;
+        depth = d->nest_depth;
+        expect = depth > 0 && !trusted ? d->nest_stack[depth-1] : LTV_LIST;
+
+        if (status != LTV_SUCCESS) {
+            break;
+        }
+
+        if (soa != NULL) {
+            soa->tags[i] = (dst->type_code << 4) | dst->size_code;
+            soa->lengths[i] = dst->length;
+            if (dst->type_code == LTV_STRING || dst->size_code != LTV_SINGLE) {
+                soa->offsets[i] = dst->val.v_buffer - buf;
+            } else {
+                soa->offsets[i] = idx - dst->length;
+            }
+        }
+        i++;
     }
 
-    // Standalone tag
-    if (data->type_code <= LTV_END) {
-        return LTV_SUCCESS;
+    d->idx = idx;
+    if (depth > 0 && !trusted) {
+        d->nest_stack[depth-1] = expect;
     }
+    *n = i;
+    return status;
+}
 
-    size_t typeSize = ltv_type_sizes[data->type_code];
+int ltv_next_batch(ltv_decoder_t *d, ltv_data_t *out, size_t max, size_t *n) {
+    return ltv_batch(d, out, NULL, max, n);
+}
 
-    // Process single element.
-    if (data->size_code == LTV_SINGLE) {
+int ltv_next_batch_soa(ltv_decoder_t *d, const ltv_batch_t *out, size_t max, size_t *n) {
+    return ltv_batch(d, NULL, out, max, n);
+}
 
-        data->length = typeSize;
-        if (is_out_of_bounds(d->idx, data->length, d->buf_len)) {
-            return LTV_DECODE_UNEXPECTED_EOF;
+// Skipping walks tags with the position and depth held in locals. Stores to
+// the uint8_t nest stack may alias the decoder fields, which would otherwise
+// force them to be reloaded on every tag.
+int ltv_skip(ltv_decoder_t *d) {
+    const uint8_t *buf = d->buf;
+    size_t buf_len = d->buf_len;
+    size_t idx = d->idx;
+    size_t depth = d->nest_depth;
+    size_t start_depth = depth;
+    bool trusted = d->validation == LTV_VALIDATE_TRUSTED;
+    int status = LTV_SUCCESS;
+
+    do {
+        while (idx < buf_len && buf[idx] == LTV_NOP_TAG) {
+            idx++;
+        }
+        if (idx == buf_len) {
+            status = depth == 0 ? LTV_DECODE_EOF : LTV_DECODE_UNEXPECTED_EOF;
+            break;
         }
 
-        memcpy(&data->val.v_raw, &d->buf[d->idx], data->length);
+        uint8_t tag = buf[idx++];
+        const ltv_tag_info_t *t = &ltv_tag_table[tag];
 
-        switch(data->type_code) {
-            case LTV_STRING:
-                data->val.v_buffer = &d->buf[d->idx];
-                break;
+        if (t->kind == LTV_TAG_INVALID) {
+            status = LTV_DECODE_INVALID_SIZE_CODE;
+            break;
+        }
 
-            // Integer types upsized with sign extension.
-            case LTV_I8:
-                memcpy(&i8, &d->buf[d->idx], data->length);
-                data->val.v_int = i8;
+        if (depth > 0 && !trusted) {
+            bool is_key = false;
+            d->nest_depth = depth;
+            status = ltv_check_order(d, tag >> 4, &is_key);
+            if (status != LTV_SUCCESS) {
                 break;
+            }
+        }
 
-            case LTV_I16:
-                memcpy(&i16, &d->buf[d->idx], data->length);
-                data->val.v_int = i16;
-                break;
+        size_t avail = buf_len - idx;
 
-            case LTV_I32:
-                memcpy(&i32, &d->buf[d->idx], data->length);
-                data->val.v_int = i32;
+        if (t->kind == LTV_TAG_OPEN) {
+            if (depth >= LTV_MAX_NESTING_DEPTH) {
+                status = LTV_DECODE_MAX_DEPTH_REACHED;
                 break;
-
-            case LTV_I64:
-                memcpy(&i64, &d->buf[d->idx], data->length);
-                data->val.v_int = i64;
+            }
+            d->nest_stack[depth++] = tag >> 4;
+        } else if (t->kind == LTV_TAG_END) {
+            if (depth == 0) {
+                status = LTV_DECODE_NEST_MISMATCH;
                 break;
-
-            case LTV_F32:
-                memcpy(&data->val.v_float32, &d->buf[d->idx], data->length);
+            }
+            depth--;
+        } else if (t->kind == LTV_TAG_VECTOR || t->kind == LTV_TAG_STRING) {
+            if (avail < t->size) {
+                status = LTV_DECODE_UNEXPECTED_EOF;
                 break;
-
-            case LTV_F64:
-                memcpy(&data->val.v_float64, &d->buf[d->idx], data->length);
+            }
+            uint64_t len = ltv_load(&buf[idx], avail, t);
+            if ((len & t->align) != 0 && !trusted) {
+                status = LTV_DECODE_INVALID_VECTOR_LENGTH;
                 break;
-
-            default:
-                // Everything else is copied across to the raw buffer backing the union
-                memcpy(&data->val.v_raw, &d->buf[d->idx], data->length);
+            }
+            if (len > avail - t->size) {
+                status = LTV_DECODE_UNEXPECTED_EOF;
                 break;
+            }
+            idx += t->size + len;
+        } else {
+            // Single values, and nil with a size of 0.
+            if (avail < t->size) {
+                status = LTV_DECODE_UNEXPECTED_EOF;
+                break;
+            }
+            idx += t->size;
         }
+    } while (depth > start_depth);
 
-        d->idx += data->length;
-        return LTV_SUCCESS;
-    } 
+    d->idx = idx;
+    d->nest_depth = depth;
+    return status;
+}
 
-    int lenSize = 1 << (data->size_code - LTV_SIZE_1);
+////////////////////////////////////////////////////////////////////////////////
+// Stream Decoder
+////////////////////////////////////////////////////////////////////////////////
 
-    // Check bounds for reading the buffer length
-    if (is_out_of_bounds(d->idx, lenSize, d->buf_len)){
-        return LTV_DECODE_UNEXPECTED_EOF;
+void ltv_stream_init(ltv_stream_decoder_t *s, uint8_t *carry, size_t carry_size, uint8_t validation) {
+    ltv_decoder_init_validation(&s->decoder, NULL, 0, validation);
+    s->chunk = NULL;
+    s->chunk_len = 0;
+    s->chunk_idx = 0;
+    s->carry = carry;
+    s->carry_size = carry_size;
+    s->carry_len = 0;
+    s->finished = false;
+}
+
+void ltv_stream_feed(ltv_stream_decoder_t *s, const uint8_t *chunk, size_t len) {
+    s->chunk = chunk;
+    s->chunk_len = len;
+    s->chunk_idx = 0;
+}
+
+void ltv_stream_finish(ltv_stream_decoder_t *s) {
+    s->finished = true;
+}
+
+// Bytes still missing from the value in the carry buffer. While a vector 
+// length is incomplete, only the bytes needed to read it are counted.
+static size_t ltv_carry_needed(const ltv_stream_decoder_t *s) {
+    const ltv_tag_info_t *t = &ltv_tag_table[s->carry[0]];
+    size_t have = s->carry_len;
+    size_t total = 1;
+
+    if (t->kind == LTV_TAG_VECTOR || t->kind == LTV_TAG_STRING) {
+        if (have < 1 + (size_t)t->size) {
+            return 1 + t->size - have;
+        }
+        uint64_t len = ltv_load(&s->carry[1], have - 1, t);
+        if (len > SIZE_MAX - 16) {
+            return SIZE_MAX;
+        }
+        total += t->size + len;
+    } else if (t->kind != LTV_TAG_INVALID) {
+        total += t->size;
     }
 
-    // Pick up the length
-    memcpy(&data->length, &d->buf[d->idx], lenSize);
-    d->idx += lenSize;
+    return total > have ? total - have : 0;
+}
 
-    // Check buffer length to make sure it is suitable for the contained datatype.
-    // Because typeSize is divisible by 2, subtracting 1 gives exactly the bitmask 
-    // needed to test if data->length is evenly divisible by typeSize.
-    if ((data->length & (typeSize-1)) != 0) {
-        return LTV_DECODE_INVALID_VECTOR_LENGTH;
+size_t ltv_stream_needed(const ltv_stream_decoder_t *s) {
+    if (s->carry_len > 0) {
+        return ltv_carry_needed(s);
     }
+    return s->chunk_idx < s->chunk_len ? 0 : 1;
+}
 
-    // Check to see if the full buffer has been loaded
-    if (is_out_of_bounds(d->idx, data->length , d->buf_len)) {
-        return LTV_DECODE_UNEXPECTED_EOF;
+int ltv_stream_next(ltv_stream_decoder_t *s, ltv_data_t *data) {
+    ltv_decoder_t *d = &s->decoder;
+
+    // Complete a value carried over from the previous chunk, then decode it
+    // from the carry buffer.
+    if (s->carry_len > 0) {
+        size_t needed;
+        while ((needed = ltv_carry_needed(s)) > 0) {
+            if (needed > s->carry_size - s->carry_len) {
+                return LTV_DECODE_CARRY_FULL;
+            }
+            size_t avail = s->chunk_len - s->chunk_idx;
+            if (avail == 0) {
+                return s->finished ? LTV_DECODE_UNEXPECTED_EOF : LTV_DECODE_NEED_DATA;
+            }
+            size_t n = needed < avail ? needed : avail;
+            memcpy(&s->carry[s->carry_len], &s->chunk[s->chunk_idx], n);
+            s->carry_len += n;
+            s->chunk_idx += n;
+        }
+
+        d->buf = s->carry;
+        d->buf_len = s->carry_len;
+        d->idx = 0;
+        s->carry_len = 0;
+        return ltv_decode(d, data);
     }
 
-    // Take a reference to the vector within the buffer.
-    data->val.v_buffer = &d->buf[d->idx];
-    d->idx += data->length;
+    d->buf = s->chunk;
+    d->buf_len = s->chunk_len;
+    d->idx = s->chunk_idx;
 
-    // UTF-8 string validation
-#ifdef LTV_VALIDATE_UTF_8
-    if (data->type_code == LTV_STRING && !is_valid_utf8(data->val.v_buffer, data->length)) {
-        return LTV_DECODE_INVALID_UTF8;
+    // A value cut off by the end of the chunk changes at most the position
+    // and the struct key/value state before it fails.
+    size_t start = d->idx;
+    size_t depth = d->nest_depth;
+    uint8_t expect = depth > 0 ? d->nest_stack[depth-1] : 0;
+
+    int status = ltv_decode(d, data);
+    s->chunk_idx = d->idx;
+
+    if (s->finished || (status != LTV_DECODE_EOF && status != LTV_DECODE_UNEXPECTED_EOF)) {
+        return status;
+    }
+
+    d->idx = start;
+    if (depth > 0) {
+        d->nest_stack[depth-1] = expect;
+    }
+    while (d->idx < d->buf_len && d->buf[d->idx] == LTV_NOP_TAG) {
+        d->idx++;
+    }
+
+    // Carry the partial value.
+    size_t tail = d->buf_len - d->idx;
+    if (tail > s->carry_size) {
+        s->chunk_idx = d->idx;
+        return LTV_DECODE_CARRY_FULL;
+    }
+    if (tail > 0) {
+        memcpy(s->carry, &d->buf[d->idx], tail);
+    }
+    s->carry_len = tail;
+    s->chunk_idx = d->buf_len;
+    return LTV_DECODE_NEED_DATA;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reader Decoder
+////////////////////////////////////////////////////////////////////////////////
+
+void ltv_reader_init(ltv_reader_decoder_t *r, ltv_reader reader, void *user_data,
+                     uint8_t *buf, size_t buf_size, size_t threshold, uint8_t validation) {
+    ltv_decoder_init_validation(&r->decoder, buf, 0, validation);
+    r->reader = reader;
+    r->user_data = user_data;
+    r->buf = buf;
+    r->buf_size = buf_size;
+    r->pos = 0;
+    r->len = 0;
+    r->eof = false;
+    r->threshold = threshold;
+    r->payload_remaining = 0;
+    r->payload_type_size = 1;
+    r->error = 0;
+}
+
+// Read until at least 'count' bytes are buffered, or the input ends.
+// Returns LTV_SUCCESS even if the input ended first.
+static int ltv_reader_fill(ltv_reader_decoder_t *r, size_t count) {
+    if (count > r->buf_size) {
+        return LTV_DECODE_CARRY_FULL;
+    }
+
+    if (r->pos + count > r->buf_size) {
+        memmove(r->buf, &r->buf[r->pos], r->len - r->pos);
+        r->len -= r->pos;
+        r->pos = 0;
+    }
+
+    while (r->len - r->pos < count && !r->eof) {
+        size_t n = 0;
+        r->error = r->reader(&r->buf[r->len], r->buf_size - r->len, &n, r->user_data);
+        if (r->error != 0) {
+            return LTV_DECODE_READ_ERROR;
+        }
+        r->eof = n == 0;
+        r->len += n;
+    }
+    return LTV_SUCCESS;
+}
+
+// Read streamed payload into 'dst', or discard it if 'dst' is NULL.
+static int ltv_reader_consume(ltv_reader_decoder_t *r, uint8_t *dst, size_t count) {
+    // Buffered bytes first
+    size_t n = r->len - r->pos < count ? r->len - r->pos : count;
+    if (dst != NULL) {
+        memcpy(dst, &r->buf[r->pos], n);
+        dst += n;
+    }
+    r->pos += n;
+    count -= n;
+    r->payload_remaining -= n;
+
+    // Then straight into the destination, or through the read buffer when
+    // discarding.
+    while (count > 0) {
+        if (r->eof) {
+            return LTV_DECODE_UNEXPECTED_EOF;
+        }
+
+        uint8_t *into = dst != NULL ? dst : r->buf;
+        size_t want = dst != NULL || count < r->buf_size ? count : r->buf_size;
+        r->pos = r->len = 0;
+        r->error = r->reader(into, want, &n, r->user_data);
+        if (r->error != 0) {
+            return LTV_DECODE_READ_ERROR;
+        }
+        r->eof = n == 0;
+        if (dst != NULL) {
+            dst += n;
+        }
+        count -= n;
+        r->payload_remaining -= n;
+    }
+    return LTV_SUCCESS;
+}
+
+int ltv_reader_payload(ltv_reader_decoder_t *r, void *dst, size_t max, size_t *n) {
+    if (r->payload_remaining > 0 && max < r->payload_type_size) {
+        return LTV_DECODE_PAYLOAD_TOO_SMALL;
+    }
+
+    size_t count = max < r->payload_remaining ? max : r->payload_remaining;
+    count -= count % r->payload_type_size;
+    int status = ltv_reader_consume(r, dst, count);
+    if (status == LTV_SUCCESS) {
+        *n = count;
+    }
+    return status;
+}
+
+int ltv_reader_next(ltv_reader_decoder_t *r, ltv_data_t *data) {
+    ltv_decoder_t *d = &r->decoder;
+    int status;
+
+    // Skip whatever is left of a streamed payload.
+    if (r->payload_remaining > 0) {
+        status = ltv_reader_consume(r, NULL, r->payload_remaining);
+        if (status != LTV_SUCCESS) {
+            return status;
+        }
+    }
+
+    // NOPs, then the tag.
+    for (;;) {
+        if ((status = ltv_reader_fill(r, 1)) != LTV_SUCCESS) {
+            return status;
+        }
+        while (r->pos < r->len && r->buf[r->pos] == LTV_NOP_TAG) {
+            r->pos++;
+        }
+        if (r->pos < r->len || r->eof) {
+            break;
+        }
+    }
+
+    // Buffer the whole value, or just the header of a large vector.
+    size_t need = 1;
+    bool streamed = false;
+    const ltv_tag_info_t *t = NULL;
+    uint64_t len = 0;
+
+    if (r->pos < r->len) {
+        t = &ltv_tag_table[r->buf[r->pos]];
+        if (t->kind == LTV_TAG_VECTOR || t->kind == LTV_TAG_STRING) {
+            need += t->size;
+            if ((status = ltv_reader_fill(r, need)) != LTV_SUCCESS) {
+                return status;
+            }
+            if (r->len - r->pos >= need) {
+                len = ltv_load(&r->buf[r->pos + 1], r->len - r->pos - 1, t);
+                streamed = t->kind == LTV_TAG_VECTOR && len > r->threshold;
+                if (!streamed) {
+                    if (len > r->buf_size) {
+                        return LTV_DECODE_CARRY_FULL;
+                    }
+                    need += len;
+                }
+            }
+        } else if (t->kind != LTV_TAG_INVALID) {
+            need += t->size;
+        }
+        if ((status = ltv_reader_fill(r, need)) != LTV_SUCCESS) {
+            return status;
+        }
+    }
+
+    if (!streamed) {
+        // Decode in place. A short buffer here means the input ended.
+        d->buf = &r->buf[r->pos];
+        d->buf_len = r->len - r->pos < need ? r->len - r->pos : need;
+        d->idx = 0;
+        status = ltv_decode(d, data);
+        r->pos += d->idx;
+        return status;
+    }
+
+    // Report the header of a streamed vector, with the checks ltv_next
+    // makes before it reaches the payload.
+    uint8_t tag = r->buf[r->pos];
+    data->type_code = tag >> 4;
+    data->size_code = tag & 0x0F;
+    data->length = len;
+    data->val.v_uint = 0;
+    data->val.v_buffer = NULL;
+
+    if (d->validation != LTV_VALIDATE_TRUSTED) {
+        if (d->nest_depth > 0) {
+            bool is_key = false;
+            if ((status = ltv_check_order(d, data->type_code, &is_key)) != LTV_SUCCESS) {
+                return status;
+            }
+        }
+        if ((len & t->align) != 0) {
+            return LTV_DECODE_INVALID_VECTOR_LENGTH;
+        }
     }
-#endif
 
+    r->pos += need;
+    r->payload_remaining = len;
+    r->payload_type_size = t->align + 1;
     return LTV_SUCCESS;
 }
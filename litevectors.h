@@ -5,6 +5,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Configurations
 ////////////////////////////////////////////////////////////////////////////////
@@ -42,6 +46,9 @@
 #define LTV_F32      14
 #define LTV_F64      15
 
+// Element size in bytes for each type code, 0 for the container types.
+extern const uint8_t ltv_type_sizes[16];
+
 // Buffer Lengths
 #define LTV_SINGLE    0
 #define LTV_SIZE_1    1
@@ -65,6 +72,53 @@
 // The encoder will store the value in its 'status' field.
 typedef int (*ltv_writer)(const uint8_t *buf, size_t len, void* user_data);
 
+// Status set by a memory encoder when its output buffer is full.
+#define LTV_ENCODE_BUFFER_FULL  -1
+
+// A segment of output for a gather writer. The layout matches POSIX struct iovec.
+typedef struct {
+    const void *base;
+    size_t len;
+} ltv_iovec_t;
+
+// Function provided by the client that writes a batch of output segments, in
+// order, for a gather encoder (see ltv_encoder_init_gather). As with ltv_writer,
+// all bytes must be written before returning, and a non-zero return value is
+// stored in the encoder's 'status' field.
+typedef int (*ltv_gather_writer)(const ltv_iovec_t *iov, size_t iov_count, void* user_data);
+
+// Function provided by the client to overwrite 'len' bytes that were written
+// earlier at stream offset 'offset' (the encoder's 'offset' at the time). 
+// This is used to fill in the length of vectors started with 
+// ltv_vector_begin_unsized once their data has been written.
+// Returns 0 on success, any other value is stored in the encoder's 'status'.
+typedef int (*ltv_patcher)(size_t offset, const uint8_t *buf, size_t len, void* user_data);
+
+// Status set when the data given to an incremental vector doesn't match its count.
+#define LTV_ENCODE_VECTOR_LENGTH  -2
+
+// Status set when written data must be patched, but the output is no longer
+// held by the encoder and no ltv_patcher was set.
+#define LTV_ENCODE_NOT_SEEKABLE   -3
+
+// Status set by ltv_encoder_init_gather when the stage or iov array is below
+// its minimum size.
+#define LTV_ENCODE_GATHER_BUFFERS -6
+
+// The position of a vector whose alignment padding depends on its offset,
+// recorded by fragment encoders (see ltv_fragment_init).
+typedef struct {
+    // Offset of the vector's tag
+    size_t offset;
+
+    // Number of NOPs inserted before the tag
+    size_t padding;
+} ltv_align_record_t;
+
+// Writes shorter than this are copied into the staging buffer of a gather
+// encoder, longer ones are passed to the writer by reference.
+#define LTV_GATHER_COPY_LIMIT  128
+
 typedef struct {
     // A user supplied write function.
     ltv_writer writer;
@@ -73,16 +127,101 @@ typedef struct {
     void *user_data;
 
     // Current offset in the stream.
+    // This counts every byte handed to the encoder, including bytes that
+    // are still held in the staging buffer and have not reached the writer.
     size_t offset;
 
     // Holds the first non-zero status code returned from writer.
     int status;
+
+    // Optional staging buffer (see ltv_encoder_init_buffered).
+    uint8_t *stage;
+    size_t stage_size;
+    size_t stage_len;
+
+    // Output window of a memory encoder (see ltv_encoder_init_memory).
+    uint8_t *cursor;
+    uint8_t *end;
+
+    // Pending segments of a gather encoder (see ltv_encoder_init_gather).
+    ltv_gather_writer gather_writer;
+    ltv_iovec_t *iov;
+    size_t iov_size;
+    size_t iov_len;
+
+    // Optional function to patch written output (see ltv_encoder_set_patcher).
+    ltv_patcher patcher;
+
+    // Incremental vector in progress (see ltv_vector_begin).
+    uint8_t vec_state;
+    uint8_t vec_type;
+    size_t vec_start;
+    size_t vec_remaining;
+
+    // Vector alignment records of a fragment encoder (see ltv_fragment_init).
+    ltv_align_record_t *align_records;
+    size_t align_records_size;
+    size_t align_records_len;
 } ltv_encoder_t;
 
 // Initialize an encoder with a ltv_writer callback function.
 // 'user_data' is passed to the ltv_writer function. 
 void ltv_encoder_init(ltv_encoder_t *e, ltv_writer writer, void* user_data);
 
+// Initialize an encoder that collects output in a caller supplied staging
+// buffer, only calling 'writer' when the buffer fills or on ltv_flush().
+// Tags, lengths, scalars and padding are batched together; writes that are
+// at least as large as the staging buffer are passed straight to the writer
+// after any staged bytes.
+//
+// Because staged bytes are written later, a writer error may be reported
+// in 'status' by a later call than the one that produced the data. Once
+// 'status' is non-zero, all further output is discarded.
+void ltv_encoder_init_buffered(ltv_encoder_t *e, ltv_writer writer, void* user_data, 
+                               uint8_t *stage, size_t stage_size);
+
+// Initialize an encoder that writes directly into a contiguous buffer,
+// without a writer callback. 'cursor' points at the next free byte, and
+// 'offset' holds the number of bytes written. If the buffer is too small,
+// 'status' is set to LTV_ENCODE_BUFFER_FULL and the output is incomplete.
+// See litevectors_mem.h for inline versions of the encoding functions.
+//
+// Like snprintf, passing a NULL 'buf' creates a measuring encoder.
+void ltv_encoder_init_memory(ltv_encoder_t *e, uint8_t *buf, size_t buf_len);
+
+// Initialize a measuring encoder. Nothing is written, but 'offset' counts
+// the exact number of bytes that encoding would produce, including alignment
+// NOPs. The count can be used to size a buffer for the real encode, which
+// produces identical output as long as it also starts at offset 0.
+void ltv_encoder_init_measure(ltv_encoder_t *e);
+
+// Initialize an encoder that hands its output to 'writer' as batches of
+// segments, so that vector payloads are never copied. Tags, lengths and small
+// values are copied into the 'stage' buffer; writes of LTV_GATHER_COPY_LIMIT
+// bytes or more (typically vector payloads) are referenced in place.
+// A batch is written when 'stage' or the 'iov' array fills, or on ltv_flush().
+//
+// Referenced payload memory is read by the writer at some later point, so it
+// must stay valid and unchanged until the next ltv_flush() returns.
+//
+// 'stage_size' must be at least LTV_GATHER_COPY_LIMIT, so that every copied
+// write fits, and 'iov_size' at least 2. Smaller buffers set 'status' to
+// LTV_ENCODE_GATHER_BUFFERS and nothing is written.
+void ltv_encoder_init_gather(ltv_encoder_t *e, ltv_gather_writer writer, void* user_data,
+                             uint8_t *stage, size_t stage_size, ltv_iovec_t *iov, size_t iov_size);
+
+// Set a function used to overwrite output that has already been passed to the
+// writer. The patcher receives the encoder's 'user_data'. 
+void ltv_encoder_set_patcher(ltv_encoder_t *e, ltv_patcher patcher);
+
+// Pass any staged bytes to the writer. This must be called after the last
+// value has been encoded with a buffered or gather encoder. Returns the 
+// encoder status. On an unbuffered encoder this does nothing.
+int ltv_flush(ltv_encoder_t *e);
+
+// Write raw bytes to an encoder.
+void ltv_write(ltv_encoder_t *e, const uint8_t *buf, size_t count);
+
 // Write single values to an encoder.
 void ltv_nil(ltv_encoder_t *e);
 void ltv_bool(ltv_encoder_t *e, bool val);
@@ -105,8 +244,29 @@ void ltv_list_end(ltv_encoder_t *e);
 // Generic vector writer
 void ltv_write_vector(ltv_encoder_t *e, uint8_t type_code, const uint8_t* buf, size_t count);
 
+// Incremental vector writer
+//
+// Writes a vector whose elements are supplied in pieces, for data that is not
+// in one contiguous array. Begin the vector, append elements, then end it.
+// No other values may be written while a vector is open.
+//
+// With ltv_vector_begin the element count is given up front, and the output 
+// is identical to ltv_write_vector. Appending more or fewer elements than
+// declared sets 'status' to LTV_ENCODE_VECTOR_LENGTH.
+//
+// With ltv_vector_begin_unsized the count is not known in advance. An 8 byte
+// length is reserved and filled in by ltv_vector_end. Memory encoders patch 
+// it directly; bytes still in a buffered or gather encoder's stage are patched
+// in place; otherwise the patcher set with ltv_encoder_set_patcher is used.
+// If none is available 'status' is set to LTV_ENCODE_NOT_SEEKABLE.
+void ltv_vector_begin(ltv_encoder_t *e, uint8_t type_code, size_t count);
+void ltv_vector_begin_unsized(ltv_encoder_t *e, uint8_t type_code);
+void ltv_vector_append(ltv_encoder_t *e, const void *buf, size_t count);
+void ltv_vector_end(ltv_encoder_t *e);
+
 // Typed wrappers for ltv_write_vector
 void ltv_string(ltv_encoder_t *e, const char* val);
+void ltv_string_n(ltv_encoder_t *e, const char* val, size_t len);
 void ltv_bool_vec(ltv_encoder_t *e, bool *val, size_t count);
 void ltv_i8_vec(ltv_encoder_t *e, int8_t *val, size_t count);
 void ltv_i16_vec(ltv_encoder_t *e, int16_t *val, size_t count);
@@ -119,6 +279,69 @@ void ltv_u64_vec(ltv_encoder_t *e, uint64_t *val, size_t count);
 void ltv_f32_vec(ltv_encoder_t *e, float *val, size_t count);
 void ltv_f64_vec(ltv_encoder_t *e, double *val, size_t count);
 
+// Fragments
+//
+// Vector alignment padding depends on the absolute stream offset, so encoded
+// output can't simply be concatenated. A fragment is a piece of encoded output
+// (typically a complete value such as a struct) that records where its aligned
+// vectors are. It can be encoded independently, e.g. on another thread, and
+// then spliced into an encoder at any offset. Splicing adjusts the padding,
+// so the result is identical to encoding the values directly.
+typedef struct {
+    // Encode the fragment's values with this memory encoder.
+    ltv_encoder_t encoder;
+
+    // Start of the fragment's output buffer.
+    uint8_t *buf;
+} ltv_fragment_t;
+
+// Initialize a fragment that encodes into 'buf', recording up to 
+// 'records_size' vectors that need alignment (vectors of strings, bools,
+// u8 and i8 don't). If either the buffer or the records run out, the
+// fragment encoder's status is set to LTV_ENCODE_BUFFER_FULL.
+void ltv_fragment_init(ltv_fragment_t *f, uint8_t *buf, size_t buf_len, 
+                       ltv_align_record_t *records, size_t records_size);
+
+// Write a fragment to an encoder. If the fragment's encoder failed, its
+// status is copied to 'e'. Splicing into another fragment is supported.
+void ltv_fragment_splice(ltv_encoder_t *e, const ltv_fragment_t *f);
+
+// Pre-encoded keys
+//
+// A ltv_key_t holds the complete encoding (tag, length and bytes) of a short
+// string that is written often, such as a struct key. Strings never need
+// alignment padding, so the encoding is the same at any offset, and ltv_key
+// emits it with a single write.
+
+// Longest string a ltv_key_t can hold. This must be less than INT8_MAX so 
+// the length is encoded in a single byte, matching ltv_string.
+#ifndef LTV_KEY_MAX_LEN
+#define LTV_KEY_MAX_LEN 62
+#endif
+
+// 'str' has room for a literal's terminator, which C++ requires to fit.
+typedef struct {
+    uint8_t tag;
+    uint8_t len;
+    char str[LTV_KEY_MAX_LEN + 1];
+} ltv_key_t;
+
+// Build a ltv_key_t initializer from a string literal at compile time.
+// Literals longer than LTV_KEY_MAX_LEN fail to compile.
+//     static const ltv_key_t KEY_NAME = LTV_KEY("Name");
+#define LTV_KEY(s) { \
+    (LTV_STRING << 4) | LTV_SIZE_1, \
+    sizeof(s) - 1 + 0 * sizeof(char[sizeof(s) - 1 <= LTV_KEY_MAX_LEN ? 1 : -1]), \
+    s \
+}
+
+// Initialize a key from a string at run time.
+// Returns false if the string is longer than LTV_KEY_MAX_LEN.
+bool ltv_key_init(ltv_key_t *key, const char *str);
+
+// Write a pre-encoded key. The output is identical to ltv_string.
+void ltv_key(ltv_encoder_t *e, const ltv_key_t *key);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Decoder
 ////////////////////////////////////////////////////////////////////////////////
@@ -153,6 +376,35 @@ void ltv_f64_vec(ltv_encoder_t *e, double *val, size_t count);
 // An unexpected END tag was found.
 #define LTV_DECODE_NEST_MISMATCH           9
 
+// A stream decoder needs the next chunk of input before it can continue.
+#define LTV_DECODE_NEED_DATA              11
+
+// A value split across chunks is too large for the stream carry buffer.
+#define LTV_DECODE_CARRY_FULL             12
+
+// A reader callback returned an error. See the decoder's error field.
+#define LTV_DECODE_READ_ERROR             13
+
+// ltv_reader_payload was given room for less than one element.
+#define LTV_DECODE_PAYLOAD_TOO_SMALL      17
+
+// Status codes of the optional modules are kept here so that they stay
+// distinct, and ltv_status_text can name them.
+
+// ltv_index_build ran out of entries (litevectors_index.h).
+#define LTV_INDEX_FULL                    10
+
+// ltv_query_compile couldn't parse a path (litevectors_query.h).
+#define LTV_QUERY_INVALID_PATH            14
+
+// A value can't be stored in its struct field: a string for a number, say
+// (litevectors_schema.h).
+#define LTV_SCHEMA_TYPE_MISMATCH          15
+
+// A value is out of range for its struct field, or a vector, string or list
+// is longer than the field's array (litevectors_schema.h).
+#define LTV_SCHEMA_RANGE                  16
+
 // The maximum struct/list nesting depth supported.
 #define LTV_MAX_NESTING_DEPTH             32
 
@@ -171,18 +423,187 @@ typedef struct {
     } val;
 } ltv_data_t;
 
+// Decoder validation policies.
+//
+// Check everything: structure, and UTF-8 in every string (when compiled 
+// with LTV_VALIDATE_UTF_8). This is the default.
+#define LTV_VALIDATE_FULL                  0
+
+// Validate UTF-8 in struct keys only. Call ltv_validate_string on string 
+// values that need it.
+#define LTV_VALIDATE_KEYS                  1
+
+// Check structure, but leave all UTF-8 validation to ltv_validate_string
+// when a string is actually used.
+#define LTV_VALIDATE_DEFERRED              2
+
+// For data this program wrote itself. Skips UTF-8 validation, struct 
+// key/value ordering and vector length multiple checks. Bounds, tag and
+// nesting checks are kept, so bad input still can't cause reads outside
+// the buffer.
+#define LTV_VALIDATE_TRUSTED               3
+
 typedef struct {
     const uint8_t *buf;
     size_t buf_len;
     size_t idx;
     uint8_t nest_stack[LTV_MAX_NESTING_DEPTH];
     size_t nest_depth;
+    uint8_t validation;
 } ltv_decoder_t;
 
-// Initialize a decoder for a buffer of data.
+// Initialize a decoder for a buffer of data, with full validation.
 void ltv_decoder_init(ltv_decoder_t *d, const uint8_t* buf, size_t buf_len);
 
+// Initialize a decoder with one of the LTV_VALIDATE_* policies.
+void ltv_decoder_init_validation(ltv_decoder_t *d, const uint8_t* buf, size_t buf_len, uint8_t validation);
+
+// Decode up to 'max' values into 'out', setting 'n' to the number decoded.
+// Returns LTV_SUCCESS when all 'max' were decoded, otherwise the status of
+// the ltv_next call that would have stopped, with the decoder left in the 
+// same state.
+int ltv_next_batch(ltv_decoder_t *d, ltv_data_t *out, size_t max, size_t *n);
+
+// Struct of arrays output for ltv_next_batch_soa. Each array holds 'max' 
+// elements.
+typedef struct {
+    // Tag byte, type_code << 4 | size_code.
+    uint8_t *tags;
+
+    // Offset of the payload in the buffer: the value for single elements,
+    // the data for vectors and strings. Just past the tag for the rest.
+    size_t *offsets;
+
+    // Payload length in bytes.
+    size_t *lengths;
+} ltv_batch_t;
+
+// As ltv_next_batch, but recording where each value is rather than 
+// decoding it.
+int ltv_next_batch_soa(ltv_decoder_t *d, const ltv_batch_t *out, size_t max, size_t *n);
+
+// Skip the next value without decoding it. A struct or list start skips the
+// whole container, up to and including its end tag. Vector payloads are 
+// jumped over, and strings are never checked for UTF-8. Structure is still
+// checked unless the decoder uses LTV_VALIDATE_TRUSTED.
+// Returns LTV_SUCCESS, LTV_DECODE_EOF at the end of the buffer, or an error.
+int ltv_skip(ltv_decoder_t *d);
+
+// Check that a decoded string is valid UTF-8, for use with the keys-only,
+// deferred and trusted policies. Returns LTV_SUCCESS for other types, or 
+// when compiled without LTV_VALIDATE_UTF_8.
+int ltv_validate_string(const ltv_data_t *data);
+
 // Get the next value from a LiteVector stream.
 int ltv_next(ltv_decoder_t *d, ltv_data_t *data);
 
+////////////////////////////////////////////////////////////////////////////////
+// Stream Decoder
+//
+// Decodes input that arrives in chunks, such as socket reads. Values are 
+// decoded in place in each chunk. When a value is cut off by the end of a
+// chunk, decoding rolls back to its tag and only that tail is copied into a
+// carry buffer, where the value is completed from the following chunk(s).
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+    ltv_decoder_t decoder;
+
+    // The current chunk, and the read position in it.
+    const uint8_t *chunk;
+    size_t chunk_len;
+    size_t chunk_idx;
+
+    // Start of a value split across chunks.
+    uint8_t *carry;
+    size_t carry_size;
+    size_t carry_len;
+
+    bool finished;
+} ltv_stream_decoder_t;
+
+// Initialize a stream decoder. The carry buffer must be at least as large
+// as the largest value (tag, length and payload) that may straddle chunks.
+void ltv_stream_init(ltv_stream_decoder_t *s, uint8_t *carry, size_t carry_size, uint8_t validation);
+
+// Supply the next chunk of input, once ltv_stream_next has returned 
+// LTV_DECODE_NEED_DATA. By then the previous chunk has been consumed and
+// may be reused.
+void ltv_stream_feed(ltv_stream_decoder_t *s, const uint8_t *chunk, size_t len);
+
+// Mark the end of input. Afterwards ltv_stream_next reports LTV_DECODE_EOF or
+// LTV_DECODE_UNEXPECTED_EOF at the end, as ltv_next does.
+void ltv_stream_finish(ltv_stream_decoder_t *s);
+
+// Get the next value. Returns LTV_DECODE_NEED_DATA when the current chunk 
+// is used up. Buffers in values point into the current chunk, or into the
+// carry buffer until the next call.
+int ltv_stream_next(ltv_stream_decoder_t *s, ltv_data_t *data);
+
+// Number of bytes needed to complete a value split across chunks, or 0 if
+// there is unread input in the current chunk (1 once it is used up). While
+// the length of a split vector is still unknown, this is the number of bytes
+// needed to read the length.
+size_t ltv_stream_needed(const ltv_stream_decoder_t *s);
+
+////////////////////////////////////////////////////////////////////////////////
+// Reader Decoder
+//
+// Decodes from a reader callback using one fixed size buffer. Numeric 
+// vectors larger than a threshold are not buffered: ltv_reader_next reports
+// the type and total length with a NULL v_buffer, and the payload is then 
+// read in pieces with ltv_reader_payload. Memory use stays bounded however
+// large the vectors are.
+////////////////////////////////////////////////////////////////////////////////
+
+// Read up to 'len' bytes into 'buf', setting 'n' to the number read, or 0
+// at the end of input. Returns 0 on success, or an error code.
+typedef int (*ltv_reader)(void *buf, size_t len, size_t *n, void* user_data);
+
+typedef struct {
+    ltv_decoder_t decoder;
+    ltv_reader reader;
+    void *user_data;
+
+    // Read buffer, holding buf[pos] to buf[len] not yet decoded.
+    uint8_t *buf;
+    size_t buf_size;
+    size_t pos;
+    size_t len;
+    bool eof;
+
+    // Vectors with a longer payload are streamed.
+    size_t threshold;
+
+    // Streamed payload left to read, and its element size.
+    uint64_t payload_remaining;
+    size_t payload_type_size;
+
+    // Error from the reader callback.
+    int error;
+} ltv_reader_decoder_t;
+
+// Initialize a reader decoder. Numeric vectors with a payload longer than
+// 'threshold' bytes are streamed. Every other value must fit in 'buf' with
+// its tag and length, so 'threshold' should be at most buf_size - 9.
+void ltv_reader_init(ltv_reader_decoder_t *r, ltv_reader reader, void *user_data,
+                     uint8_t *buf, size_t buf_size, size_t threshold, uint8_t validation);
+
+// Get the next value, as ltv_next. Buffers point into the read buffer and 
+// are valid until the next call. A streamed vector has a NULL v_buffer and
+// its full length. Any of its payload left unread is skipped.
+// Returns LTV_DECODE_CARRY_FULL for a value too large for the buffer.
+int ltv_reader_next(ltv_reader_decoder_t *r, ltv_data_t *data);
+
+// Read the next part of a streamed vector payload into 'dst', at most 'max'
+// bytes and always whole elements. On success 'n' is set to the bytes read,
+// 0 once the payload is finished. 'max' must be at least the element size
+// (8 bytes covers every type), otherwise LTV_DECODE_PAYLOAD_TOO_SMALL is
+// returned and nothing is read.
+int ltv_reader_payload(ltv_reader_decoder_t *r, void *dst, size_t max, size_t *n);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif //_LITEVECTORS_H
\ No newline at end of file
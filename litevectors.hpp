@@ -0,0 +1,371 @@
+#ifndef _LITEVECTORS_HPP
+#define _LITEVECTORS_HPP
+
+#include "litevectors.h"
+#include "litevectors_mem.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<span>)
+#include <span>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// LiteVectors C++ Wrapper
+//
+// Header only templates over the C API, for C++17 and later. C++ types are
+// mapped to type codes at compile time, so writing a value, a vector or any
+// contiguous container picks the right encoding without a per-type call, and
+// a decoded value is read back as a C++ type or viewed as a typed span over
+// the vector payload, without copying.
+//
+//     ltv::writer w([&](const uint8_t *p, size_t n) { out.insert(out.end(), p, p + n); });
+//     w.struct_start();
+//     w.field("Name", std::string_view("probe"));
+//     w.field("Samples", samples);                 // std::vector<float>
+//     w.struct_end();
+//     w.flush();
+//
+//     ltv_decoder_t d;
+//     ltv_decoder_init(&d, out.data(), out.size());
+//     for (const ltv_data_t &v : ltv::values(d)) {
+//         if (ltv::is<uint32_t>(v)) use(ltv::get<uint32_t>(v));
+//         for (float f : ltv::view<float>(v)) use(f);
+//     }
+//
+// Everything compiles down to the same calls as hand-written C. The writer
+// stages output in a member buffer using the inline encoders of
+// litevectors_mem.h, and its sink is a template parameter called directly
+// when the buffer fills, rather than through an ltv_writer function pointer.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace ltv {
+
+////////////////////////////////////////////////////////////////////////////////
+// Type mapping
+////////////////////////////////////////////////////////////////////////////////
+
+// Type code for a C++ type: bool, any integer type by size and signedness,
+// float and double. Other types fail to compile.
+template <class T>
+constexpr uint8_t type_code_of() {
+    using U = std::remove_cv_t<T>;
+    static_assert(std::is_arithmetic_v<U>, "no LiteVectors type for this C++ type");
+    if constexpr (std::is_same_v<U, bool>) {
+        return LTV_BOOL;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        static_assert(std::is_same_v<U, float> || std::is_same_v<U, double>, "only float and double are supported");
+        return std::is_same_v<U, float> ? LTV_F32 : LTV_F64;
+    } else {
+        static_assert(sizeof(U) == 1 || sizeof(U) == 2 || sizeof(U) == 4 || sizeof(U) == 8, "unsupported integer size");
+        constexpr uint8_t base = std::is_signed_v<U> ? LTV_I8 : LTV_U8;
+        return base + (sizeof(U) == 1 ? 0 : sizeof(U) == 2 ? 1 : sizeof(U) == 4 ? 2 : 3);
+    }
+}
+
+template <class T>
+inline constexpr uint8_t type_code_v = type_code_of<T>();
+
+// A contiguous range of T, std::span where the library has it.
+#ifdef __cpp_lib_span
+template <class T>
+using span = std::span<T>;
+#else
+template <class T>
+class span {
+public:
+    constexpr span() noexcept : data_(nullptr), size_(0) {}
+    constexpr span(T *data, size_t size) noexcept : data_(data), size_(size) {}
+
+    constexpr T *data() const noexcept { return data_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T &operator[](size_t i) const noexcept { return data_[i]; }
+    constexpr T *begin() const noexcept { return data_; }
+    constexpr T *end() const noexcept { return data_ + size_; }
+
+private:
+    T *data_;
+    size_t size_;
+};
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Decoded values
+////////////////////////////////////////////////////////////////////////////////
+
+// True if 'v' is a single value of exactly the type that T maps to.
+template <class T>
+constexpr bool is(const ltv_data_t &v) noexcept {
+    return v.type_code == type_code_v<T> && v.size_code == LTV_SINGLE;
+}
+
+// True if 'v' is a vector of the type that T maps to.
+template <class T>
+constexpr bool is_vector(const ltv_data_t &v) noexcept {
+    return v.type_code == type_code_v<T> && v.size_code != LTV_SINGLE;
+}
+
+// The union member holding a single value of type T. 'v' must hold one
+// (see is<T>); no conversion is done.
+template <class T>
+T get(const ltv_data_t &v) noexcept {
+    constexpr uint8_t code = type_code_v<T>;
+    if constexpr (code == LTV_BOOL) {
+        return v.val.v_bool;
+    } else if constexpr (code == LTV_F32) {
+        return v.val.v_float32;
+    } else if constexpr (code == LTV_F64) {
+        return v.val.v_float64;
+    } else if constexpr (code >= LTV_I8) {
+        return static_cast<T>(v.val.v_int);
+    } else {
+        return static_cast<T>(v.val.v_uint);
+    }
+}
+
+// The payload of a vector of T, in place. Empty if 'v' is not such a vector
+// or the payload is not aligned for T, which happens only when the encoder
+// was built without LTV_VECTOR_ALIGNMENT or the buffer itself is misaligned.
+// A streamed vector (see ltv_reader_next) has no payload in place.
+template <class T>
+span<const T> view(const ltv_data_t &v) noexcept {
+    if (!is_vector<T>(v) || v.val.v_buffer == nullptr ||
+        reinterpret_cast<uintptr_t>(v.val.v_buffer) % alignof(T) != 0) {
+        return {};
+    }
+    return span<const T>(reinterpret_cast<const T*>(v.val.v_buffer), v.length / sizeof(T));
+}
+
+// A string value, in place. Empty if 'v' is not a string.
+inline std::string_view string(const ltv_data_t &v) noexcept {
+    if (v.type_code != LTV_STRING || v.val.v_buffer == nullptr) {
+        return {};
+    }
+    return std::string_view(reinterpret_cast<const char*>(v.val.v_buffer), v.length);
+}
+
+// True if 'v' is a string equal to 's'.
+inline bool is_string(const ltv_data_t &v, std::string_view s) noexcept {
+    return v.type_code == LTV_STRING && string(v) == s;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Value range
+//
+// Range-for over the remaining values of a decoder. The loop ends at the end
+// of the data or at the first error; status() then tells which.
+////////////////////////////////////////////////////////////////////////////////
+
+class values {
+public:
+    class sentinel {};
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = ltv_data_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ltv_data_t*;
+        using reference = const ltv_data_t&;
+
+        explicit iterator(values *r) noexcept : r_(r) {}
+
+        reference operator*() const noexcept { return r_->current_; }
+        pointer operator->() const noexcept { return &r_->current_; }
+        iterator &operator++() noexcept { r_->advance(); return *this; }
+        void operator++(int) noexcept { r_->advance(); }
+
+        bool operator==(sentinel) const noexcept { return r_->status_ != LTV_SUCCESS; }
+        bool operator!=(sentinel s) const noexcept { return !(*this == s); }
+
+    private:
+        values *r_;
+    };
+
+    explicit values(ltv_decoder_t &d) noexcept : d_(&d), current_(), status_(LTV_SUCCESS) {}
+
+    iterator begin() noexcept { advance(); return iterator(this); }
+    sentinel end() const noexcept { return {}; }
+
+    // LTV_SUCCESS if the loop reached the end of the data, otherwise the
+    // error that ended it. While iterating, LTV_SUCCESS.
+    int status() const noexcept { return status_ == LTV_DECODE_EOF ? LTV_SUCCESS : status_; }
+
+private:
+    void advance() noexcept { status_ = ltv_next(d_, &current_); }
+
+    ltv_decoder_t *d_;
+    ltv_data_t current_;
+    int status_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Writer
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+template <class T>
+using element_t = std::remove_cv_t<std::remove_pointer_t<decltype(std::data(std::declval<const T&>()))>>;
+
+template <class T, class = void>
+struct is_contiguous : std::false_type {};
+
+// Anything with std::data and std::size over numbers or bools: arrays,
+// std::vector (but not std::vector<bool>), std::array, spans. Containers of
+// char are strings.
+template <class T>
+struct is_contiguous<T, std::void_t<decltype(std::data(std::declval<const T&>())),
+                                    decltype(std::size(std::declval<const T&>()))>>
+    : std::bool_constant<std::is_arithmetic_v<element_t<T>> && !std::is_same_v<element_t<T>, char>> {};
+
+} // namespace detail
+
+// Encoder writing to any callable 'sink' taking (const uint8_t *buf, size_t
+// len). The sink returns 0 on success or an error code stored in status(),
+// or returns void and can't fail. Output is staged in a StageSize byte
+// buffer and passed to the sink when the buffer fills and on flush().
+// Vector payloads too large for the stage are passed to the sink in place.
+//
+// Writers hold their stage, so they can't be copied or moved.
+template <class Sink, size_t StageSize = 4096>
+class writer {
+    static_assert(StageSize >= 64, "stage too small");
+
+public:
+    explicit writer(Sink sink) : sink_(std::move(sink)) {
+        ltv_encoder_init_memory(&e_, stage_, StageSize);
+    }
+
+    writer(const writer&) = delete;
+    writer &operator=(const writer&) = delete;
+
+    void nil()          { room(1); ltv_mem_nil(&e_); }
+    void struct_start() { room(1); ltv_mem_struct_start(&e_); }
+    void struct_end()   { room(1); ltv_mem_struct_end(&e_); }
+    void list_start()   { room(1); ltv_mem_list_start(&e_); }
+    void list_end()     { room(1); ltv_mem_list_end(&e_); }
+
+    // A single number or bool.
+    template <class T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+    void value(T v) {
+        room(1 + sizeof(T));
+        ltv_mem_single(&e_, type_code_v<T>, &v, sizeof(T));
+    }
+
+    // A string.
+    void value(std::string_view s) {
+        vector(LTV_STRING, 1, s.data(), s.size());
+    }
+
+    void value(const char *s) {
+        value(std::string_view(s));
+    }
+
+    // A vector, from any contiguous container of numbers or bools.
+    template <class C, std::enable_if_t<detail::is_contiguous<C>::value, int> = 0>
+    void value(const C &c) {
+        using T = detail::element_t<C>;
+        vector(type_code_v<T>, sizeof(T), std::data(c), std::size(c));
+    }
+
+    void key(const ltv_key_t &k) {
+        room(2 + k.len);
+        ltv_mem_key(&e_, &k);
+    }
+
+    void key(std::string_view k) {
+        value(k);
+    }
+
+    // A struct member: key, then value.
+    template <class K, class T>
+    void field(const K &k, const T &v) {
+        key(k);
+        value(v);
+    }
+
+    // Pass any staged output to the sink. Returns status().
+    int flush() {
+        drain();
+        return e_.status;
+    }
+
+    // 0, or the first error returned by the sink.
+    int status() const noexcept { return e_.status; }
+
+    // Number of bytes written so far, including any still staged.
+    size_t offset() const noexcept { return e_.offset; }
+
+private:
+    // Longest vector head: alignment padding, tag and 8 byte length.
+    static constexpr size_t max_head = 7 + 1 + 8;
+
+    void put(const uint8_t *buf, size_t len) {
+        if constexpr (std::is_void_v<std::invoke_result_t<Sink&, const uint8_t*, size_t>>) {
+            sink_(buf, len);
+        } else {
+            int status = sink_(buf, len);
+            if (status != 0) {
+                e_.status = status;
+            }
+        }
+    }
+
+    void drain() {
+        size_t len = e_.cursor - stage_;
+        e_.cursor = stage_;
+        if (len != 0 && e_.status == 0) {
+            put(stage_, len);
+        }
+    }
+
+    void room(size_t len) {
+        if (static_cast<size_t>(e_.end - e_.cursor) < len) {
+            drain();
+        }
+    }
+
+    void vector(uint8_t type_code, size_t type_size, const void *buf, size_t count) {
+        size_t len = count * type_size;
+        if (count == 0) {
+            buf = stage_;   // Empty containers may have a null data()
+        }
+        if (max_head + len <= StageSize) {
+            room(max_head + len);
+            ltv_mem_vector(&e_, type_code, type_size, buf, count);
+            return;
+        }
+
+        // Larger than the stage: the head goes through the stage, and the
+        // payload straight to the sink. A scratch encoder at the same offset
+        // works out the head, with its alignment padding.
+        uint8_t head[max_head];
+        ltv_encoder_t h;
+        ltv_encoder_init_memory(&h, head, sizeof(head));
+        h.offset = e_.offset;
+        ltv_vector_begin(&h, type_code, count);
+
+        room(max_head);
+        ltv_write(&e_, head, h.offset - e_.offset);
+        drain();
+        if (e_.status == 0) {
+            put(static_cast<const uint8_t*>(buf), len);
+        }
+        e_.offset += len;
+    }
+
+    Sink sink_;
+    ltv_encoder_t e_;
+    uint8_t stage_[StageSize];
+};
+
+} // namespace ltv
+
+#endif //_LITEVECTORS_HPP
@@ -0,0 +1,540 @@
+#include "litevectors.h"
+#include "litevectors_convert.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define LTV_CONVERT_X86
+#include <immintrin.h>
+#endif
+
+// Size of the buffer each chunk of elements is converted into before being
+// written. Small enough to stay in L1 cache along with the source chunk.
+#define CONVERT_CHUNK_BYTES 4096
+
+////////////////////////////////////////////////////////////////////////////////
+// Scalar conversion
+////////////////////////////////////////////////////////////////////////////////
+
+static bool is_numeric_type(uint8_t t) {
+    return t >= LTV_U8 && t <= LTV_F64;
+}
+
+static bool is_signed_type(uint8_t t) {
+    return t >= LTV_I8 && t <= LTV_I64;
+}
+
+static bool is_float_type(uint8_t t) {
+    return t == LTV_F32 || t == LTV_F64;
+}
+
+static int64_t signed_min(uint8_t t) {
+    switch(t) {
+        case LTV_I8: return INT8_MIN;
+        case LTV_I16: return INT16_MIN;
+        case LTV_I32: return INT32_MIN;
+        default: return INT64_MIN;
+    }
+}
+
+static int64_t signed_max(uint8_t t) {
+    switch(t) {
+        case LTV_I8: return INT8_MAX;
+        case LTV_I16: return INT16_MAX;
+        case LTV_I32: return INT32_MAX;
+        default: return INT64_MAX;
+    }
+}
+
+static uint64_t unsigned_max(uint8_t t) {
+    switch(t) {
+        case LTV_U8: return UINT8_MAX;
+        case LTV_U16: return UINT16_MAX;
+        case LTV_U32: return UINT32_MAX;
+        default: return UINT64_MAX;
+    }
+}
+
+// Store an in range integer value as the integer type 't'.
+static void store_int(uint8_t t, uint8_t *dst, int64_t v) {
+    int8_t i8 = v;
+    int16_t i16 = v;
+    int32_t i32 = v;
+
+    switch(ltv_type_sizes[t]) {
+        case 1: memcpy(dst, &i8, 1); break;
+        case 2: memcpy(dst, &i16, 2); break;
+        case 4: memcpy(dst, &i32, 4); break;
+        default: memcpy(dst, &v, 8); break;
+    }
+}
+
+// True if 'v' is finite but rounds to infinity as a F32.
+static bool f32_overflow(double v) {
+    return (v > FLT_MAX || v < -FLT_MAX) && !isinf(v);
+}
+
+static void store_float(uint8_t t, uint8_t *dst, double v) {
+    float f32 = (float) v;
+    if (t == LTV_F32) {
+        memcpy(dst, &f32, sizeof(float));
+    } else {
+        memcpy(dst, &v, sizeof(double));
+    }
+}
+
+// Convert from unsigned, returns false if the value was out of range.
+static bool convert_from_uint(uint8_t t, uint8_t *dst, uint64_t v) {
+    if (is_float_type(t)) {
+        store_float(t, dst, (double) v);
+        return true;
+    }
+
+    uint64_t max = is_signed_type(t) ? (uint64_t) signed_max(t) : unsigned_max(t);
+    if (v > max) {
+        store_int(t, dst, (int64_t) max);
+        return false;
+    }
+    store_int(t, dst, (int64_t) v);
+    return true;
+}
+
+// Convert from signed, returns false if the value was out of range.
+static bool convert_from_int(uint8_t t, uint8_t *dst, int64_t v) {
+    if (is_float_type(t)) {
+        store_float(t, dst, (double) v);
+        return true;
+    }
+
+    if (!is_signed_type(t)) {
+        if (v < 0) {
+            store_int(t, dst, 0);
+            return false;
+        }
+        return convert_from_uint(t, dst, (uint64_t) v);
+    }
+
+    if (v < signed_min(t)) {
+        store_int(t, dst, signed_min(t));
+        return false;
+    }
+    if (v > signed_max(t)) {
+        store_int(t, dst, signed_max(t));
+        return false;
+    }
+    store_int(t, dst, v);
+    return true;
+}
+
+// Convert from floating point, returns false if the value was out of range.
+static bool convert_from_double(uint8_t t, uint8_t *dst, double v) {
+    if (is_float_type(t)) {
+        store_float(t, dst, v);
+        return t != LTV_F32 || !f32_overflow(v);
+    }
+
+    // NaN
+    if (v != v) {
+        store_int(t, dst, 0);
+        return false;
+    }
+
+    // Values truncate toward zero, so anything in (min - 1, max + 1) fits.
+    // Limits are compared as doubles, where INT64_MAX + 1 rounds to 2^63.
+    double lo = is_signed_type(t) ? (double) signed_min(t) : 0.0;
+    double hi = is_signed_type(t) ? (double) signed_max(t) + 1.0 : (double) unsigned_max(t) + 1.0;
+
+    if (!(v > lo - 1.0 || v == lo)) {
+        store_int(t, dst, is_signed_type(t) ? signed_min(t) : 0);
+        return false;
+    }
+    if (!(v < hi)) {
+        if (is_signed_type(t)) {
+            store_int(t, dst, signed_max(t));
+        } else {
+            uint64_t max = unsigned_max(t);
+            store_int(t, dst, (int64_t) max);
+        }
+        return false;
+    }
+
+    if (is_signed_type(t)) {
+        store_int(t, dst, (int64_t) v);
+    } else {
+        store_int(t, dst, (int64_t)(uint64_t) v);
+    }
+    return true;
+}
+
+// Convert 'n' elements one at a time. Returns false if any value was out of range.
+static bool convert_scalar(uint8_t dst_type, uint8_t src_type, const uint8_t *src, uint8_t *dst, size_t n) {
+    size_t srcSize = ltv_type_sizes[src_type];
+    size_t dstSize = ltv_type_sizes[dst_type];
+    bool in_range = true;
+
+    int8_t i8; int16_t i16; int32_t i32; int64_t i64;
+    uint8_t u8; uint16_t u16; uint32_t u32; uint64_t u64;
+    float f32; double f64;
+
+    for (size_t i = 0; i < n; i++, src += srcSize, dst += dstSize) {
+        switch(src_type) {
+            case LTV_U8:  memcpy(&u8, src, 1);  in_range &= convert_from_uint(dst_type, dst, u8); break;
+            case LTV_U16: memcpy(&u16, src, 2); in_range &= convert_from_uint(dst_type, dst, u16); break;
+            case LTV_U32: memcpy(&u32, src, 4); in_range &= convert_from_uint(dst_type, dst, u32); break;
+            case LTV_U64: memcpy(&u64, src, 8); in_range &= convert_from_uint(dst_type, dst, u64); break;
+            case LTV_I8:  memcpy(&i8, src, 1);  in_range &= convert_from_int(dst_type, dst, i8); break;
+            case LTV_I16: memcpy(&i16, src, 2); in_range &= convert_from_int(dst_type, dst, i16); break;
+            case LTV_I32: memcpy(&i32, src, 4); in_range &= convert_from_int(dst_type, dst, i32); break;
+            case LTV_I64: memcpy(&i64, src, 8); in_range &= convert_from_int(dst_type, dst, i64); break;
+            case LTV_F32: memcpy(&f32, src, 4); in_range &= convert_from_double(dst_type, dst, f32); break;
+            case LTV_F64: memcpy(&f64, src, 8); in_range &= convert_from_double(dst_type, dst, f64); break;
+        }
+    }
+
+    return in_range;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SIMD kernels
+//
+// A kernel converts a whole number of vector widths from the start of 'src',
+// and returns the number of elements it converted; the caller finishes the
+// remainder with convert_scalar. '*in_range' is cleared if any value was 
+// clamped. Saturating packs give the same results as the scalar code.
+////////////////////////////////////////////////////////////////////////////////
+
+typedef size_t (*convert_kernel)(const void *src, void *dst, size_t n, bool *in_range);
+
+#ifdef LTV_CONVERT_X86
+
+// SSE2 is part of the x86-64 baseline.
+
+// Lanes that are finite but beyond the F32 range, as in f32_overflow.
+static inline __m128d f32_overflow_sse2(__m128d v) {
+    __m128d a = _mm_and_pd(v, _mm_castsi128_pd(_mm_set1_epi64x(INT64_MAX)));
+    return _mm_and_pd(_mm_cmpgt_pd(a, _mm_set1_pd(FLT_MAX)), _mm_cmplt_pd(a, _mm_set1_pd(INFINITY)));
+}
+
+static size_t f64_to_f32_sse2(const void *src, void *dst, size_t n, bool *in_range) {
+    const double *s = src;
+    float *d = dst;
+    __m128d out = _mm_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128d a = _mm_loadu_pd(s + i);
+        __m128d b = _mm_loadu_pd(s + i + 2);
+        out = _mm_or_pd(out, _mm_or_pd(f32_overflow_sse2(a), f32_overflow_sse2(b)));
+        _mm_storeu_ps(d + i, _mm_movelh_ps(_mm_cvtpd_ps(a), _mm_cvtpd_ps(b)));
+    }
+
+    if (_mm_movemask_pd(out) != 0) {
+        *in_range = false;
+    }
+    return i;
+}
+
+static size_t i32_to_i16_sse2(const void *src, void *dst, size_t n, bool *in_range) {
+    const int32_t *s = src;
+    int16_t *d = dst;
+    const __m128i max = _mm_set1_epi32(INT16_MAX);
+    const __m128i min = _mm_set1_epi32(INT16_MIN);
+    __m128i out = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + i + 4));
+        out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi32(a, max), _mm_cmplt_epi32(a, min)));
+        out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi32(b, max), _mm_cmplt_epi32(b, min)));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packs_epi32(a, b));
+    }
+
+    if (_mm_movemask_epi8(out) != 0) {
+        *in_range = false;
+    }
+    return i;
+}
+
+static size_t i16_to_i8_sse2(const void *src, void *dst, size_t n, bool *in_range) {
+    const int16_t *s = src;
+    int8_t *d = dst;
+    const __m128i max = _mm_set1_epi16(INT8_MAX);
+    const __m128i min = _mm_set1_epi16(INT8_MIN);
+    __m128i out = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + i + 8));
+        out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi16(a, max), _mm_cmplt_epi16(a, min)));
+        out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi16(b, max), _mm_cmplt_epi16(b, min)));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packs_epi16(a, b));
+    }
+
+    if (_mm_movemask_epi8(out) != 0) {
+        *in_range = false;
+    }
+    return i;
+}
+
+// AVX2 kernels, used when the CPU supports them.
+
+__attribute__((target("avx2")))
+static inline __m256d f32_overflow_avx2(__m256d v) {
+    __m256d a = _mm256_and_pd(v, _mm256_castsi256_pd(_mm256_set1_epi64x(INT64_MAX)));
+    return _mm256_and_pd(_mm256_cmp_pd(a, _mm256_set1_pd(FLT_MAX), _CMP_GT_OQ),
+                         _mm256_cmp_pd(a, _mm256_set1_pd(INFINITY), _CMP_LT_OQ));
+}
+
+__attribute__((target("avx2")))
+static size_t f64_to_f32_avx2(const void *src, void *dst, size_t n, bool *in_range) {
+    const double *s = src;
+    float *d = dst;
+    __m256d out = _mm256_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256d a = _mm256_loadu_pd(s + i);
+        __m256d b = _mm256_loadu_pd(s + i + 4);
+        out = _mm256_or_pd(out, _mm256_or_pd(f32_overflow_avx2(a), f32_overflow_avx2(b)));
+        _mm256_storeu_ps(d + i, _mm256_set_m128(_mm256_cvtpd_ps(b), _mm256_cvtpd_ps(a)));
+    }
+
+    if (_mm256_movemask_pd(out) != 0) {
+        *in_range = false;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t i32_to_i16_avx2(const void *src, void *dst, size_t n, bool *in_range) {
+    const int32_t *s = src;
+    int16_t *d = dst;
+    const __m256i max = _mm256_set1_epi32(INT16_MAX);
+    const __m256i min = _mm256_set1_epi32(INT16_MIN);
+    __m256i out = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(s + i + 8));
+        out = _mm256_or_si256(out, _mm256_or_si256(_mm256_cmpgt_epi32(a, max), _mm256_cmpgt_epi32(min, a)));
+        out = _mm256_or_si256(out, _mm256_or_si256(_mm256_cmpgt_epi32(b, max), _mm256_cmpgt_epi32(min, b)));
+
+        // packs works within 128 bit lanes, so restore element order afterwards.
+        __m256i p = _mm256_packs_epi32(a, b);
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_permute4x64_epi64(p, 0xD8));
+    }
+
+    if (_mm256_movemask_epi8(out) != 0) {
+        *in_range = false;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t i16_to_i8_avx2(const void *src, void *dst, size_t n, bool *in_range) {
+    const int16_t *s = src;
+    int8_t *d = dst;
+    const __m256i max = _mm256_set1_epi16(INT8_MAX);
+    const __m256i min = _mm256_set1_epi16(INT8_MIN);
+    __m256i out = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(s + i + 16));
+        out = _mm256_or_si256(out, _mm256_or_si256(_mm256_cmpgt_epi16(a, max), _mm256_cmpgt_epi16(min, a)));
+        out = _mm256_or_si256(out, _mm256_or_si256(_mm256_cmpgt_epi16(b, max), _mm256_cmpgt_epi16(min, b)));
+
+        __m256i p = _mm256_packs_epi16(a, b);
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_permute4x64_epi64(p, 0xD8));
+    }
+
+    if (_mm256_movemask_epi8(out) != 0) {
+        *in_range = false;
+    }
+    return i;
+}
+
+// Clamp four int64 values to [min, max] and narrow them to int32, 
+// returned in the low 128 bits.
+__attribute__((target("avx2")))
+static inline __m128i clamp_i64x4_avx2(__m256i v, __m256i min, __m256i max, __m256i *out) {
+    __m256i gt = _mm256_cmpgt_epi64(v, max);
+    __m256i lt = _mm256_cmpgt_epi64(min, v);
+    *out = _mm256_or_si256(*out, _mm256_or_si256(gt, lt));
+    v = _mm256_blendv_epi8(v, max, gt);
+    v = _mm256_blendv_epi8(v, min, lt);
+    v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+    return _mm256_castsi256_si128(v);
+}
+
+__attribute__((target("avx2")))
+static size_t i64_to_i32_avx2(const void *src, void *dst, size_t n, bool *in_range) {
+    const int64_t *s = src;
+    int32_t *d = dst;
+    const __m256i max = _mm256_set1_epi64x(INT32_MAX);
+    const __m256i min = _mm256_set1_epi64x(INT32_MIN);
+    __m256i out = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        _mm_storeu_si128((__m128i*)(d + i), clamp_i64x4_avx2(v, min, max, &out));
+    }
+
+    if (_mm256_movemask_epi8(out) != 0) {
+        *in_range = false;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t i64_to_i16_avx2(const void *src, void *dst, size_t n, bool *in_range) {
+    const int64_t *s = src;
+    int16_t *d = dst;
+    const __m256i max = _mm256_set1_epi64x(INT16_MAX);
+    const __m256i min = _mm256_set1_epi64x(INT16_MIN);
+    __m256i out = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = clamp_i64x4_avx2(_mm256_loadu_si256((const __m256i*)(s + i)), min, max, &out);
+        __m128i b = clamp_i64x4_avx2(_mm256_loadu_si256((const __m256i*)(s + i + 4)), min, max, &out);
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packs_epi32(a, b));
+    }
+
+    if (_mm256_movemask_epi8(out) != 0) {
+        *in_range = false;
+    }
+    return i;
+}
+
+static bool has_avx2(void) {
+    static int avx2 = -1;
+    if (avx2 < 0) {
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return avx2;
+}
+
+#endif
+
+// Pick the fastest kernel for a conversion, or NULL to use scalar code only.
+static convert_kernel find_kernel(uint8_t dst_type, uint8_t src_type) {
+#ifdef LTV_CONVERT_X86
+    bool avx2 = has_avx2();
+
+    if (dst_type == LTV_F32 && src_type == LTV_F64) {
+        return avx2 ? f64_to_f32_avx2 : f64_to_f32_sse2;
+    }
+    if (dst_type == LTV_I16 && src_type == LTV_I32) {
+        return avx2 ? i32_to_i16_avx2 : i32_to_i16_sse2;
+    }
+    if (dst_type == LTV_I8 && src_type == LTV_I16) {
+        return avx2 ? i16_to_i8_avx2 : i16_to_i8_sse2;
+    }
+    if (avx2 && dst_type == LTV_I32 && src_type == LTV_I64) {
+        return i64_to_i32_avx2;
+    }
+    if (avx2 && dst_type == LTV_I16 && src_type == LTV_I64) {
+        return i64_to_i16_avx2;
+    }
+#else
+    (void) dst_type;
+    (void) src_type;
+#endif
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Conversion encoders
+////////////////////////////////////////////////////////////////////////////////
+
+void ltv_convert_vec(ltv_encoder_t *e, uint8_t dst_type, uint8_t src_type, 
+                     const void *src, size_t count, int mode) {
+
+    if (e->status != 0) {
+        return;
+    }
+
+    if (!is_numeric_type(dst_type) || !is_numeric_type(src_type)) {
+        e->status = LTV_ENCODE_INVALID_CONVERSION;
+        return;
+    }
+
+    if (dst_type == src_type) {
+        ltv_write_vector(e, dst_type, src, count);
+        return;
+    }
+
+    convert_kernel kernel = find_kernel(dst_type, src_type);
+    size_t srcSize = ltv_type_sizes[src_type];
+    size_t dstSize = ltv_type_sizes[dst_type];
+    size_t chunkCount = CONVERT_CHUNK_BYTES / dstSize;
+    _Alignas(32) uint8_t chunk[CONVERT_CHUNK_BYTES];
+    const uint8_t *s = src;
+
+    ltv_vector_begin(e, dst_type, count);
+
+    while (count > 0 && e->status == 0) {
+        size_t n = count < chunkCount ? count : chunkCount;
+        size_t done = 0;
+        bool in_range = true;
+
+        if (kernel != NULL) {
+            done = kernel(s, chunk, n, &in_range);
+        }
+        if (!convert_scalar(dst_type, src_type, s + done * srcSize, chunk + done * dstSize, n - done)) {
+            in_range = false;
+        }
+
+        // The vector is closed by ltv_vector_end below, which leaves the
+        // error status in place.
+        if (!in_range && mode == LTV_CONVERT_CHECKED) {
+            e->status = LTV_ENCODE_CONVERSION_RANGE;
+            break;
+        }
+
+        // A gather encoder references large writes until they are flushed,
+        // and the chunk buffer is about to be reused. Append it in pieces
+        // small enough to be copied into the stage instead.
+        size_t piece = e->gather_writer != NULL ? (LTV_GATHER_COPY_LIMIT - 1) / dstSize : n;
+        for (size_t i = 0; i < n; i += piece) {
+            ltv_vector_append(e, chunk + i * dstSize, n - i < piece ? n - i : piece);
+        }
+
+        s += n * srcSize;
+        count -= n;
+    }
+
+    ltv_vector_end(e);
+}
+
+void ltv_f64_to_f32_vec(ltv_encoder_t *e, const double *val, size_t count) {
+    ltv_convert_vec(e, LTV_F32, LTV_F64, val, count, LTV_CONVERT_SATURATE);
+}
+
+void ltv_i64_to_i32_vec(ltv_encoder_t *e, const int64_t *val, size_t count, int mode) {
+    ltv_convert_vec(e, LTV_I32, LTV_I64, val, count, mode);
+}
+
+void ltv_i64_to_i16_vec(ltv_encoder_t *e, const int64_t *val, size_t count, int mode) {
+    ltv_convert_vec(e, LTV_I16, LTV_I64, val, count, mode);
+}
+
+void ltv_i32_to_i16_vec(ltv_encoder_t *e, const int32_t *val, size_t count, int mode) {
+    ltv_convert_vec(e, LTV_I16, LTV_I32, val, count, mode);
+}
+
+void ltv_i16_to_i8_vec(ltv_encoder_t *e, const int16_t *val, size_t count, int mode) {
+    ltv_convert_vec(e, LTV_I8, LTV_I16, val, count, mode);
+}
+
+void ltv_f64_to_i16_vec(ltv_encoder_t *e, const double *val, size_t count, int mode) {
+    ltv_convert_vec(e, LTV_I16, LTV_F64, val, count, mode);
+}
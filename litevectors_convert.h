@@ -0,0 +1,52 @@
+#ifndef _LITEVECTORS_CONVERT_H
+#define _LITEVECTORS_CONVERT_H
+
+#include "litevectors.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// LiteVectors Conversions
+//
+// Encode a numeric array as a vector of a different LiteVectors type, such as
+// double data sent as a F32 vector, or int64_t samples sent as I16. Elements
+// are converted in small chunks straight into the encoder, so no temporary
+// copy of the whole array is needed. 
+//
+// On x86, the common narrowing conversions use SSE2, or AVX2 when the CPU
+// supports it. Other platforms and conversions use portable C.
+////////////////////////////////////////////////////////////////////////////////
+
+// Out of range integer values are clamped to the destination type's range.
+// NaN converts to 0 for integer destinations, and F64 values too large for
+// F32 become infinity, as with a C cast.
+#define LTV_CONVERT_SATURATE  0
+
+// Out of range integer values (and NaN) are an error, setting the encoder
+// status to LTV_ENCODE_CONVERSION_RANGE, as are finite values too large for
+// a F32 destination. Because the vector is streamed, part of it has been
+// written when this happens, and the encoder's output is unusable. The
+// vector is closed, so the encoder is left in its usual error state.
+#define LTV_CONVERT_CHECKED   1
+
+// Status set when a checked conversion finds a value that doesn't fit.
+#define LTV_ENCODE_CONVERSION_RANGE   -4
+
+// Status set when a conversion between unsupported types is requested.
+#define LTV_ENCODE_INVALID_CONVERSION -5
+
+// Encode 'count' elements of type 'src_type' from 'src' as a vector of 
+// 'dst_type'. Both types must be one of the numeric types LTV_U8 to LTV_F64.
+//
+// Conversions to floating point types round to nearest, as a C cast does.
+// Conversions from floating point to integer types truncate toward zero.
+void ltv_convert_vec(ltv_encoder_t *e, uint8_t dst_type, uint8_t src_type, 
+                     const void *src, size_t count, int mode);
+
+// Typed wrappers for common conversions.
+void ltv_f64_to_f32_vec(ltv_encoder_t *e, const double *val, size_t count);
+void ltv_i64_to_i32_vec(ltv_encoder_t *e, const int64_t *val, size_t count, int mode);
+void ltv_i64_to_i16_vec(ltv_encoder_t *e, const int64_t *val, size_t count, int mode);
+void ltv_i32_to_i16_vec(ltv_encoder_t *e, const int32_t *val, size_t count, int mode);
+void ltv_i16_to_i8_vec(ltv_encoder_t *e, const int16_t *val, size_t count, int mode);
+void ltv_f64_to_i16_vec(ltv_encoder_t *e, const double *val, size_t count, int mode);
+
+#endif //_LITEVECTORS_CONVERT_H
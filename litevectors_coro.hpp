@@ -0,0 +1,158 @@
+#ifndef _LITEVECTORS_CORO_HPP
+#define _LITEVECTORS_CORO_HPP
+
+#include "litevectors.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+// LiteVectors C++20 Coroutine Decoding
+//
+// Decodes values from an asynchronous byte source as they arrive, inside a
+// coroutine. decode() reads a chunk, yields each value in it, and awaits the
+// next chunk only when the stream decoder (ltv_stream_next) runs out, so
+// parsing overlaps with I/O without a thread per connection or a buffer for
+// the whole message. Values cut off at the end of a chunk are completed from
+// the next one in the carry buffer, as with ltv_stream_decoder_t.
+//
+// The source is anything with a read(uint8_t *buf, size_t len) member
+// returning an awaitable whose result is the number of bytes read, 0 at the
+// end of the stream. For asio, a thin wrapper over async_read_some with
+// use_awaitable does. Errors are thrown from read and rethrown from next().
+//
+//     ltv::value_stream values = ltv::decode(socket_source);
+//     while (co_await values.next()) {
+//         const ltv_data_t &v = values.value();
+//         ...
+//     }
+//     if (values.status() != LTV_SUCCESS) ...
+//
+// A value, and any buffer it points to, is valid until the next call to
+// next(). Only one coroutine may consume a stream.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace ltv {
+
+// Values decoded by a coroutine, consumed with co_await next().
+class value_stream {
+public:
+    struct promise_type;
+    using handle = std::coroutine_handle<promise_type>;
+
+    struct promise_type {
+        const ltv_data_t *current = nullptr;
+        int status = LTV_SUCCESS;
+        std::coroutine_handle<> consumer;
+        std::exception_ptr error;
+
+        // Suspending hands control back to the coroutine waiting in next().
+        struct to_consumer {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(handle h) const noexcept { return h.promise().consumer; }
+            void await_resume() const noexcept {}
+        };
+
+        value_stream get_return_object() noexcept { return value_stream(handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        to_consumer final_suspend() const noexcept { return {}; }
+
+        to_consumer yield_value(const ltv_data_t &v) noexcept {
+            current = &v;
+            return {};
+        }
+
+        void return_value(int s) noexcept { status = s; }
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+    value_stream(value_stream &&other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+
+    value_stream &operator=(value_stream &&other) noexcept {
+        if (this != &other) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(other.h_, nullptr);
+        }
+        return *this;
+    }
+
+    ~value_stream() {
+        if (h_) h_.destroy();
+    }
+
+    // Awaits the next value. True if there is one, false at the end of the
+    // stream or on an error (see status()). Exceptions from the source are
+    // rethrown here.
+    auto next() noexcept {
+        struct awaiter {
+            handle h;
+
+            bool await_ready() const noexcept { return h.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) const noexcept {
+                h.promise().current = nullptr;
+                h.promise().consumer = consumer;
+                return h;
+            }
+
+            bool await_resume() const {
+                promise_type &p = h.promise();
+                if (p.error) {
+                    std::rethrow_exception(std::exchange(p.error, nullptr));
+                }
+                return !h.done() && p.current != nullptr;
+            }
+        };
+        return awaiter{ h_ };
+    }
+
+    // The value from the last successful next().
+    const ltv_data_t &value() const noexcept { return *h_.promise().current; }
+
+    // Once next() has returned false: LTV_SUCCESS at the end of the data,
+    // otherwise the decoder error.
+    int status() const noexcept { return h_.promise().status; }
+
+private:
+    explicit value_stream(handle h) noexcept : h_(h) {}
+
+    handle h_;
+};
+
+// Decode the values read from 'source', which must outlive the stream.
+// Reads are at most 'chunk_size' bytes. The carry buffer must hold the
+// largest value (tag, length and payload) that may straddle two reads;
+// a larger one ends the stream with LTV_DECODE_CARRY_FULL.
+template <class Source>
+value_stream decode(Source &source, size_t chunk_size = 4096, size_t carry_size = 4096,
+                    uint8_t validation = LTV_VALIDATE_FULL) {
+    std::unique_ptr<uint8_t[]> chunk(new uint8_t[chunk_size]);
+    std::unique_ptr<uint8_t[]> carry(new uint8_t[carry_size]);
+    ltv_stream_decoder_t s;
+    ltv_data_t v;
+
+    ltv_stream_init(&s, carry.get(), carry_size, validation);
+    for (;;) {
+        int status = ltv_stream_next(&s, &v);
+        if (status == LTV_SUCCESS) {
+            co_yield v;
+        } else if (status == LTV_DECODE_NEED_DATA) {
+            size_t n = co_await source.read(chunk.get(), chunk_size);
+            if (n == 0) {
+                ltv_stream_finish(&s);
+            } else {
+                ltv_stream_feed(&s, chunk.get(), n);
+            }
+        } else {
+            co_return status == LTV_DECODE_EOF ? LTV_SUCCESS : status;
+        }
+    }
+}
+
+} // namespace ltv
+
+#endif //_LITEVECTORS_CORO_HPP
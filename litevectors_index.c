@@ -0,0 +1,160 @@
+#include "litevectors.h"
+#include "litevectors_index.h"
+
+#include <string.h>
+
+void ltv_index_init(ltv_index_t *x, const uint8_t *buf, size_t buf_len, uint8_t validation,
+                    ltv_index_entry_t *entries, size_t entries_size) {
+    ltv_decoder_init_validation(&x->decoder, buf, buf_len, validation);
+    x->count = 0;
+    x->positions[0] = 0;
+    ltv_index_resize(x, entries, entries_size);
+}
+
+void ltv_index_resize(ltv_index_t *x, ltv_index_entry_t *entries, size_t entries_size) {
+    x->entries = entries;
+    x->entries_size = entries_size < UINT32_MAX ? entries_size : UINT32_MAX;
+}
+
+int ltv_index_build(ltv_index_t *x) {
+    ltv_decoder_t *d = &x->decoder;
+    ltv_data_t data;
+    int status;
+
+    for (;;) {
+        // Check for room first, so no element is decoded and then lost.
+        if (x->count == x->entries_size) {
+            return LTV_INDEX_FULL;
+        }
+
+        size_t depth = d->nest_depth;
+        status = ltv_next(d, &data);
+        if (status != LTV_SUCCESS) {
+            return status;
+        }
+
+        uint32_t i = x->count++;
+        ltv_index_entry_t *entry = &x->entries[i];
+        entry->type_code = data.type_code;
+        entry->size_code = data.size_code;
+        entry->length = data.length;
+        entry->next = i + 1;
+        entry->flat = false;
+        entry->parent = depth > 0 ? x->open[depth - 1] : LTV_INDEX_ROOT;
+        entry->position = x->positions[depth]++;
+
+        if (data.type_code == LTV_STRING || data.size_code != LTV_SINGLE) {
+            entry->offset = data.val.v_buffer - d->buf;
+        } else {
+            entry->offset = d->idx - data.length;
+        }
+
+        if (data.type_code == LTV_STRUCT || data.type_code == LTV_LIST) {
+            if (depth > 0) {
+                x->entries[x->open[depth - 1]].flat = false;
+            }
+            x->open[depth] = i;
+            x->positions[depth + 1] = 0;
+            entry->flat = true;
+            entry->next = 0;
+        } else if (data.type_code == LTV_END) {
+            x->entries[x->open[depth - 1]].next = i + 1;
+        }
+    }
+}
+
+size_t ltv_index_element(const ltv_index_t *x, size_t container, size_t n) {
+    if (container >= x->count) {
+        return LTV_INDEX_NONE;
+    }
+
+    const ltv_index_entry_t *c = &x->entries[container];
+    if (c->type_code != LTV_STRUCT && c->type_code != LTV_LIST) {
+        return LTV_INDEX_NONE;
+    }
+
+    // Flat containers hold one entry per element, followed by the end.
+    if (c->flat) {
+        return n < c->next - container - 2 ? container + 1 + n : LTV_INDEX_NONE;
+    }
+
+    // The end tag's position is the element count.
+    size_t end = c->next - 1;
+    if (n >= x->entries[end].position) {
+        return LTV_INDEX_NONE;
+    }
+
+    // Binary search between 'lo' and 'hi', which are always the first entry
+    // of an element and the entry after one. Any probe inside a nested 
+    // container climbs to the element of this container holding it.
+    size_t lo = container + 1;
+    size_t hi = end;
+    for (;;) {
+        size_t i = lo + (hi - lo) / 2;
+        while (x->entries[i].parent != container) {
+            i = x->entries[i].parent;
+        }
+        if (x->entries[i].position == n) {
+            return i;
+        }
+        if (x->entries[i].position < n) {
+            lo = x->entries[i].next;
+        } else {
+            hi = i;
+        }
+    }
+}
+
+size_t ltv_index_field(const ltv_index_t *x, size_t container, const char *key) {
+    if (container >= x->count || x->entries[container].type_code != LTV_STRUCT) {
+        return LTV_INDEX_NONE;
+    }
+
+    const uint8_t *buf = x->decoder.buf;
+    size_t key_len = strlen(key);
+    size_t i = container + 1;
+
+    // Stop at the struct's end tag. Without validation, a key may have no
+    // value or not be a string.
+    size_t end = x->entries[container].next - 1;
+    if (end >= x->count) {
+        end = x->count;
+    }
+    while (i < end) {
+        const ltv_index_entry_t *k = &x->entries[i];
+        size_t value = k->next;
+        if (value >= end) {
+            break;
+        }
+        if (k->type_code == LTV_STRING && k->length == key_len && memcmp(&buf[k->offset], key, key_len) == 0) {
+            return value;
+        }
+        i = x->entries[value].next;
+    }
+    return LTV_INDEX_NONE;
+}
+
+int ltv_index_get(const ltv_index_t *x, size_t i, ltv_data_t *data) {
+    if (i >= x->count) {
+        return LTV_DECODE_EOF;
+    }
+
+    const ltv_index_entry_t *entry = &x->entries[i];
+
+    if (entry->type_code <= LTV_END) {
+        memset(data, 0, sizeof(ltv_data_t));
+        data->type_code = entry->type_code;
+        data->size_code = entry->size_code;
+        return LTV_SUCCESS;
+    }
+
+    // Decode again from the tag. It was validated while indexing.
+    size_t tag = entry->offset - 1;
+    if (entry->size_code != LTV_SINGLE) {
+        tag -= (size_t)1 << (entry->size_code - LTV_SIZE_1);
+    }
+
+    ltv_decoder_t d;
+    ltv_decoder_init_validation(&d, &x->decoder.buf[tag], x->decoder.buf_len - tag, LTV_VALIDATE_TRUSTED);
+    return ltv_next(&d, data);
+}
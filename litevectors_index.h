@@ -0,0 +1,97 @@
+#ifndef _LITEVECTORS_INDEX_H
+#define _LITEVECTORS_INDEX_H
+
+#include "litevectors.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// LiteVectors Structural Index
+//
+// One pass over a buffer records every element (including end tags) in an
+// array of entries supplied by the caller. Each entry holds where the
+// element's payload is and the index of the entry after it, so a container
+// of any size is skipped in one step, and a buffer can be queried over and
+// over without being parsed again.
+//
+// The buffer is decoded with ltv_next while indexing, so it is validated
+// according to the chosen LTV_VALIDATE_* policy.
+////////////////////////////////////////////////////////////////////////////////
+
+// ltv_index_build returns LTV_INDEX_FULL, defined in litevectors.h with the
+// other status codes, when the entry array is full.
+
+// Returned by the lookup functions when there is no such element.
+#define LTV_INDEX_NONE     ((size_t)-1)
+
+// Parent of top level elements.
+#define LTV_INDEX_ROOT     UINT32_MAX
+
+typedef struct {
+    // Offset of the payload in the buffer: the value for single elements,
+    // the data for vectors. Just past the tag for containers, ends and nil.
+    size_t offset;
+
+    // Payload length in bytes.
+    size_t length;
+
+    // Index of the entry following this element. For a struct or list,
+    // that is the entry after its matching end.
+    uint32_t next;
+
+    // Index of the enclosing struct or list entry (LTV_INDEX_ROOT at the 
+    // top level), and this element's position within it.
+    uint32_t parent;
+    uint32_t position;
+
+    uint8_t type_code;
+    uint8_t size_code;
+
+    // Set on a struct or list that contains no other containers, so each
+    // of its elements is a single entry.
+    bool flat;
+} ltv_index_entry_t;
+
+typedef struct {
+    ltv_decoder_t decoder;
+    ltv_index_entry_t *entries;
+    size_t entries_size;
+    size_t count;
+
+    // Entry indexes of the containers that are still open, and the number
+    // of elements seen so far at each depth (top level first).
+    uint32_t open[LTV_MAX_NESTING_DEPTH];
+    uint32_t positions[LTV_MAX_NESTING_DEPTH + 1];
+} ltv_index_t;
+
+// Prepare to index a buffer into 'entries', which has room for
+// 'entries_size' entries (at most UINT32_MAX are used).
+void ltv_index_init(ltv_index_t *x, const uint8_t *buf, size_t buf_len, uint8_t validation,
+                    ltv_index_entry_t *entries, size_t entries_size);
+
+// Index the buffer. Returns LTV_DECODE_EOF when the whole buffer has been
+// indexed, or a decoder error.
+//
+// Returns LTV_INDEX_FULL if the entries run out. Indexing can then continue:
+// pass a larger array holding the entries so far (from realloc, for example)
+// to ltv_index_resize and call ltv_index_build again.
+int ltv_index_build(ltv_index_t *x);
+
+// Replace the entry array. The first x->count entries must be copied over.
+void ltv_index_resize(ltv_index_t *x, ltv_index_entry_t *entries, size_t entries_size);
+
+// The lookups below may only be used once ltv_index_build has returned
+// LTV_DECODE_EOF.
+
+// Index of the nth element of the list (or struct) at entry 'container'.
+// For struct members, keys and values each count as an element.
+// Lists holding no containers are looked up directly, others with a binary
+// search over the element positions.
+size_t ltv_index_element(const ltv_index_t *x, size_t container, size_t n);
+
+// Index of the value for 'key' in the struct at entry 'container'.
+size_t ltv_index_field(const ltv_index_t *x, size_t container, const char *key);
+
+// Decode the element at entry 'i', as ltv_next would have. Containers
+// and ends produce just their type code.
+int ltv_index_get(const ltv_index_t *x, size_t i, ltv_data_t *data);
+
+#endif //_LITEVECTORS_INDEX_H
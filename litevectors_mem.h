@@ -0,0 +1,161 @@
+#ifndef _LITEVECTORS_MEM_H
+#define _LITEVECTORS_MEM_H
+
+#include <string.h>
+
+#include "litevectors.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Memory Encoder
+//
+// Header only versions of the encoding functions for encoders created with
+// ltv_encoder_init_memory(). Each value is written with a single bounds check
+// straight into the output buffer, so a scalar compiles down to a few stores.
+//
+// The output is byte-identical to the regular ltv_* functions, including
+// alignment NOPs, and overflow is reported the same way via 'status'.
+// Called on a writer, measuring or fragment encoder, these fall back to the 
+// regular path.
+////////////////////////////////////////////////////////////////////////////////
+
+// Claim 'len' bytes of the output buffer. Returns NULL if the encoder has
+// failed or the buffer is too small.
+static inline uint8_t *ltv_mem_reserve(ltv_encoder_t *e, size_t len) {
+    uint8_t *p = e->cursor;
+    if (e->status != 0) {
+        return NULL;
+    }
+    if (len > (size_t)(e->end - p)) {
+        e->status = LTV_ENCODE_BUFFER_FULL;
+        return NULL;
+    }
+    e->cursor = p + len;
+    e->offset += len;
+    return p;
+}
+
+static inline void ltv_mem_single(ltv_encoder_t *e, uint8_t type_code, const void *val, size_t size) {
+    uint8_t tmp[9];
+    uint8_t *p = e->cursor != NULL ? ltv_mem_reserve(e, size + 1) : tmp;
+    if (p == NULL) {
+        return;
+    }
+
+    p[0] = (type_code << 4) | LTV_SINGLE;
+    memcpy(&p[1], val, size);
+
+    if (p == tmp) {
+        ltv_write(e, tmp, size + 1);
+    }
+}
+
+static inline void ltv_mem_tag(ltv_encoder_t *e, uint8_t type_code) {
+    uint8_t tag = (type_code << 4) | LTV_SINGLE;
+    if (e->cursor == NULL) {
+        ltv_write(e, &tag, 1);
+        return;
+    }
+
+    uint8_t *p = ltv_mem_reserve(e, 1);
+    if (p != NULL) {
+        *p = tag;
+    }
+}
+
+static inline void ltv_mem_nil(ltv_encoder_t *e)                { ltv_mem_tag(e, LTV_NIL); }
+static inline void ltv_mem_struct_start(ltv_encoder_t *e)       { ltv_mem_tag(e, LTV_STRUCT); }
+static inline void ltv_mem_struct_end(ltv_encoder_t *e)         { ltv_mem_tag(e, LTV_END); }
+static inline void ltv_mem_list_start(ltv_encoder_t *e)         { ltv_mem_tag(e, LTV_LIST); }
+static inline void ltv_mem_list_end(ltv_encoder_t *e)           { ltv_mem_tag(e, LTV_END); }
+
+static inline void ltv_mem_bool(ltv_encoder_t *e, bool val) {
+    uint8_t b = val;
+    ltv_mem_single(e, LTV_BOOL, &b, sizeof(uint8_t));
+}
+
+static inline void ltv_mem_i8(ltv_encoder_t *e, int8_t val)     { ltv_mem_single(e, LTV_I8, &val, sizeof(val)); }
+static inline void ltv_mem_i16(ltv_encoder_t *e, int16_t val)   { ltv_mem_single(e, LTV_I16, &val, sizeof(val)); }
+static inline void ltv_mem_i32(ltv_encoder_t *e, int32_t val)   { ltv_mem_single(e, LTV_I32, &val, sizeof(val)); }
+static inline void ltv_mem_i64(ltv_encoder_t *e, int64_t val)   { ltv_mem_single(e, LTV_I64, &val, sizeof(val)); }
+static inline void ltv_mem_u8(ltv_encoder_t *e, uint8_t val)    { ltv_mem_single(e, LTV_U8, &val, sizeof(val)); }
+static inline void ltv_mem_u16(ltv_encoder_t *e, uint16_t val)  { ltv_mem_single(e, LTV_U16, &val, sizeof(val)); }
+static inline void ltv_mem_u32(ltv_encoder_t *e, uint32_t val)  { ltv_mem_single(e, LTV_U32, &val, sizeof(val)); }
+static inline void ltv_mem_u64(ltv_encoder_t *e, uint64_t val)  { ltv_mem_single(e, LTV_U64, &val, sizeof(val)); }
+static inline void ltv_mem_f32(ltv_encoder_t *e, float val)     { ltv_mem_single(e, LTV_F32, &val, sizeof(val)); }
+static inline void ltv_mem_f64(ltv_encoder_t *e, double val)    { ltv_mem_single(e, LTV_F64, &val, sizeof(val)); }
+
+// Vector writer with the element size known at the call site.
+// Mirrors ltv_write_vector: same size code selection and NOP padding.
+static inline void ltv_mem_vector(ltv_encoder_t *e, uint8_t type_code, size_t type_size, 
+                                  const void *buf, size_t count) {
+    if (e->cursor == NULL || e->align_records != NULL) {
+        ltv_write_vector(e, type_code, (const uint8_t*) buf, count);
+        return;
+    }
+
+    size_t len = count * type_size;
+
+    int exp = 3;
+    if (len < INT8_MAX) {
+        exp = 0;
+    } else if (len < INT16_MAX) {
+        exp = 1;
+    } else if (len < INT32_MAX) {
+        exp = 2;
+    }
+    size_t lenSize = (size_t)1 << exp;
+
+    size_t paddingLen = 0;
+#ifdef LTV_VECTOR_ALIGNMENT
+    size_t alignmentDelta = (e->offset + 1 + lenSize) & (type_size - 1);
+    if (alignmentDelta != 0) {
+        paddingLen = type_size - alignmentDelta;
+    }
+#endif
+
+    uint8_t *p = ltv_mem_reserve(e, paddingLen + 1 + lenSize + len);
+    if (p == NULL) {
+        return;
+    }
+
+    memset(p, LTV_NOP_TAG, paddingLen);
+    p += paddingLen;
+    *p++ = (type_code << 4) | (LTV_SIZE_1 + exp);
+    memcpy(p, &len, lenSize);
+    memcpy(p + lenSize, buf, len);
+}
+
+static inline void ltv_mem_string(ltv_encoder_t *e, const char *val) {
+    ltv_mem_vector(e, LTV_STRING, 1, val, strlen(val));
+}
+
+static inline void ltv_mem_string_n(ltv_encoder_t *e, const char *val, size_t len) {
+    ltv_mem_vector(e, LTV_STRING, 1, val, len);
+}
+
+static inline void ltv_mem_key(ltv_encoder_t *e, const ltv_key_t *key) {
+    size_t len = 2 + key->len;
+    if (e->cursor == NULL) {
+        ltv_write(e, &key->tag, len);
+        return;
+    }
+
+    uint8_t *p = ltv_mem_reserve(e, len);
+    if (p != NULL) {
+        memcpy(p, &key->tag, len);
+    }
+}
+
+static inline void ltv_mem_bool_vec(ltv_encoder_t *e, const bool *val, size_t count)      { ltv_mem_vector(e, LTV_BOOL, 1, val, count); }
+static inline void ltv_mem_i8_vec(ltv_encoder_t *e, const int8_t *val, size_t count)      { ltv_mem_vector(e, LTV_I8, 1, val, count); }
+static inline void ltv_mem_i16_vec(ltv_encoder_t *e, const int16_t *val, size_t count)    { ltv_mem_vector(e, LTV_I16, 2, val, count); }
+static inline void ltv_mem_i32_vec(ltv_encoder_t *e, const int32_t *val, size_t count)    { ltv_mem_vector(e, LTV_I32, 4, val, count); }
+static inline void ltv_mem_i64_vec(ltv_encoder_t *e, const int64_t *val, size_t count)    { ltv_mem_vector(e, LTV_I64, 8, val, count); }
+static inline void ltv_mem_u8_vec(ltv_encoder_t *e, const uint8_t *val, size_t count)     { ltv_mem_vector(e, LTV_U8, 1, val, count); }
+static inline void ltv_mem_u16_vec(ltv_encoder_t *e, const uint16_t *val, size_t count)   { ltv_mem_vector(e, LTV_U16, 2, val, count); }
+static inline void ltv_mem_u32_vec(ltv_encoder_t *e, const uint32_t *val, size_t count)   { ltv_mem_vector(e, LTV_U32, 4, val, count); }
+static inline void ltv_mem_u64_vec(ltv_encoder_t *e, const uint64_t *val, size_t count)   { ltv_mem_vector(e, LTV_U64, 8, val, count); }
+static inline void ltv_mem_f32_vec(ltv_encoder_t *e, const float *val, size_t count)      { ltv_mem_vector(e, LTV_F32, 4, val, count); }
+static inline void ltv_mem_f64_vec(ltv_encoder_t *e, const double *val, size_t count)     { ltv_mem_vector(e, LTV_F64, 8, val, count); }
+
+#endif //_LITEVECTORS_MEM_H
@@ -0,0 +1,191 @@
+#include "litevectors.h"
+#include "litevectors_query.h"
+
+#include <string.h>
+
+// Internal status: the hit callback asked to stop.
+#define LTV_QUERY_STOPPED  -1
+
+int ltv_query_compile(ltv_query_t *q, const char *path) {
+    const char *p = path;
+    q->step_count = 0;
+    q->keys_len = 0;
+
+    while (*p != 0) {
+        if (q->step_count == LTV_QUERY_MAX_STEPS) {
+            return LTV_QUERY_INVALID_PATH;
+        }
+        ltv_query_step_t *s = &q->steps[q->step_count];
+
+        if (*p == '[') {
+            p++;
+            if (p[0] == '*' && p[1] == ']') {
+                s->kind = LTV_QUERY_ANY_INDEX;
+                p += 2;
+            } else {
+                uint64_t index = 0;
+                const char *digits = p;
+                while (*p >= '0' && *p <= '9') {
+                    index = index * 10 + (*p++ - '0');
+                    if (index >= UINT32_MAX) {
+                        return LTV_QUERY_INVALID_PATH;
+                    }
+                }
+                if (p == digits || *p != ']') {
+                    return LTV_QUERY_INVALID_PATH;
+                }
+                p++;
+                s->kind = LTV_QUERY_INDEX;
+                s->index = (uint32_t)index;
+            }
+        } else {
+            // Keys after the first step follow a '.'
+            if (q->step_count > 0 && *p++ != '.') {
+                return LTV_QUERY_INVALID_PATH;
+            }
+
+            const char *key = p;
+            while (*p != 0 && *p != '.' && *p != '[') {
+                p++;
+            }
+            size_t len = p - key;
+            if (len == 0 || len > UINT8_MAX || len > LTV_QUERY_KEYS_SIZE - q->keys_len) {
+                return LTV_QUERY_INVALID_PATH;
+            }
+
+            if (len == 1 && *key == '*') {
+                s->kind = LTV_QUERY_ANY_KEY;
+            } else {
+                s->kind = LTV_QUERY_KEY;
+                s->key_len = (uint8_t)len;
+                s->key_offset = (uint16_t)q->keys_len;
+                memcpy(&q->keys[q->keys_len], key, len);
+                q->keys_len += len;
+            }
+        }
+        q->step_count++;
+    }
+    return LTV_SUCCESS;
+}
+
+// Step over the rest of any containers opened below 'depth'.
+static int ltv_query_leave(ltv_decoder_t *d, size_t depth) {
+    while (d->nest_depth > depth) {
+        int status = ltv_skip(d);
+        if (status != LTV_SUCCESS) {
+            return status == LTV_DECODE_EOF ? LTV_DECODE_UNEXPECTED_EOF : status;
+        }
+    }
+    return LTV_SUCCESS;
+}
+
+// Match the steps from 'step' on against the value just decoded into 'data'.
+static int ltv_query_match(const ltv_query_t *q, ltv_decoder_t *d, const ltv_data_t *data, size_t step,
+                           ltv_query_hit hit, void *user_data) {
+    bool open = data->type_code == LTV_STRUCT || data->type_code == LTV_LIST;
+    size_t depth = d->nest_depth - (open ? 1 : 0);
+    ltv_data_t next;
+    int status;
+
+    if (step == q->step_count) {
+        if (!hit(data, d, user_data)) {
+            return LTV_QUERY_STOPPED;
+        }
+        return ltv_query_leave(d, depth);
+    }
+
+    const ltv_query_step_t *s = &q->steps[step];
+
+    if (data->type_code == LTV_STRUCT && (s->kind == LTV_QUERY_KEY || s->kind == LTV_QUERY_ANY_KEY)) {
+        const char *key = &q->keys[s->key_offset];
+        for (;;) {
+            if ((status = ltv_next(d, &next)) != LTV_SUCCESS) {
+                return status;
+            }
+            if (next.type_code == LTV_END) {
+                return LTV_SUCCESS;
+            }
+
+            // Unvalidated data may have keys that aren't strings.
+            if (s->kind == LTV_QUERY_ANY_KEY ||
+                (next.type_code == LTV_STRING && next.length == s->key_len &&
+                 memcmp(next.val.v_buffer, key, s->key_len) == 0)) {
+                if ((status = ltv_next(d, &next)) != LTV_SUCCESS) {
+                    return status;
+                }
+                if ((status = ltv_query_match(q, d, &next, step + 1, hit, user_data)) != LTV_SUCCESS) {
+                    return status;
+                }
+                if (s->kind == LTV_QUERY_KEY) {
+                    return ltv_query_leave(d, depth);
+                }
+            } else if ((status = ltv_skip(d)) != LTV_SUCCESS) {
+                return status;
+            }
+        }
+    }
+
+    if (data->type_code == LTV_LIST && (s->kind == LTV_QUERY_INDEX || s->kind == LTV_QUERY_ANY_INDEX)) {
+        // Step over the elements before the index. Skipping the list end
+        // leaves the list.
+        if (s->kind == LTV_QUERY_INDEX) {
+            for (uint32_t i = 0; i < s->index && d->nest_depth > depth; i++) {
+                if ((status = ltv_skip(d)) != LTV_SUCCESS) {
+                    return status;
+                }
+            }
+        }
+
+        while (d->nest_depth > depth) {
+            if ((status = ltv_next(d, &next)) != LTV_SUCCESS) {
+                return status;
+            }
+            if (next.type_code == LTV_END) {
+                return LTV_SUCCESS;
+            }
+            if ((status = ltv_query_match(q, d, &next, step + 1, hit, user_data)) != LTV_SUCCESS) {
+                return status;
+            }
+            if (s->kind == LTV_QUERY_INDEX) {
+                return ltv_query_leave(d, depth);
+            }
+        }
+        return LTV_SUCCESS;
+    }
+
+    // The path doesn't continue into this value.
+    return ltv_query_leave(d, depth);
+}
+
+int ltv_query_run(const ltv_query_t *q, ltv_decoder_t *d, ltv_query_hit hit, void *user_data) {
+    ltv_data_t data;
+    int status;
+
+    // Finish any value a previous hit left the decoder inside.
+    if ((status = ltv_query_leave(d, 0)) != LTV_SUCCESS) {
+        return status;
+    }
+
+    for (;;) {
+        if ((status = ltv_next(d, &data)) != LTV_SUCCESS) {
+            return status;
+        }
+        status = ltv_query_match(q, d, &data, 0, hit, user_data);
+        if (status == LTV_QUERY_STOPPED) {
+            return LTV_SUCCESS;
+        }
+        if (status != LTV_SUCCESS) {
+            return status;
+        }
+    }
+}
+
+static bool ltv_query_first_hit(const ltv_data_t *data, ltv_decoder_t *d, void *user_data) {
+    (void) d;
+    *(ltv_data_t*)user_data = *data;
+    return false;
+}
+
+int ltv_query_first(const ltv_query_t *q, ltv_decoder_t *d, ltv_data_t *data) {
+    return ltv_query_run(q, d, ltv_query_first_hit, data);
+}
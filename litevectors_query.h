@@ -0,0 +1,70 @@
+#ifndef _LITEVECTORS_QUERY_H
+#define _LITEVECTORS_QUERY_H
+
+#include "litevectors.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// LiteVectors Path Queries
+//
+// A path such as "channels[3].calibration.gain" is compiled once and can then
+// be run against any number of buffers. Each step selects a struct member by
+// key ("name"), a list element by position ("[3]"), any member ("*") or any
+// element ("[*]"). Keys can't contain '.' or '['.
+//
+// The path is applied to each top level value in turn. Members and elements
+// the path doesn't lead into are stepped over with ltv_skip, so their
+// contents are never decoded.
+////////////////////////////////////////////////////////////////////////////////
+
+// ltv_query_compile returns LTV_QUERY_INVALID_PATH, defined in litevectors.h
+// with the other status codes, for a path it can't parse.
+
+// Limits on compiled paths.
+#define LTV_QUERY_MAX_STEPS      LTV_MAX_NESTING_DEPTH
+#define LTV_QUERY_KEYS_SIZE      256
+
+// Step kinds
+#define LTV_QUERY_KEY            0
+#define LTV_QUERY_INDEX          1
+#define LTV_QUERY_ANY_KEY        2
+#define LTV_QUERY_ANY_INDEX      3
+
+typedef struct {
+    uint8_t kind;
+    uint8_t key_len;
+    uint16_t key_offset;
+    uint32_t index;
+} ltv_query_step_t;
+
+typedef struct {
+    ltv_query_step_t steps[LTV_QUERY_MAX_STEPS];
+    size_t step_count;
+
+    // Key text for the steps, not terminated.
+    char keys[LTV_QUERY_KEYS_SIZE];
+    size_t keys_len;
+} ltv_query_t;
+
+// Called for each value matched by a query. 'd' is positioned just after
+// the value, inside it for a struct or list. The callback may decode further,
+// and the query then steps over whatever is left of the value.
+// Return false to stop the query, leaving 'd' where the callback left it.
+typedef bool (*ltv_query_hit)(const ltv_data_t *data, ltv_decoder_t *d, void *user_data);
+
+// Compile 'path'. Returns LTV_SUCCESS or LTV_QUERY_INVALID_PATH.
+int ltv_query_compile(ltv_query_t *q, const char *path);
+
+// Run a query over the top level values from the decoder's position to the
+// end of its buffer, calling 'hit' for each match. If the decoder is inside
+// a container (where a stopped query left it), the rest of that top level
+// value is stepped over first. Returns LTV_DECODE_EOF once the whole buffer
+// has been searched, LTV_SUCCESS if the callback stopped the query, or a 
+// decoder error.
+int ltv_query_run(const ltv_query_t *q, ltv_decoder_t *d, ltv_query_hit hit, void *user_data);
+
+// Find the first match. Returns LTV_SUCCESS with the value in 'data' and the
+// decoder positioned just after it, LTV_DECODE_EOF if there is none, or a
+// decoder error. Calling it again continues with the next top level value.
+int ltv_query_first(const ltv_query_t *q, ltv_decoder_t *d, ltv_data_t *data);
+
+#endif //_LITEVECTORS_QUERY_H
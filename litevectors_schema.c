@@ -0,0 +1,299 @@
+#include "litevectors.h"
+#include "litevectors_schema.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Encoder
+////////////////////////////////////////////////////////////////////////////////
+
+static void ltv_schema_encode_single(ltv_encoder_t *e, uint8_t type_code, const uint8_t *p) {
+    switch (type_code) {
+        case LTV_BOOL: ltv_bool(e, *(const bool*)p); break;
+        case LTV_U8:   ltv_u8(e, *(const uint8_t*)p); break;
+        case LTV_U16:  ltv_u16(e, *(const uint16_t*)p); break;
+        case LTV_U32:  ltv_u32(e, *(const uint32_t*)p); break;
+        case LTV_U64:  ltv_u64(e, *(const uint64_t*)p); break;
+        case LTV_I8:   ltv_i8(e, *(const int8_t*)p); break;
+        case LTV_I16:  ltv_i16(e, *(const int16_t*)p); break;
+        case LTV_I32:  ltv_i32(e, *(const int32_t*)p); break;
+        case LTV_I64:  ltv_i64(e, *(const int64_t*)p); break;
+        case LTV_F32:  ltv_f32(e, *(const float*)p); break;
+        case LTV_F64:  ltv_f64(e, *(const double*)p); break;
+        default:       ltv_nil(e); break;
+    }
+}
+
+void ltv_schema_encode(ltv_encoder_t *e, const ltv_schema_t *schema, const void *obj) {
+    const uint8_t *base = obj;
+
+    ltv_struct_start(e);
+    for (size_t i = 0; i < schema->field_count; i++) {
+        const ltv_field_t *f = &schema->fields[i];
+        const uint8_t *p = base + f->offset;
+
+        ltv_key(e, &f->key);
+        if (f->type_code == LTV_STRUCT) {
+            if (f->count == 0) {
+                ltv_schema_encode(e, f->schema, p);
+            } else {
+                ltv_list_start(e);
+                for (size_t n = 0; n < f->count; n++) {
+                    ltv_schema_encode(e, f->schema, p + n * f->schema->size);
+                }
+                ltv_list_end(e);
+            }
+        } else if (f->type_code == LTV_STRING) {
+            const char *s = (const char*)p;
+            const char *end = memchr(s, 0, f->count);
+            ltv_string_n(e, s, end != NULL ? (size_t)(end - s) : f->count);
+        } else if (f->count > 0) {
+            ltv_write_vector(e, f->type_code, p, f->count);
+        } else {
+            ltv_schema_encode_single(e, f->type_code, p);
+        }
+    }
+    ltv_struct_end(e);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Decoder
+////////////////////////////////////////////////////////////////////////////////
+
+// Store a single number or bool in a field of type 'type_code'.
+static int ltv_schema_store(uint8_t type_code, uint8_t *p, const ltv_data_t *v) {
+    bool is_unsigned = v->type_code >= LTV_U8 && v->type_code <= LTV_U64;
+    bool is_signed = v->type_code >= LTV_I8 && v->type_code <= LTV_I64;
+
+    if (v->size_code != LTV_SINGLE) {
+        return LTV_SCHEMA_TYPE_MISMATCH;
+    }
+
+    if (type_code == LTV_BOOL) {
+        if (v->type_code != LTV_BOOL) {
+            return LTV_SCHEMA_TYPE_MISMATCH;
+        }
+        *(bool*)p = v->val.v_uint != 0;
+        return LTV_SUCCESS;
+    }
+
+    if (type_code == LTV_F32 || type_code == LTV_F64) {
+        double x;
+        if (v->type_code == LTV_F32) x = v->val.v_float32;
+        else if (v->type_code == LTV_F64) x = v->val.v_float64;
+        else if (is_unsigned) x = (double)v->val.v_uint;
+        else if (is_signed) x = (double)v->val.v_int;
+        else return LTV_SCHEMA_TYPE_MISMATCH;
+
+        if (type_code == LTV_F64) {
+            *(double*)p = x;
+        } else if (v->type_code == LTV_F32) {
+            *(float*)p = v->val.v_float32;
+        } else {
+            if ((x > FLT_MAX || x < -FLT_MAX) && !isinf(x)) {
+                return LTV_SCHEMA_RANGE;
+            }
+            *(float*)p = (float)x;
+        }
+        return LTV_SUCCESS;
+    }
+
+    if (!is_unsigned && !is_signed) {
+        return LTV_SCHEMA_TYPE_MISMATCH;
+    }
+
+    // Integers: check the value fits the field, then store its low bytes.
+    size_t size = ltv_type_sizes[type_code];
+    uint64_t raw = v->val.v_uint;
+    if (type_code >= LTV_U8 && type_code <= LTV_U64) {
+        uint64_t max = size == 8 ? UINT64_MAX : (1ull << (size * 8)) - 1;
+        if ((is_signed && v->val.v_int < 0) || raw > max) {
+            return LTV_SCHEMA_RANGE;
+        }
+    } else if (type_code >= LTV_I8 && type_code <= LTV_I64) {
+        int64_t max = size == 8 ? INT64_MAX : (int64_t)((1ull << (size * 8 - 1)) - 1);
+        if ((is_unsigned && raw > (uint64_t)max) || (is_signed && (v->val.v_int > max || v->val.v_int < -max - 1))) {
+            return LTV_SCHEMA_RANGE;
+        }
+    } else {
+        return LTV_SCHEMA_TYPE_MISMATCH;
+    }
+    memcpy(p, &raw, size);
+    return LTV_SUCCESS;
+}
+
+static int ltv_schema_decode_fields(ltv_decoder_t *d, const ltv_schema_t *schema, uint8_t *base);
+
+// Decode the value just read into 'v' into field 'f'.
+static int ltv_schema_decode_value(ltv_decoder_t *d, const ltv_field_t *f, uint8_t *p, const ltv_data_t *v) {
+    if (f->type_code == LTV_STRUCT) {
+        if (f->count == 0) {
+            if (v->type_code != LTV_STRUCT) {
+                return LTV_SCHEMA_TYPE_MISMATCH;
+            }
+            return ltv_schema_decode_fields(d, f->schema, p);
+        }
+
+        if (v->type_code != LTV_LIST) {
+            return LTV_SCHEMA_TYPE_MISMATCH;
+        }
+        for (size_t n = 0; ; n++) {
+            ltv_data_t item;
+            int status = ltv_next(d, &item);
+            if (status != LTV_SUCCESS) {
+                return status;
+            }
+            if (item.type_code == LTV_END) {
+                return LTV_SUCCESS;
+            }
+            if (n == f->count) {
+                return LTV_SCHEMA_RANGE;
+            }
+            if (item.type_code != LTV_STRUCT) {
+                return LTV_SCHEMA_TYPE_MISMATCH;
+            }
+            status = ltv_schema_decode_fields(d, f->schema, p + n * f->schema->size);
+            if (status != LTV_SUCCESS) {
+                return status;
+            }
+        }
+    }
+
+    if (f->type_code == LTV_STRING) {
+        if (v->type_code != LTV_STRING) {
+            return LTV_SCHEMA_TYPE_MISMATCH;
+        }
+        if (v->length >= f->count) {
+            return LTV_SCHEMA_RANGE;
+        }
+        memcpy(p, v->val.v_buffer, v->length);
+        p[v->length] = 0;
+        return LTV_SUCCESS;
+    }
+
+    if (f->count > 0) {
+        if (v->type_code != f->type_code || v->size_code == LTV_SINGLE) {
+            return LTV_SCHEMA_TYPE_MISMATCH;
+        }
+        if (v->length > f->count * ltv_type_sizes[f->type_code]) {
+            return LTV_SCHEMA_RANGE;
+        }
+        if (f->type_code == LTV_BOOL) {
+            // Any non-zero byte is true, but C bools must hold 0 or 1.
+            for (size_t n = 0; n < v->length; n++) {
+                ((bool*)p)[n] = v->val.v_buffer[n] != 0;
+            }
+        } else {
+            memcpy(p, v->val.v_buffer, v->length);
+        }
+        return LTV_SUCCESS;
+    }
+
+    return ltv_schema_store(f->type_code, p, v);
+}
+
+// Decode the members of a struct whose start tag has been read.
+static int ltv_schema_decode_fields(ltv_decoder_t *d, const ltv_schema_t *schema, uint8_t *base) {
+    ltv_data_t k, v;
+    size_t next = 0;
+    int status;
+
+    for (;;) {
+        if ((status = ltv_next(d, &k)) != LTV_SUCCESS) {
+            return status;
+        }
+        if (k.type_code == LTV_END) {
+            return LTV_SUCCESS;
+        }
+
+        // The field after the last one matched, then the index or the rest
+        // of the table.
+        const ltv_field_t *f = NULL;
+        if (k.type_code == LTV_STRING && schema->field_count > 0) {
+            size_t count = schema->field_count;
+            size_t start = next < count ? next : 0;
+            const ltv_key_t *key = &schema->fields[start].key;
+            size_t i = KEY_MATCHER_NONE;
+
+            if (k.length == key->len && memcmp(k.val.v_buffer, key->str, key->len) == 0) {
+                i = start;
+            } else if (schema->matcher != NULL) {
+                i = key_matcher_lookup(schema->matcher, k.val.v_buffer, k.length);
+            } else {
+                for (size_t n = 1; n < count; n++) {
+                    size_t j = start + n < count ? start + n : start + n - count;
+                    key = &schema->fields[j].key;
+                    if (k.length == key->len && memcmp(k.val.v_buffer, key->str, key->len) == 0) {
+                        i = j;
+                        break;
+                    }
+                }
+            }
+            if (i != KEY_MATCHER_NONE) {
+                f = &schema->fields[i];
+                next = i + 1;
+            }
+        }
+
+        if (f == NULL) {
+            if ((status = ltv_skip(d)) != LTV_SUCCESS) {
+                return status == LTV_DECODE_EOF ? LTV_DECODE_UNEXPECTED_EOF : status;
+            }
+            continue;
+        }
+
+        if ((status = ltv_next(d, &v)) != LTV_SUCCESS) {
+            return status;
+        }
+        if ((status = ltv_schema_decode_value(d, f, base + f->offset, &v)) != LTV_SUCCESS) {
+            return status;
+        }
+    }
+}
+
+int ltv_schema_decode(ltv_decoder_t *d, const ltv_schema_t *schema, void *obj) {
+    ltv_data_t v;
+    int status = ltv_next(d, &v);
+    if (status != LTV_SUCCESS) {
+        return status;
+    }
+    if (v.type_code != LTV_STRUCT) {
+        return LTV_SCHEMA_TYPE_MISMATCH;
+    }
+    return ltv_schema_decode_fields(d, schema, obj);
+}
+
+bool ltv_schema_index(ltv_schema_t *schema) {
+    size_t count = schema->field_count;
+
+    // The matcher, and the names and lengths it refers to, in one block.
+    key_matcher_t *m = malloc(sizeof(key_matcher_t) + count * (sizeof(const char*) + sizeof(size_t)));
+    if (m == NULL) {
+        return false;
+    }
+    const char **names = (const char**)(m + 1);
+    size_t *lens = (size_t*)(names + count);
+    for (size_t i = 0; i < count; i++) {
+        names[i] = schema->fields[i].key.str;
+        lens[i] = schema->fields[i].key.len;
+    }
+
+    if (!key_matcher_init_n(m, names, lens, count)) {
+        free(m);
+        return false;
+    }
+    ltv_schema_index_free(schema);
+    schema->matcher = m;
+    return true;
+}
+
+void ltv_schema_index_free(ltv_schema_t *schema) {
+    if (schema->matcher != NULL) {
+        key_matcher_free(schema->matcher);
+        free(schema->matcher);
+        schema->matcher = NULL;
+    }
+}
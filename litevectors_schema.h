@@ -0,0 +1,109 @@
+#ifndef _LITEVECTORS_SCHEMA_H
+#define _LITEVECTORS_SCHEMA_H
+
+#include "litevectors.h"
+#include "litevectors_util.h"
+
+#include <stddef.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// LiteVectors Schema Binding
+//
+// A schema is a static table describing the members of a C struct: the key
+// each is written under, where it is in the struct and its LiteVectors type.
+// One generic encoder and decoder then replace a hand-written serialize and
+// deserialize pair for each struct.
+//
+//     static const ltv_field_t my_fields[] = {
+//         LTV_FIELD_STRING(struct MyData, Name),
+//         LTV_FIELD(struct MyData, Setting_A, LTV_U32),
+//         LTV_FIELD_ARRAY(struct MyData, CalibrationVector, LTV_F32),
+//     };
+//     static const ltv_schema_t my_schema = LTV_SCHEMA(struct MyData, my_fields);
+//
+// Each struct is encoded as a LiteVectors struct with its members in table
+// order. Keys are pre-encoded (ltv_key_t) and arrays are written as vectors
+// straight from the struct. The decoder matches keys in table order first,
+// so data written by ltv_schema_encode needs one comparison per key, and
+// copies vector payloads straight into the struct arrays. Other keys are
+// looked up in a key_matcher_t once the schema is indexed (ltv_schema_index),
+// or by scanning the fields.
+//
+// tools/ltvgen.py generates the structs and a specialized encoder and
+// decoder for each from a schema file, with the same behavior as a table.
+////////////////////////////////////////////////////////////////////////////////
+
+// Decoding errors LTV_SCHEMA_TYPE_MISMATCH and LTV_SCHEMA_RANGE are defined in
+// litevectors.h with the other status codes.
+
+typedef struct ltv_schema ltv_schema_t;
+
+typedef struct {
+    ltv_key_t key;
+    size_t offset;
+
+    // LTV_BOOL or LTV_U8 to LTV_F64 for numbers, LTV_STRING for a char
+    // array, or LTV_STRUCT for a nested struct described by 'schema'.
+    uint8_t type_code;
+
+    // 0 for a single value. Otherwise the number of array elements, written
+    // as a vector (a list, for structs), or the char array size for strings.
+    size_t count;
+
+    const ltv_schema_t *schema;
+} ltv_field_t;
+
+struct ltv_schema {
+    const ltv_field_t *fields;
+    size_t field_count;
+
+    // sizeof the C struct, the stride of arrays of it.
+    size_t size;
+
+    // Built by ltv_schema_index, NULL otherwise.
+    key_matcher_t *matcher;
+};
+
+// Number of elements of an array member.
+#define LTV_MEMBER_COUNT(type, member) (sizeof(((type*)0)->member) / sizeof(((type*)0)->member[0]))
+
+// Field initializers. The key is the member name.
+#define LTV_FIELD(type, member, type_code) \
+    { LTV_KEY(#member), offsetof(type, member), type_code, 0, NULL }
+#define LTV_FIELD_ARRAY(type, member, type_code) \
+    { LTV_KEY(#member), offsetof(type, member), type_code, LTV_MEMBER_COUNT(type, member), NULL }
+#define LTV_FIELD_STRING(type, member) \
+    { LTV_KEY(#member), offsetof(type, member), LTV_STRING, sizeof(((type*)0)->member), NULL }
+#define LTV_FIELD_STRUCT(type, member, schema) \
+    { LTV_KEY(#member), offsetof(type, member), LTV_STRUCT, 0, &(schema) }
+#define LTV_FIELD_STRUCT_ARRAY(type, member, schema) \
+    { LTV_KEY(#member), offsetof(type, member), LTV_STRUCT, LTV_MEMBER_COUNT(type, member), &(schema) }
+
+// Schema initializer from a field array.
+#define LTV_SCHEMA(type, fields) { fields, sizeof(fields) / sizeof(fields[0]), sizeof(type), NULL }
+
+// Index the keys of 'schema', so that a key out of table order costs one
+// hash lookup rather than a scan of the fields. Worth doing for schemas with
+// more than a few fields that decode data from other writers. Nested schemas
+// are indexed separately. Returns false if memory can't be allocated or a
+// key is repeated. Decoding doesn't modify the index, so an indexed schema
+// can still be shared by threads.
+bool ltv_schema_index(ltv_schema_t *schema);
+
+// Release the index built by ltv_schema_index.
+void ltv_schema_index_free(ltv_schema_t *schema);
+
+// Encode the struct at 'obj'. Errors are reported in the encoder status.
+// Strings are written up to their terminating NUL, or the whole array.
+void ltv_schema_encode(ltv_encoder_t *e, const ltv_schema_t *schema, const void *obj);
+
+// Decode the next value, which must be a struct, into 'obj'. Members with
+// no key in the data are left as they are, and keys not in the schema are
+// skipped. Integers and floats are converted to the field type when the
+// value fits, and integers are accepted for float fields. Arrays take a
+// vector of their exact type, with any elements past its end left as they
+// are. Strings are NUL terminated.
+// Returns LTV_SUCCESS, a decoder error or a LTV_SCHEMA_* error.
+int ltv_schema_decode(ltv_decoder_t *d, const ltv_schema_t *schema, void *obj);
+
+#endif //_LITEVECTORS_SCHEMA_H
@@ -1,7 +1,25 @@
+// Declare the POSIX functions used below (pwrite, fdatasync) even when
+// building with a strict -std option.
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "litevectors.h"
 #include "litevectors_util.h"
 
 #include <string.h>
+#include <stdlib.h>
+
+#ifdef LTV_UTIL_POSIX
+#include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
 
 #define ARRAY_LEN(x) sizeof(x)/sizeof(x[0])
 
@@ -21,6 +39,14 @@ const char* ltv_status_text(int status_code) {
         case LTV_DECODE_MAX_DEPTH_REACHED: return "LTV_DECODE_MAX_DEPTH_REACHED: The incoming structure is nested deeper than the decoder is able to track.";
         case LTV_DECODE_NEST_MISMATCH: return "LTV_DECODE_NEST_MISMATCH: An unexpected END tag was found.";
         case LTV_DECODE_INVALID_UTF8: return "LTV_DECODE_INVALID_UTF8: A string was found that was not valid UTF-8";
+        case LTV_DECODE_NEED_DATA: return "LTV_DECODE_NEED_DATA: The stream decoder needs the next chunk of input";
+        case LTV_DECODE_CARRY_FULL: return "LTV_DECODE_CARRY_FULL: A value split across chunks is larger than the carry buffer";
+        case LTV_DECODE_READ_ERROR: return "LTV_DECODE_READ_ERROR: The reader callback returned an error";
+        case LTV_DECODE_PAYLOAD_TOO_SMALL: return "LTV_DECODE_PAYLOAD_TOO_SMALL: The payload buffer can't hold one element";
+        case LTV_INDEX_FULL: return "LTV_INDEX_FULL: The structural index ran out of entries";
+        case LTV_QUERY_INVALID_PATH: return "LTV_QUERY_INVALID_PATH: The query path could not be parsed";
+        case LTV_SCHEMA_TYPE_MISMATCH: return "LTV_SCHEMA_TYPE_MISMATCH: A value can't be stored in its struct field";
+        case LTV_SCHEMA_RANGE: return "LTV_SCHEMA_RANGE: A value doesn't fit in its struct field";
         default: return "Unknown status code";
     }
 }
@@ -97,4 +123,729 @@ int static_buffer_writer(const uint8_t *buf, size_t len, void* user_data) {
     memcpy(&static_buf->data[static_buf->size], buf, len);
     static_buf->size += len;
     return 0;
-}
\ No newline at end of file
+}
+
+int static_buffer_patcher(size_t offset, const uint8_t *buf, size_t len, void* user_data) {
+    static_buffer_t* static_buf = user_data;
+
+    if (offset > static_buf->size || len > static_buf->size - offset) {
+        return -1;
+    }
+
+    memcpy(&static_buf->data[offset], buf, len);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// dynamic_buffer_writer
+////////////////////////////////////////////////////////////////////////////////
+
+// Smallest allocation made by a dynamic buffer.
+#define DYNAMIC_BUFFER_MIN_CAPACITY 256
+
+static void* default_resize(void *ptr, size_t old_size, size_t new_size, void *user_data) {
+    (void) old_size;
+    (void) user_data;
+    return realloc(ptr, new_size);
+}
+
+static void default_release(void *ptr, size_t size, void *user_data) {
+    (void) size;
+    (void) user_data;
+    free(ptr);
+}
+
+static const ltv_allocator_t default_allocator = {
+    .resize = default_resize,
+    .release = default_release,
+    .user_data = NULL,
+};
+
+bool dynamic_buffer_init(dynamic_buffer_t *b, size_t initial_capacity, const ltv_allocator_t *allocator) {
+    b->data = NULL;
+    b->size = 0;
+    b->capacity = 0;
+    b->allocator = allocator != NULL ? allocator : &default_allocator;
+
+    return initial_capacity == 0 || dynamic_buffer_reserve(b, initial_capacity);
+}
+
+bool dynamic_buffer_reserve(dynamic_buffer_t *b, size_t capacity) {
+    if (capacity <= b->capacity) {
+        return true;
+    }
+
+    // Grow geometrically to keep the number of reallocations logarithmic.
+    size_t new_capacity = b->capacity < DYNAMIC_BUFFER_MIN_CAPACITY ? DYNAMIC_BUFFER_MIN_CAPACITY : b->capacity;
+    while (new_capacity < capacity) {
+        if (new_capacity > SIZE_MAX / 2) {
+            new_capacity = capacity;
+            break;
+        }
+        new_capacity *= 2;
+    }
+
+    uint8_t *data = b->allocator->resize(b->data, b->capacity, new_capacity, b->allocator->user_data);
+    if (data == NULL) {
+        return false;
+    }
+
+    b->data = data;
+    b->capacity = new_capacity;
+    return true;
+}
+
+void dynamic_buffer_reset(dynamic_buffer_t *b) {
+    b->size = 0;
+}
+
+uint8_t* dynamic_buffer_detach(dynamic_buffer_t *b, size_t *size, size_t *capacity) {
+    uint8_t *data = b->data;
+    if (size != NULL) {
+        *size = b->size;
+    }
+    if (capacity != NULL) {
+        *capacity = b->capacity;
+    }
+
+    b->data = NULL;
+    b->size = 0;
+    b->capacity = 0;
+    return data;
+}
+
+void dynamic_buffer_free(dynamic_buffer_t *b) {
+    if (b->data != NULL) {
+        b->allocator->release(b->data, b->capacity, b->allocator->user_data);
+    }
+
+    b->data = NULL;
+    b->size = 0;
+    b->capacity = 0;
+}
+
+int dynamic_buffer_writer(const uint8_t *buf, size_t len, void* user_data) {
+
+    // Cast the dynamic buffer instance passed to us.
+    dynamic_buffer_t* dyn_buf = user_data;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    // Grow the buffer if needed
+    if (len > dyn_buf->capacity - dyn_buf->size) {
+        if (len > SIZE_MAX - dyn_buf->size || !dynamic_buffer_reserve(dyn_buf, dyn_buf->size + len)) {
+            return -1;
+        }
+    }
+
+    // Copy data to the dynamic buffer
+    memcpy(&dyn_buf->data[dyn_buf->size], buf, len);
+    dyn_buf->size += len;
+    return 0;
+}
+
+int dynamic_buffer_patcher(size_t offset, const uint8_t *buf, size_t len, void* user_data) {
+    dynamic_buffer_t* dyn_buf = user_data;
+
+    if (offset > dyn_buf->size || len > dyn_buf->size - offset) {
+        return -1;
+    }
+
+    memcpy(&dyn_buf->data[offset], buf, len);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// key_matcher_t
+////////////////////////////////////////////////////////////////////////////////
+
+// Marks an empty slot.
+#define KEY_MATCHER_EMPTY 0xFFFF
+
+// Displacements tried for each bucket before giving up.
+#define KEY_MATCHER_MAX_DISPLACE 0xFFFF
+
+static uint64_t key_matcher_hash(const uint8_t *s, size_t len) {
+    uint64_t h = len * 0x9E3779B97F4A7C15ull;
+    uint64_t w;
+
+    while (len >= 8) {
+        memcpy(&w, s, 8);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 31;
+        s += 8;
+        len -= 8;
+    }
+    if (len > 0) {
+        w = 0;
+        memcpy(&w, s, len);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+    }
+    h ^= h >> 32;
+    h *= 0x94D049BB133111EBull;
+    return h ^ (h >> 29);
+}
+
+// The top half of the hash picks a bucket, and the bucket's displacement
+// picks the slot.
+static inline size_t key_matcher_bucket(const key_matcher_t *m, uint64_t h) {
+    return (size_t)(((h >> 32) * m->bucket_count) >> 32);
+}
+
+static inline size_t key_matcher_slot(const key_matcher_t *m, uint64_t h, uint16_t d) {
+    return (size_t)(((h + d) * 0xD6E8FEB86659FD93ull) >> m->slot_shift);
+}
+
+bool key_matcher_init(key_matcher_t *m, const char *const *names, size_t count) {
+    return key_matcher_init_n(m, names, NULL, count);
+}
+
+bool key_matcher_init_n(key_matcher_t *m, const char *const *names, const size_t *lens, size_t count) {
+    memset(m, 0, sizeof(*m));
+    if (count >= KEY_MATCHER_EMPTY) {
+        return false;
+    }
+
+    // Slots are at most half full, with two names per bucket on average.
+    size_t slot_count = 4;
+    m->slot_shift = 62;
+    while (slot_count < count * 2) {
+        slot_count *= 2;
+        m->slot_shift--;
+    }
+
+    size_t n_buckets = count / 2 + 1;
+    m->names = names;
+    m->name_count = count;
+    m->bucket_count = n_buckets;
+    m->name_lens = malloc(count * sizeof(size_t) + 1);
+    m->displace = calloc(n_buckets, sizeof(uint16_t));
+    m->slots = malloc(slot_count * sizeof(uint16_t));
+
+    // Scratch: name hashes, names grouped by bucket, and buckets by size.
+    uint64_t *hashes = malloc(count * sizeof(uint64_t) + 1);
+    size_t *by_bucket = malloc(count * sizeof(size_t) + 1);
+    size_t *bucket_end = calloc(n_buckets, sizeof(size_t));
+    size_t *bucket_order = malloc(n_buckets * sizeof(size_t));
+    size_t *size_pos = calloc(count + 2, sizeof(size_t));
+    bool ok = m->name_lens != NULL && m->displace != NULL && m->slots != NULL && hashes != NULL &&
+              by_bucket != NULL && bucket_end != NULL && bucket_order != NULL && size_pos != NULL;
+
+    if (ok) {
+        memset(m->slots, 0xFF, slot_count * sizeof(uint16_t));
+        for (size_t i = 0; i < count; i++) {
+            m->name_lens[i] = lens != NULL ? lens[i] : strlen(names[i]);
+            hashes[i] = key_matcher_hash((const uint8_t*)names[i], m->name_lens[i]);
+            bucket_end[key_matcher_bucket(m, hashes[i])]++;
+        }
+
+        // Order the buckets largest first (a counting sort on size), so they 
+        // are placed while there is the most room.
+        for (size_t b = 0; b < n_buckets; b++) {
+            size_pos[count - bucket_end[b] + 1]++;
+        }
+        for (size_t n = 1; n <= count + 1; n++) {
+            size_pos[n] += size_pos[n - 1];
+        }
+        for (size_t b = 0; b < n_buckets; b++) {
+            bucket_order[size_pos[count - bucket_end[b]]++] = b;
+        }
+
+        // Group the names by bucket. Bucket b ends up holding 
+        // by_bucket[bucket_end[b - 1]] to by_bucket[bucket_end[b]].
+        for (size_t b = 1; b < n_buckets; b++) {
+            bucket_end[b] += bucket_end[b - 1];
+        }
+        for (size_t i = count; i-- > 0; ) {
+            by_bucket[--bucket_end[key_matcher_bucket(m, hashes[i])]] = i;
+        }
+        for (size_t b = 0; b < n_buckets; b++) {
+            bucket_end[b] = b + 1 < n_buckets ? bucket_end[b + 1] : count;
+        }
+    }
+
+    // Find a displacement for each bucket that puts all of its names in
+    // empty slots.
+    for (size_t k = 0; ok && k < n_buckets; k++) {
+        size_t bucket = bucket_order[k];
+        size_t start = bucket == 0 ? 0 : bucket_end[bucket - 1];
+        size_t end = bucket_end[bucket];
+        bool placed = start == end;
+
+        for (uint32_t d = 0; d <= KEY_MATCHER_MAX_DISPLACE && !placed; d++) {
+            size_t i = start;
+            for (; i < end; i++) {
+                size_t slot = key_matcher_slot(m, hashes[by_bucket[i]], d);
+                if (m->slots[slot] != KEY_MATCHER_EMPTY) {
+                    break;
+                }
+                m->slots[slot] = (uint16_t)by_bucket[i];
+            }
+
+            placed = i == end;
+            if (placed) {
+                m->displace[bucket] = (uint16_t)d;
+            } else {
+                // Undo this attempt.
+                while (i-- > start) {
+                    m->slots[key_matcher_slot(m, hashes[by_bucket[i]], d)] = KEY_MATCHER_EMPTY;
+                }
+            }
+        }
+        ok = placed;
+    }
+
+    free(hashes);
+    free(by_bucket);
+    free(bucket_end);
+    free(bucket_order);
+    free(size_pos);
+    if (!ok) {
+        key_matcher_free(m);
+    }
+    return ok;
+}
+
+size_t key_matcher_find(key_matcher_t *m, const ltv_data_t *key) {
+    if (key->type_code != LTV_STRING) {
+        return KEY_MATCHER_NONE;
+    }
+
+    // Keys in the expected order
+    size_t i = m->next;
+    if (i < m->name_count && key->length == m->name_lens[i] && 
+        memcmp(key->val.v_buffer, m->names[i], key->length) == 0) {
+        m->next = i + 1;
+        return i;
+    }
+
+    i = key_matcher_lookup(m, key->val.v_buffer, key->length);
+    if (i != KEY_MATCHER_NONE) {
+        m->next = i + 1;
+    }
+    return i;
+}
+
+size_t key_matcher_lookup(const key_matcher_t *m, const void *key, size_t len) {
+    if (m->name_count == 0) {
+        return KEY_MATCHER_NONE;
+    }
+
+    uint64_t h = key_matcher_hash(key, len);
+    size_t i = m->slots[key_matcher_slot(m, h, m->displace[key_matcher_bucket(m, h)])];
+    if (i == KEY_MATCHER_EMPTY || len != m->name_lens[i] || memcmp(key, m->names[i], len) != 0) {
+        return KEY_MATCHER_NONE;
+    }
+    return i;
+}
+
+void key_matcher_free(key_matcher_t *m) {
+    free(m->name_lens);
+    free(m->displace);
+    free(m->slots);
+    m->name_lens = NULL;
+    m->displace = NULL;
+    m->slots = NULL;
+    m->name_count = 0;
+}
+
+#ifdef LTV_UTIL_POSIX
+
+////////////////////////////////////////////////////////////////////////////////
+// fd_gather_writer, fd_writer, fd_reader
+////////////////////////////////////////////////////////////////////////////////
+
+// ltv_iovec_t is passed to writev() as is.
+_Static_assert(sizeof(ltv_iovec_t) == sizeof(struct iovec), "ltv_iovec_t does not match struct iovec");
+_Static_assert(offsetof(ltv_iovec_t, base) == offsetof(struct iovec, iov_base), "ltv_iovec_t does not match struct iovec");
+_Static_assert(offsetof(ltv_iovec_t, len) == offsetof(struct iovec, iov_len), "ltv_iovec_t does not match struct iovec");
+
+// Number of segments passed to each writev() call.
+#define FD_WRITEV_BATCH 64
+
+int fd_gather_writer(const ltv_iovec_t *iov, size_t iov_count, void* user_data) {
+    int fd = *(int*)user_data;
+
+    // The first segment may be partially written, so work on a copy of it.
+    ltv_iovec_t first = {NULL, 0};
+    if (iov_count > 0) {
+        first = iov[0];
+    }
+
+    while (iov_count > 0) {
+        struct iovec vec[FD_WRITEV_BATCH];
+        size_t n = iov_count < FD_WRITEV_BATCH ? iov_count : FD_WRITEV_BATCH;
+        memcpy(vec, iov, n * sizeof(struct iovec));
+        vec[0].iov_base = (void*) first.base;
+        vec[0].iov_len = first.len;
+
+        ssize_t written = writev(fd, vec, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+
+        // Skip over the fully written segments
+        size_t remaining = written;
+        while (iov_count > 0 && remaining >= first.len) {
+            remaining -= first.len;
+            iov++;
+            iov_count--;
+            if (iov_count > 0) {
+                first = iov[0];
+            }
+        }
+
+        // Advance into a partially written segment
+        first.base = (const uint8_t*) first.base + remaining;
+        first.len -= remaining;
+    }
+
+    return 0;
+}
+
+int fd_writer(const uint8_t *buf, size_t len, void* user_data) {
+    int fd = *(int*)user_data;
+
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        buf += written;
+        len -= written;
+    }
+
+    return 0;
+}
+
+int fd_reader(void *buf, size_t len, size_t *n, void* user_data) {
+    int fd = *(int*)user_data;
+
+    for (;;) {
+        ssize_t got = read(fd, buf, len);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        *n = got;
+        return 0;
+    }
+}
+
+int fd_patcher(size_t offset, const uint8_t *buf, size_t len, void* user_data) {
+    int fd = *(int*)user_data;
+
+    while (len > 0) {
+        ssize_t written = pwrite(fd, buf, len, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        buf += written;
+        offset += written;
+        len -= written;
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// async_file
+////////////////////////////////////////////////////////////////////////////////
+
+static int async_file_sync(int fd) {
+#ifdef __APPLE__
+    return fsync(fd) == 0 ? 0 : errno;
+#else
+    return fdatasync(fd) == 0 ? 0 : errno;
+#endif
+}
+
+// Background thread: write queued buffers in order until stopped.
+static void* async_file_thread(void *arg) {
+    async_file_t *f = arg;
+
+    pthread_mutex_lock(&f->lock);
+    for (;;) {
+        while (f->queued == 0 && !f->stop) {
+            pthread_cond_wait(&f->queued_cond, &f->lock);
+        }
+        if (f->queued == 0) {
+            break;
+        }
+
+        // The head buffer stays queued while it is written, so the encoder
+        // won't fill it.
+        uint8_t *buf = f->buffers[f->head];
+        size_t len = f->lengths[f->head];
+        bool failed = f->error != 0;
+        pthread_mutex_unlock(&f->lock);
+
+        int err = 0;
+        if (!failed) {
+            err = fd_writer(buf, len, &f->fd);
+            if (err == 0 && f->sync_policy == ASYNC_FILE_SYNC_BUFFER) {
+                err = async_file_sync(f->fd);
+            }
+        }
+
+        pthread_mutex_lock(&f->lock);
+        if (err != 0 && f->error == 0) {
+            f->error = err;
+        }
+        f->head = (f->head + 1) % f->buffer_count;
+        f->queued--;
+        pthread_cond_signal(&f->free_cond);
+    }
+    pthread_mutex_unlock(&f->lock);
+
+    return NULL;
+}
+
+int async_file_open(async_file_t *f, int fd, size_t buffer_size, size_t buffer_count, int sync_policy) {
+    memset(f, 0, sizeof(async_file_t));
+    f->fd = fd;
+    f->sync_policy = sync_policy;
+    f->buffer_size = buffer_size;
+    f->buffer_count = buffer_count;
+
+    if (buffer_count < 2 || buffer_size == 0) {
+        return EINVAL;
+    }
+
+    f->buffers = calloc(buffer_count, sizeof(uint8_t*));
+    f->lengths = calloc(buffer_count, sizeof(size_t));
+    if (f->buffers == NULL || f->lengths == NULL) {
+        free(f->buffers);
+        free(f->lengths);
+        return ENOMEM;
+    }
+
+    for (size_t i = 0; i < buffer_count; i++) {
+        f->buffers[i] = malloc(buffer_size);
+        if (f->buffers[i] == NULL) {
+            for (size_t j = 0; j < i; j++) {
+                free(f->buffers[j]);
+            }
+            free(f->buffers);
+            free(f->lengths);
+            return ENOMEM;
+        }
+    }
+
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->queued_cond, NULL);
+    pthread_cond_init(&f->free_cond, NULL);
+
+    int err = pthread_create(&f->thread, NULL, async_file_thread, f);
+    if (err != 0) {
+        pthread_mutex_destroy(&f->lock);
+        pthread_cond_destroy(&f->queued_cond);
+        pthread_cond_destroy(&f->free_cond);
+        for (size_t i = 0; i < buffer_count; i++) {
+            free(f->buffers[i]);
+        }
+        free(f->buffers);
+        free(f->lengths);
+    }
+    return err;
+}
+
+// Queue the buffer being filled, then wait for a free one.
+// Returns the first error seen by the writer thread.
+static int async_file_submit(async_file_t *f) {
+    pthread_mutex_lock(&f->lock);
+
+    f->lengths[f->fill] = f->fill_len;
+    f->queued++;
+    f->fill = (f->fill + 1) % f->buffer_count;
+    f->fill_len = 0;
+    pthread_cond_signal(&f->queued_cond);
+
+    // Back-pressure: block while every buffer is queued.
+    while (f->queued == f->buffer_count) {
+        pthread_cond_wait(&f->free_cond, &f->lock);
+    }
+
+    f->reported_error = f->error;
+    pthread_mutex_unlock(&f->lock);
+    return f->reported_error;
+}
+
+int async_file_writer(const uint8_t *buf, size_t len, void* user_data) {
+    async_file_t *f = user_data;
+
+    while (len > 0) {
+        if (f->reported_error != 0) {
+            return f->reported_error;
+        }
+
+        size_t n = f->buffer_size - f->fill_len;
+        n = len < n ? len : n;
+        memcpy(&f->buffers[f->fill][f->fill_len], buf, n);
+        f->fill_len += n;
+        buf += n;
+        len -= n;
+
+        if (f->fill_len == f->buffer_size && async_file_submit(f) != 0) {
+            return f->reported_error;
+        }
+    }
+
+    return f->reported_error;
+}
+
+int async_file_drain(async_file_t *f) {
+    if (f->fill_len > 0) {
+        async_file_submit(f);
+    }
+
+    pthread_mutex_lock(&f->lock);
+    while (f->queued > 0) {
+        pthread_cond_wait(&f->free_cond, &f->lock);
+    }
+    f->reported_error = f->error;
+    pthread_mutex_unlock(&f->lock);
+
+    return f->reported_error;
+}
+
+int async_file_close(async_file_t *f) {
+    int err = async_file_drain(f);
+
+    if (err == 0 && f->sync_policy == ASYNC_FILE_SYNC_CLOSE) {
+        err = async_file_sync(f->fd);
+    }
+
+    pthread_mutex_lock(&f->lock);
+    f->stop = true;
+    pthread_cond_signal(&f->queued_cond);
+    pthread_mutex_unlock(&f->lock);
+    pthread_join(f->thread, NULL);
+
+    pthread_mutex_destroy(&f->lock);
+    pthread_cond_destroy(&f->queued_cond);
+    pthread_cond_destroy(&f->free_cond);
+    for (size_t i = 0; i < f->buffer_count; i++) {
+        free(f->buffers[i]);
+    }
+    free(f->buffers);
+    free(f->lengths);
+    f->buffers = NULL;
+    f->lengths = NULL;
+
+    return err;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mapped_file_t
+////////////////////////////////////////////////////////////////////////////////
+
+// Initial heap buffer size for inputs that can't be mapped.
+#define MAPPED_FILE_READ_SIZE (64 * 1024)
+
+// Read the rest of 'fd' into a heap buffer.
+static int mapped_file_read(mapped_file_t *f, int fd) {
+    size_t capacity = 0;
+
+    for (;;) {
+        if (f->size == capacity) {
+            capacity = capacity == 0 ? MAPPED_FILE_READ_SIZE : capacity * 2;
+            uint8_t *data = realloc(f->data, capacity);
+            if (data == NULL) {
+                return ENOMEM;
+            }
+            f->data = data;
+        }
+
+        ssize_t got = read(fd, &f->data[f->size], capacity - f->size);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (got == 0) {
+            return 0;
+        }
+        f->size += got;
+    }
+}
+
+int mapped_file_open_fd(mapped_file_t *f, int fd, uint8_t validation) {
+    struct stat st;
+    int status = 0;
+
+    f->data = NULL;
+    f->size = 0;
+    f->mapped = false;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            f->data = data;
+            f->size = st.st_size;
+            f->mapped = true;
+
+            // The decoder reads front to back: read ahead aggressively and
+            // start bringing in the first pages now. These are only hints.
+            posix_madvise(data, f->size, POSIX_MADV_SEQUENTIAL);
+            posix_madvise(data, f->size, POSIX_MADV_WILLNEED);
+        }
+    }
+
+    if (!f->mapped) {
+        status = mapped_file_read(f, fd);
+        if (status != 0) {
+            mapped_file_close(f);
+        }
+    }
+
+    ltv_decoder_init_validation(&f->decoder, f->data, f->size, validation);
+    return status;
+}
+
+int mapped_file_open(mapped_file_t *f, const char *path, uint8_t validation) {
+    int fd;
+    do {
+        fd = open(path, O_RDONLY);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0) {
+        f->data = NULL;
+        f->size = 0;
+        f->mapped = false;
+        ltv_decoder_init_validation(&f->decoder, NULL, 0, validation);
+        return errno;
+    }
+
+    // A mapping stays valid once the descriptor is closed.
+    int status = mapped_file_open_fd(f, fd, validation);
+    close(fd);
+    return status;
+}
+
+void mapped_file_close(mapped_file_t *f) {
+    if (f->mapped) {
+        munmap(f->data, f->size);
+    } else {
+        free(f->data);
+    }
+    f->data = NULL;
+    f->size = 0;
+    f->mapped = false;
+}
+
+#endif
\ No newline at end of file
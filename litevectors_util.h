@@ -3,6 +3,10 @@
 
 #include "litevectors.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // LiteVectors Utilities
 //
@@ -11,6 +15,12 @@
 // use LiteVectors.
 ////////////////////////////////////////////////////////////////////////////////
 
+// POSIX specific utilities (file descriptor output and friends) are built
+// on platforms that provide them.
+#if defined(__unix__) || defined(__APPLE__)
+#define LTV_UTIL_POSIX
+#endif
+
 // Get a text string associated with an error code from ltv_next.
 const char* ltv_status_text(int status_code); 
 
@@ -47,4 +57,206 @@ typedef struct  {
 // LiteVector serializer to write to a static_buffer.
 int static_buffer_writer(const uint8_t *buf, size_t len, void* user_data);
 
+// A function implementing the ltv_patcher interface for a static_buffer.
+// Offsets are relative to the start of the buffer.
+int static_buffer_patcher(size_t offset, const uint8_t *buf, size_t len, void* user_data);
+
+// Allocator hooks for a dynamic_buffer_t, allowing an arena, pool or huge page 
+// allocator to back the buffer. 'resize' has the semantics of realloc (ptr may
+// be NULL) and returns NULL on failure. The current size of the allocation is
+// passed in to support allocators that don't track it.
+typedef struct {
+    void* (*resize)(void *ptr, size_t old_size, size_t new_size, void *user_data);
+    void (*release)(void *ptr, size_t size, void *user_data);
+    void *user_data;
+} ltv_allocator_t;
+
+// A dynamic buffer is a heap backed buffer that grows as serialized data is
+// written to it. It can be reset and reused without releasing its memory.
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    const ltv_allocator_t *allocator;
+} dynamic_buffer_t;
+
+// Initialize a dynamic buffer. 'initial_capacity' may be 0 to defer allocation
+// until the first write. If 'allocator' is NULL, the C library realloc/free are
+// used. The allocator must outlive the buffer.
+// Returns false if the initial allocation fails.
+bool dynamic_buffer_init(dynamic_buffer_t *b, size_t initial_capacity, const ltv_allocator_t *allocator);
+
+// Make sure that at least 'capacity' bytes are allocated.
+bool dynamic_buffer_reserve(dynamic_buffer_t *b, size_t capacity);
+
+// Discard the contents of the buffer, keeping the allocated memory for reuse.
+void dynamic_buffer_reset(dynamic_buffer_t *b);
+
+// Take ownership of the buffer contents. The buffer is left empty, with no
+// allocated memory. The returned pointer must be released with the buffer's
+// allocator (free() by default), passing the capacity returned in 'capacity'
+// if it is not NULL.
+uint8_t* dynamic_buffer_detach(dynamic_buffer_t *b, size_t *size, size_t *capacity);
+
+// Release the memory held by the buffer.
+void dynamic_buffer_free(dynamic_buffer_t *b);
+
+// A function implementing the ltv_writer interface. This is used for a
+// LiteVector serializer to write to a dynamic_buffer. The buffer grows
+// geometrically, and -1 is returned if memory can't be allocated.
+int dynamic_buffer_writer(const uint8_t *buf, size_t len, void* user_data);
+
+// A function implementing the ltv_patcher interface for a dynamic_buffer.
+// Offsets are relative to the start of the buffer.
+int dynamic_buffer_patcher(size_t offset, const uint8_t *buf, size_t len, void* user_data);
+
+// A key matcher maps struct keys to positions in a fixed set of names, for
+// deserializers that would otherwise test each key with is_string_eq against
+// every field name. Keys are hashed once into a collision free table, so a 
+// lookup costs one hash and one comparison however many fields there are.
+// Keys arriving in the same order as the names are matched by comparing with
+// the expected next name, without hashing.
+typedef struct {
+    const char *const *names;
+    size_t *name_lens;
+    size_t name_count;
+
+    // Per bucket displacements, and the name index in each slot.
+    uint16_t *displace;
+    size_t bucket_count;
+    uint16_t *slots;
+    unsigned slot_shift;
+
+    // Index of the name expected next.
+    size_t next;
+} key_matcher_t;
+
+// Returned by key_matcher_find for keys that aren't in the set.
+#define KEY_MATCHER_NONE ((size_t)-1)
+
+// Build a matcher for 'count' names (fewer than 65535). The names must stay 
+// valid while the matcher is used. Returns false if memory can't be 
+// allocated or a name is repeated.
+bool key_matcher_init(key_matcher_t *m, const char *const *names, size_t count);
+
+// As key_matcher_init, for names of the given lengths that need not be NUL
+// terminated. The lengths are copied.
+bool key_matcher_init_n(key_matcher_t *m, const char *const *names, const size_t *lens, size_t count);
+
+// Index of the name equal to 'key', or KEY_MATCHER_NONE if there is none or 
+// 'key' isn't a string.
+size_t key_matcher_find(key_matcher_t *m, const ltv_data_t *key);
+
+// Index of the name equal to the 'len' bytes at 'key', or KEY_MATCHER_NONE.
+// This is the hash lookup alone: it doesn't use or update the expected next
+// name, so one matcher can be shared by several threads.
+size_t key_matcher_lookup(const key_matcher_t *m, const void *key, size_t len);
+
+// Release the matcher's tables.
+void key_matcher_free(key_matcher_t *m);
+
+#ifdef LTV_UTIL_POSIX
+
+// A function implementing the ltv_gather_writer interface that writes all
+// segments to a file descriptor with writev(), so referenced vector payloads
+// go out without being copied. 'user_data' points to the int file descriptor.
+// Returns 0 on success, or the errno value of a failed write.
+int fd_gather_writer(const ltv_iovec_t *iov, size_t iov_count, void* user_data);
+
+// A function implementing the ltv_writer interface that writes to a file
+// descriptor. 'user_data' points to the int file descriptor.
+// Returns 0 on success, or the errno value of a failed write.
+int fd_writer(const uint8_t *buf, size_t len, void* user_data);
+
+// A function implementing the ltv_reader interface that reads from a file
+// descriptor. 'user_data' points to the int file descriptor.
+// Returns 0 on success, or the errno value of a failed read.
+int fd_reader(void *buf, size_t len, size_t *n, void* user_data);
+
+// A function implementing the ltv_patcher interface for a seekable file 
+// descriptor, using pwrite(). 'user_data' points to the int file descriptor. 
+// Offsets are relative to the start of the file, so the encoder must have
+// started writing at file offset 0.
+int fd_patcher(size_t offset, const uint8_t *buf, size_t len, void* user_data);
+
+// When an async_file_t calls fdatasync().
+#define ASYNC_FILE_SYNC_NONE     0  // Never, leave it to the OS.
+#define ASYNC_FILE_SYNC_BUFFER   1  // After each buffer is written.
+#define ASYNC_FILE_SYNC_CLOSE    2  // Once, when the file is closed.
+
+// An async file writes encoded output to a file descriptor from a background
+// thread, so that the encoding thread doesn't wait on disk I/O. The encoder
+// fills one buffer while the thread writes the others. When all buffers are
+// waiting to be written the encoder blocks until one is free, which bounds
+// memory use.
+typedef struct {
+    int fd;
+    int sync_policy;
+
+    uint8_t **buffers;
+    size_t *lengths;
+    size_t buffer_size;
+    size_t buffer_count;
+
+    // Buffers 'head' to 'head + queued' (mod count) are waiting to be written, 
+    // and 'fill' (always the next one) is being filled by the encoder.
+    size_t head;
+    size_t queued;
+    size_t fill;
+    size_t fill_len;
+
+    // First error from the writer thread, and the copy seen by the encoder.
+    int error;
+    int reported_error;
+
+    bool stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t queued_cond;
+    pthread_cond_t free_cond;
+} async_file_t;
+
+// Start an async file writing to 'fd', with 'buffer_count' buffers (at least 2)
+// of 'buffer_size' bytes each. The file descriptor remains owned by the caller.
+// Returns 0 on success or an errno value.
+int async_file_open(async_file_t *f, int fd, size_t buffer_size, size_t buffer_count, int sync_policy);
+
+// A function implementing the ltv_writer interface for an async_file. Output 
+// is copied into the current buffer, which is queued for writing when full.
+// A write error on the background thread is returned (and so becomes the
+// encoder's status) at the next buffer handoff.
+int async_file_writer(const uint8_t *buf, size_t len, void* user_data);
+
+// Queue the partially filled buffer and wait until everything has been written.
+// Returns 0, or the errno value of the first failed write or sync.
+int async_file_drain(async_file_t *f);
+
+// Drain, sync according to the sync policy, stop the thread and free the buffers.
+// Returns 0, or the errno value of the first failed write or sync.
+int async_file_close(async_file_t *f);
+
+// A mapped file holds a whole file in memory for decoding. Regular files are
+// mapped read-only with mmap(), so decoding starts without reading the file
+// first and pages are brought in as the decoder reaches them. Pipes and other
+// inputs that can't be mapped are read into a heap buffer instead.
+typedef struct {
+    ltv_decoder_t decoder;
+    uint8_t *data;
+    size_t size;
+    bool mapped;
+} mapped_file_t;
+
+// Open 'path' and prepare 'f->decoder' to decode it with the given
+// LTV_VALIDATE_* policy. Returns 0 on success or an errno value.
+int mapped_file_open(mapped_file_t *f, const char *path, uint8_t validation);
+
+// As mapped_file_open, for a file descriptor that remains owned by the 
+// caller. Input that can't be mapped is read until the end.
+int mapped_file_open_fd(mapped_file_t *f, int fd, uint8_t validation);
+
+// Unmap or free the file contents.
+void mapped_file_close(mapped_file_t *f);
+
+#endif
+
 #endif //_LITEVECTORS_UTIL_H
\ No newline at end of file
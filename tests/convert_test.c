@@ -0,0 +1,255 @@
+// Tests for the numeric conversion encoders in litevectors_convert.
+//
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_convert.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#define COUNT 5003
+
+static uint8_t buf[1 << 17];
+
+// Encode with a conversion and return the decoded vector payload.
+const uint8_t* encode(uint8_t dst_type, uint8_t src_type, const void *src, size_t count, int mode, int *status) {
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_convert_vec(&e, dst_type, src_type, src, count, mode);
+    *status = e.status;
+    if (e.status != 0) {
+        // Zero is the closed vector state.
+        if (e.vec_state != 0) {
+            printf("vector left open after an error\n");
+            exit(1);
+        }
+        return NULL;
+    }
+
+    ltv_decoder_t dec;
+    ltv_data_t d;
+    ltv_decoder_init(&dec, buf, e.offset);
+    if (ltv_next(&dec, &d) != LTV_SUCCESS || d.type_code != dst_type || ltv_next(&dec, &d) != LTV_DECODE_EOF) {
+        printf("converted vector did not decode (type %d)\n", dst_type);
+        exit(1);
+    }
+    ltv_decoder_init(&dec, buf, e.offset);
+    ltv_next(&dec, &d);
+    return d.val.v_buffer;
+}
+
+int16_t sat16(int64_t v) {
+    return v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v;
+}
+
+void test_f64_to_f32() {
+    static double src[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        src[i] = (i - COUNT / 2) * 1.000001 / 3.0;
+    }
+
+    int status;
+    const uint8_t *out = encode(LTV_F32, LTV_F64, src, COUNT, LTV_CONVERT_SATURATE, &status);
+    for (int i = 0; i < COUNT; i++) {
+        float f;
+        memcpy(&f, out + i * 4, 4);
+        if (f != (float) src[i]) {
+            printf("f64->f32 mismatch at %d\n", i);
+            exit(1);
+        }
+    }
+
+    // Infinities, NaN and FLT_MAX itself are in range for a checked conversion.
+    src[1] = INFINITY; src[2] = -INFINITY; src[3] = NAN; src[4] = -FLT_MAX;
+    if (encode(LTV_F32, LTV_F64, src, COUNT, LTV_CONVERT_CHECKED, &status) == NULL) {
+        printf("f64->f32 checked conversion failed on valid data: %d\n", status);
+        exit(1);
+    }
+
+    // Finite values beyond FLT_MAX are not, in the SIMD body or the scalar tail.
+    int positions[] = { 5, 100, COUNT - 1 };
+    for (int i = 0; i < 3; i++) {
+        double saved = src[positions[i]];
+        src[positions[i]] = i == 1 ? -1e39 : 1e300;
+        if (encode(LTV_F32, LTV_F64, src, COUNT, LTV_CONVERT_CHECKED, &status) != NULL || status != LTV_ENCODE_CONVERSION_RANGE) {
+            printf("f64->f32 overflow at %d not flagged\n", positions[i]);
+            exit(1);
+        }
+        src[positions[i]] = saved;
+    }
+}
+
+void test_i64_to_i16() {
+    static int64_t src[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        src[i] = (int64_t)(i - COUNT / 2) * 37;
+    }
+    src[5] = INT64_MAX;
+    src[COUNT - 1] = INT64_MIN;
+
+    int status;
+    const uint8_t *out = encode(LTV_I16, LTV_I64, src, COUNT, LTV_CONVERT_SATURATE, &status);
+    for (int i = 0; i < COUNT; i++) {
+        int16_t v;
+        memcpy(&v, out + i * 2, 2);
+        if (v != sat16(src[i])) {
+            printf("i64->i16 mismatch at %d: %d\n", i, v);
+            exit(1);
+        }
+    }
+
+    if (encode(LTV_I16, LTV_I64, src, COUNT, LTV_CONVERT_CHECKED, &status) != NULL || status != LTV_ENCODE_CONVERSION_RANGE) {
+        printf("i64->i16 checked conversion not flagged\n");
+        exit(1);
+    }
+
+    // In range data passes a checked conversion
+    src[5] = 0; src[COUNT - 1] = 0;
+    for (int i = 0; i < COUNT; i++) src[i] = sat16(src[i]);
+    if (encode(LTV_I16, LTV_I64, src, COUNT, LTV_CONVERT_CHECKED, &status) == NULL) {
+        printf("i64->i16 checked conversion failed on valid data: %d\n", status);
+        exit(1);
+    }
+}
+
+void test_i32_to_i16() {
+    static int32_t src[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        src[i] = (i - COUNT / 2) * 17;
+    }
+
+    int status;
+    const uint8_t *out = encode(LTV_I16, LTV_I32, src, COUNT, LTV_CONVERT_SATURATE, &status);
+    for (int i = 0; i < COUNT; i++) {
+        int16_t v;
+        memcpy(&v, out + i * 2, 2);
+        if (v != sat16(src[i])) {
+            printf("i32->i16 mismatch at %d\n", i);
+            exit(1);
+        }
+    }
+
+    if (encode(LTV_I16, LTV_I32, src, COUNT, LTV_CONVERT_CHECKED, &status) != NULL || status != LTV_ENCODE_CONVERSION_RANGE) {
+        printf("i32->i16 checked conversion not flagged\n");
+        exit(1);
+    }
+}
+
+void test_i16_to_i8() {
+    static int16_t src[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        src[i] = (i % 600) - 300;
+    }
+
+    int status;
+    const uint8_t *out = encode(LTV_I8, LTV_I16, src, COUNT, LTV_CONVERT_SATURATE, &status);
+    for (int i = 0; i < COUNT; i++) {
+        int8_t expected = src[i] > INT8_MAX ? INT8_MAX : src[i] < INT8_MIN ? INT8_MIN : src[i];
+        if ((int8_t) out[i] != expected) {
+            printf("i16->i8 mismatch at %d\n", i);
+            exit(1);
+        }
+    }
+}
+
+void test_scalar_conversions() {
+    double f[] = { -1.5, 0.0, 255.9, 256.0, NAN, 1e300, -1e300 };
+    uint8_t expected_u8[] = { 0, 0, 255, 255, 0, 255, 0 };
+
+    int status;
+    const uint8_t *out = encode(LTV_U8, LTV_F64, f, 7, LTV_CONVERT_SATURATE, &status);
+    if (memcmp(out, expected_u8, 7) != 0) {
+        printf("f64->u8 saturation mismatch\n");
+        exit(1);
+    }
+
+    double ok[] = { -0.9, 0.0, 255.9 };
+    if (encode(LTV_U8, LTV_F64, ok, 3, LTV_CONVERT_CHECKED, &status) == NULL) {
+        printf("f64->u8 checked conversion failed on valid data\n");
+        exit(1);
+    }
+
+    int64_t i64[] = { INT64_MIN, -1, 0, INT64_MAX };
+    uint64_t expected_u64[] = { 0, 0, 0, INT64_MAX };
+    out = encode(LTV_U64, LTV_I64, i64, 4, LTV_CONVERT_SATURATE, &status);
+    if (memcmp(out, expected_u64, sizeof(expected_u64)) != 0) {
+        printf("i64->u64 saturation mismatch\n");
+        exit(1);
+    }
+
+    uint32_t u32[] = { 0, 40000, UINT32_MAX };
+    int16_t expected_i16[] = { 0, INT16_MAX, INT16_MAX };
+    out = encode(LTV_I16, LTV_U32, u32, 3, LTV_CONVERT_SATURATE, &status);
+    if (memcmp(out, expected_i16, sizeof(expected_i16)) != 0) {
+        printf("u32->i16 saturation mismatch\n");
+        exit(1);
+    }
+
+    if (encode(LTV_STRING, LTV_U32, u32, 3, LTV_CONVERT_SATURATE, &status) != NULL || status != LTV_ENCODE_INVALID_CONVERSION) {
+        printf("invalid conversion not flagged\n");
+        exit(1);
+    }
+}
+
+// A gather writer that appends the segments to gather_out, and checks they
+// all point into the stage.
+static uint8_t gather_stage[1 << 14];
+static uint8_t gather_out[1 << 14];
+static size_t gather_len = 0;
+static int gather_calls = 0;
+
+int gather_writer(const ltv_iovec_t *iov, size_t iov_count, void* user_data) {
+    (void) user_data;
+    gather_calls++;
+    for (size_t i = 0; i < iov_count; i++) {
+        const uint8_t *base = iov[i].base;
+        if (base < gather_stage || base + iov[i].len > gather_stage + sizeof(gather_stage)) {
+            printf("gather segment outside the stage\n");
+            exit(1);
+        }
+        memcpy(gather_out + gather_len, base, iov[i].len);
+        gather_len += iov[i].len;
+    }
+    return 0;
+}
+
+// Converted chunks are copied into the stage of a gather encoder, so the
+// whole vector is written in one batch.
+void test_gather() {
+    static int64_t src[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        src[i] = (int64_t)i * 37 - 90000;
+    }
+
+    ltv_iovec_t iov[4];
+    ltv_encoder_t e;
+    ltv_encoder_init_gather(&e, gather_writer, NULL, gather_stage, sizeof(gather_stage), iov, 4);
+    ltv_i64_to_i16_vec(&e, src, COUNT, LTV_CONVERT_SATURATE);
+    if (ltv_flush(&e) != 0 || gather_calls != 1) {
+        printf("gather conversion wrote %d batches\n", gather_calls);
+        exit(1);
+    }
+
+    ltv_encoder_t m;
+    ltv_encoder_init_memory(&m, buf, sizeof(buf));
+    ltv_i64_to_i16_vec(&m, src, COUNT, LTV_CONVERT_SATURATE);
+    if (gather_len != m.offset || memcmp(gather_out, buf, m.offset) != 0) {
+        printf("gather conversion output mismatch\n");
+        exit(1);
+    }
+}
+
+int main() {
+    test_f64_to_f32();
+    test_i64_to_i16();
+    test_i32_to_i16();
+    test_i16_to_i8();
+    test_scalar_conversions();
+    test_gather();
+
+    printf("Conversion tests finished successfully\n");
+    return 0;
+}
@@ -0,0 +1,259 @@
+// Tests for the coroutine decoder in litevectors_coro.hpp. Sources deliver
+// the data in random chunk sizes, either immediately or from a small event
+// loop standing in for asynchronous I/O, and the decoded values are compared
+// with ltv_next over the whole buffer.
+//
+#include "litevectors_coro.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static uint8_t buf[1 << 16];
+
+void fail(const char *msg) {
+    printf("%s\n", msg);
+    exit(1);
+}
+
+// A decoded value, with a copy of its payload.
+struct record {
+    uint8_t type_code;
+    uint8_t size_code;
+    size_t length;
+    std::string bytes;
+
+    explicit record(const ltv_data_t &v) : type_code(v.type_code), size_code(v.size_code), length(v.length) {
+        if (v.size_code != LTV_SINGLE || v.type_code == LTV_STRING) {
+            bytes.assign(reinterpret_cast<const char*>(v.val.v_buffer), v.length);
+        } else {
+            bytes.assign(reinterpret_cast<const char*>(v.val.v_raw), sizeof(v.val.v_raw));
+        }
+    }
+
+    bool operator==(const record&) const = default;
+};
+
+size_t encode(void) {
+    static int32_t big[600];
+    static double wide[3] = { 1.5, -2.5, 1e300 };
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+
+    for (int i = 0; i < 600; i++) big[i] = i * 7919;
+    for (int m = 0; m < 20; m++) {
+        ltv_struct_start(&e);
+        ltv_string(&e, "id"); ltv_u32(&e, m);
+        ltv_string(&e, "name"); ltv_string(&e, m % 2 ? "a somewhat longer string value" : "");
+        ltv_string(&e, "wide"); ltv_f64_vec(&e, wide, 3);
+        ltv_string(&e, "big"); ltv_i32_vec(&e, big, m % 5 == 0 ? 600 : m);
+        ltv_string(&e, "list");
+        ltv_list_start(&e);
+        ltv_nil(&e); ltv_bool(&e, true); ltv_i64(&e, -m); ltv_f32(&e, m * 0.5f);
+        ltv_struct_start(&e); ltv_string(&e, "x"); ltv_u8(&e, 1); ltv_struct_end(&e);
+        ltv_list_end(&e);
+        ltv_struct_end(&e);
+    }
+    return e.offset;
+}
+
+std::vector<record> decode_all(size_t len) {
+    std::vector<record> out;
+    ltv_decoder_t d;
+    ltv_data_t v;
+    ltv_decoder_init(&d, buf, len);
+    while (ltv_next(&d, &v) == LTV_SUCCESS) {
+        out.emplace_back(v);
+    }
+    return out;
+}
+
+// A coroutine that runs as soon as it is called, for the consumers.
+struct task {
+    struct promise_type {
+        task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+struct result {
+    std::vector<record> values;
+    int status = -1;
+    bool done = false;
+    std::string error;
+};
+
+task consume(ltv::value_stream values, result &r) {
+    try {
+        while (co_await values.next()) {
+            r.values.emplace_back(values.value());
+        }
+        r.status = values.status();
+    } catch (const std::exception &e) {
+        r.error = e.what();
+    }
+    r.done = true;
+}
+
+// Returns up to a random number of bytes each read, without suspending.
+struct ready_source {
+    const uint8_t *data;
+    size_t len;
+    size_t pos = 0;
+    std::mt19937 *rng;
+
+    struct awaiter {
+        size_t n;
+        bool await_ready() const noexcept { return true; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        size_t await_resume() const noexcept { return n; }
+    };
+
+    awaiter read(uint8_t *out, size_t max) {
+        size_t n = std::min({ max, len - pos, size_t(1 + (*rng)() % 50) });
+        memcpy(out, data + pos, n);
+        pos += n;
+        return { n };
+    }
+};
+
+// Reads suspend until the event loop delivers a chunk, as a socket would.
+struct async_source {
+    const uint8_t *data;
+    size_t len;
+    size_t pos = 0;
+
+    uint8_t *out = nullptr;
+    size_t max = 0;
+    size_t got = 0;
+    std::coroutine_handle<> waiting;
+    bool fail_next = false;
+
+    async_source(const uint8_t *data, size_t len) : data(data), len(len) {}
+
+    struct awaiter {
+        async_source *s;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const noexcept { s->waiting = h; }
+        size_t await_resume() const {
+            if (s->fail_next) throw std::runtime_error("connection reset");
+            return s->got;
+        }
+    };
+
+    awaiter read(uint8_t *dest, size_t n) {
+        out = dest;
+        max = n;
+        return { this };
+    }
+
+    // Complete the pending read with up to 'n' bytes.
+    void deliver(size_t n) {
+        n = std::min({ n, max, len - pos });
+        memcpy(out, data + pos, n);
+        pos += n;
+        got = n;
+        std::exchange(waiting, nullptr).resume();
+    }
+};
+
+// Drive an async source with random chunk sizes until the consumer is done.
+// Chunks are mostly small, sometimes larger than any single value.
+void run_loop(async_source &src, result &r, std::mt19937 &rng) {
+    while (!r.done) {
+        if (!src.waiting) fail("consumer stalled without a pending read");
+        src.deliver(rng() % 8 == 0 ? 1 + rng() % 5000 : 1 + rng() % 40);
+    }
+}
+
+void check_ready_source(size_t len, const std::vector<record> &expected) {
+    for (unsigned seed = 0; seed < 50; seed++) {
+        std::mt19937 rng(seed);
+        ready_source src{ buf, len, 0, &rng };
+        result r;
+        consume(ltv::decode(src, 1 + rng() % 100, 4096), r);
+        if (!r.done || r.status != LTV_SUCCESS || r.values != expected) {
+            printf("ready source, seed %u: status %d, %zu values\n", seed, r.status, r.values.size());
+            exit(1);
+        }
+    }
+}
+
+void check_async_source(size_t len, const std::vector<record> &expected) {
+    for (unsigned seed = 0; seed < 200; seed++) {
+        std::mt19937 rng(seed);
+        async_source src{ buf, len };
+        result r;
+        consume(ltv::decode(src, 1 + rng() % 6000, 4096), r);
+        if (r.done) fail("finished before any data");
+        run_loop(src, r, rng);
+        if (r.status != LTV_SUCCESS || r.values != expected) {
+            printf("async source, seed %u: status %d, %zu values\n", seed, r.status, r.values.size());
+            exit(1);
+        }
+    }
+}
+
+void check_errors(size_t len, const std::vector<record> &expected) {
+    std::mt19937 rng(1);
+
+    // Truncated data: every complete value, then the error.
+    async_source truncated{ buf, len - 3 };
+    result r;
+    consume(ltv::decode(truncated, 64, 4096), r);
+    run_loop(truncated, r, rng);
+    if (r.status != LTV_DECODE_UNEXPECTED_EOF || r.values.size() + 3 > expected.size() ||
+        !std::equal(r.values.begin(), r.values.end(), expected.begin())) {
+        fail("truncated stream");
+    }
+
+    // A vector that straddles reads and doesn't fit the carry buffer.
+    ready_source small{ buf, len, 0, &rng };
+    result carry;
+    consume(ltv::decode(small, 256, 256), carry);
+    if (!carry.done || carry.status != LTV_DECODE_CARRY_FULL) {
+        fail("carry full");
+    }
+
+    // Source errors reach the consumer.
+    async_source failing{ buf, len };
+    result thrown;
+    consume(ltv::decode(failing, 64, 4096), thrown);
+    failing.deliver(100);
+    failing.fail_next = true;
+    failing.deliver(100);
+    if (!thrown.done || thrown.error != "connection reset" || thrown.values.empty()) {
+        fail("source exception");
+    }
+
+    // Invalid data ends the stream with the decoder error.
+    static const uint8_t bad[] = { 0x60, 0x01, 0x07 };
+    memcpy(buf, bad, sizeof(bad));
+    ready_source invalid{ buf, sizeof(bad), 0, &rng };
+    result r2;
+    consume(ltv::decode(invalid), r2);
+    if (!r2.done || r2.status != LTV_DECODE_INVALID_SIZE_CODE || r2.values.size() != 1) {
+        printf("invalid data: status %d\n", r2.status);
+        exit(1);
+    }
+}
+
+int main() {
+    size_t len = encode();
+    std::vector<record> expected = decode_all(len);
+
+    check_ready_source(len, expected);
+    check_async_source(len, expected);
+    check_errors(len, expected);
+
+    printf("Coroutine tests finished successfully\n");
+    return 0;
+}
@@ -0,0 +1,256 @@
+// Tests for the C++ wrapper in litevectors.hpp.
+//
+#include "litevectors.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static_assert(ltv::type_code_v<bool> == LTV_BOOL);
+static_assert(ltv::type_code_v<uint8_t> == LTV_U8);
+static_assert(ltv::type_code_v<uint16_t> == LTV_U16);
+static_assert(ltv::type_code_v<uint32_t> == LTV_U32);
+static_assert(ltv::type_code_v<uint64_t> == LTV_U64);
+static_assert(ltv::type_code_v<int8_t> == LTV_I8);
+static_assert(ltv::type_code_v<int16_t> == LTV_I16);
+static_assert(ltv::type_code_v<const int32_t> == LTV_I32);
+static_assert(ltv::type_code_v<long long> == LTV_I64);
+static_assert(ltv::type_code_v<unsigned long> == (sizeof(long) == 8 ? LTV_U64 : LTV_U32));
+static_assert(ltv::type_code_v<float> == LTV_F32);
+static_assert(ltv::type_code_v<double> == LTV_F64);
+
+static uint8_t expected[1 << 16];
+
+void fail(const char *msg) {
+    printf("%s\n", msg);
+    exit(1);
+}
+
+struct vector_sink {
+    std::vector<uint8_t> *out;
+    size_t calls;
+
+    int operator()(const uint8_t *p, size_t n) {
+        out->insert(out->end(), p, p + n);
+        calls++;
+        return 0;
+    }
+};
+
+// The same values with the C API, into 'expected'.
+size_t encode_c(const std::vector<float> &samples, const std::vector<int64_t> &big) {
+    static int16_t levels[] = { -1, 2, -3 };
+    static bool flags[] = { true, false };
+    static uint16_t levels_none[1];
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, expected, sizeof(expected));
+
+    ltv_struct_start(&e);
+    ltv_string(&e, "name"); ltv_string(&e, "probe");
+    ltv_string(&e, "a"); ltv_u32(&e, 4000000000u);
+    ltv_string(&e, "b"); ltv_i8(&e, -5);
+    ltv_string(&e, "on"); ltv_bool(&e, true);
+    ltv_string(&e, "c"); ltv_f64(&e, 0.25);
+    ltv_string(&e, "samples"); ltv_f32_vec(&e, (float*)samples.data(), samples.size());
+    ltv_string(&e, "levels"); ltv_i16_vec(&e, levels, 3);
+    ltv_string(&e, "flags"); ltv_bool_vec(&e, flags, 2);
+    ltv_string(&e, "big"); ltv_i64_vec(&e, (int64_t*)big.data(), big.size());
+    ltv_string(&e, "empty"); ltv_u16_vec(&e, levels_none, 0);
+    ltv_string(&e, "list");
+    ltv_list_start(&e); ltv_nil(&e); ltv_string(&e, "x"); ltv_list_end(&e);
+    ltv_struct_end(&e);
+    return e.offset;
+}
+
+template <class Writer>
+void encode_cpp(Writer &w, const std::vector<float> &samples, const std::vector<int64_t> &big) {
+    static const ltv_key_t KEY_NAME = LTV_KEY("name");
+    const int16_t levels[] = { -1, 2, -3 };
+
+    w.struct_start();
+    w.key(KEY_NAME); w.value("probe");
+    w.field("a", uint32_t(4000000000u));
+    w.field("b", int8_t(-5));
+    w.field("on", true);
+    w.field("c", 0.25);
+    w.field("samples", samples);
+    w.field("levels", levels);
+    w.field("flags", std::array<bool, 2>{ true, false });
+    w.field("big", big);
+    w.field("empty", std::vector<uint16_t>());
+    w.key(std::string("list"));
+    w.list_start(); w.nil(); w.value(std::string("x")); w.list_end();
+    w.struct_end();
+}
+
+void check_writer(void) {
+    std::vector<float> samples(10);
+    std::vector<int64_t> big(1000);
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = i * 0.5f;
+    for (size_t i = 0; i < big.size(); i++) big[i] = (int64_t)i * -1000000007;
+    size_t len = encode_c(samples, big);
+
+    // The default stage holds all but 'big', which is streamed through it.
+    std::vector<uint8_t> out;
+    ltv::writer<vector_sink> w(vector_sink{ &out, 0 });
+    encode_cpp(w, samples, big);
+    if (w.offset() != len || out.size() >= len) {
+        fail("writer offset");
+    }
+    if (w.flush() != 0 || out.size() != len || memcmp(out.data(), expected, len) != 0) {
+        fail("writer output differs from the C encoder");
+    }
+
+    // A small stage: many sink calls, and 'big' streamed through it.
+    std::vector<uint8_t> small_out;
+    ltv::writer<vector_sink, 64> small(vector_sink{ &small_out, 0 });
+    encode_cpp(small, samples, big);
+    small.flush();
+    if (small.status() != 0 || small_out.size() != len || memcmp(small_out.data(), expected, len) != 0) {
+        fail("small stage output differs from the C encoder");
+    }
+
+    // A sink returning void, from a lambda.
+    std::vector<uint8_t> lambda_out;
+    ltv::writer lw([&](const uint8_t *p, size_t n) { lambda_out.insert(lambda_out.end(), p, p + n); });
+    encode_cpp(lw, samples, big);
+    lw.flush();
+    if (lambda_out.size() != len || memcmp(lambda_out.data(), expected, len) != 0) {
+        fail("lambda sink output differs from the C encoder");
+    }
+
+    // Sink errors are kept, and later output is dropped.
+    size_t calls = 0;
+    auto sink = [&](const uint8_t*, size_t) { return ++calls == 2 ? 42 : 0; };
+    ltv::writer<decltype(sink), 64> failing(sink);
+    encode_cpp(failing, samples, big);
+    if (failing.flush() != 42 || calls != 2) {
+        fail("sink error");
+    }
+}
+
+void check_values(void) {
+    std::vector<float> samples(10);
+    std::vector<int64_t> big(1000);
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = i * 0.5f;
+    for (size_t i = 0; i < big.size(); i++) big[i] = (int64_t)i * -1000000007;
+    size_t len = encode_c(samples, big);
+
+    ltv_decoder_t d;
+    ltv_decoder_init(&d, expected, len);
+    ltv::values values(d);
+
+    std::vector<ltv_data_t> all;
+    for (const ltv_data_t &v : values) {
+        all.push_back(v);
+    }
+    if (values.status() != LTV_SUCCESS || all.size() != 27) {
+        printf("values: status %d, count %zu\n", values.status(), all.size());
+        exit(1);
+    }
+
+    if (!ltv::is_string(all[1], "name") || ltv::string(all[2]) != "probe" || !ltv::string(all[4]).empty()) {
+        fail("strings");
+    }
+    if (!ltv::is<uint32_t>(all[4]) || ltv::get<uint32_t>(all[4]) != 4000000000u || ltv::is<int32_t>(all[4])) {
+        fail("u32");
+    }
+    if (!ltv::is<int8_t>(all[6]) || ltv::get<int8_t>(all[6]) != -5 || ltv::is<uint8_t>(all[6])) {
+        fail("i8");
+    }
+    if (!ltv::is<bool>(all[8]) || !ltv::get<bool>(all[8])) {
+        fail("bool");
+    }
+    if (!ltv::is<double>(all[10]) || ltv::get<double>(all[10]) != 0.25 || ltv::is<float>(all[10])) {
+        fail("f64");
+    }
+
+    ltv::span<const float> sample_view = ltv::view<float>(all[12]);
+    if (!ltv::is_vector<float>(all[12]) || ltv::is<float>(all[12]) || sample_view.size() != samples.size()) {
+        fail("samples");
+    }
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (sample_view[i] != samples[i]) fail("sample values");
+    }
+    if (!ltv::view<uint32_t>(all[12]).empty() || !ltv::view<float>(all[4]).empty()) {
+        fail("view of the wrong type");
+    }
+
+    if (ltv::view<int16_t>(all[14]).size() != 3 || ltv::view<int16_t>(all[14])[2] != -3) {
+        fail("levels");
+    }
+    if (ltv::view<bool>(all[16]).size() != 2 || !ltv::view<bool>(all[16])[0] || ltv::view<bool>(all[16])[1]) {
+        fail("flags");
+    }
+    int64_t big_sum = 0, expected_big_sum = 0;
+    for (int64_t b : big) expected_big_sum += b;
+    for (int64_t b : ltv::view<int64_t>(all[18])) big_sum += b;
+    if (big_sum != expected_big_sum) {
+        fail("big");
+    }
+    if (!ltv::is_vector<uint16_t>(all[20]) || !ltv::view<uint16_t>(all[20]).empty()) {
+        fail("empty");
+    }
+    if (all[22].type_code != LTV_LIST || !ltv::is_string(all[24], "x") || all[26].type_code != LTV_END) {
+        fail("list");
+    }
+
+    // An error ends the loop, and is reported.
+    ltv_decoder_init(&d, expected, len - 1);
+    ltv::values truncated(d);
+    size_t count = 0;
+    for (const ltv_data_t &v : truncated) {
+        (void) v;
+        count++;
+    }
+    if (truncated.status() != LTV_DECODE_UNEXPECTED_EOF || count != 26) {
+        fail("truncated values");
+    }
+
+    // A misaligned payload has no view.
+    static uint8_t shifted[sizeof(expected) + 1];
+    memcpy(shifted + 1, expected, len);
+    ltv_decoder_init(&d, shifted + 1, len);
+    ltv_data_t v;
+    bool found = false;
+    while (ltv_next(&d, &v) == LTV_SUCCESS) {
+        if (ltv::is_vector<float>(v)) {
+            found = true;
+            if (!ltv::view<float>(v).empty()) fail("misaligned view");
+        }
+    }
+    if (!found) {
+        fail("misaligned samples not found");
+    }
+}
+
+// A key of the maximum length, which needs room for the literal's
+// terminator in C++.
+void check_long_key(void) {
+    static const ltv_key_t KEY_LONG = LTV_KEY("kkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkk");
+    static_assert(sizeof("kkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkk") - 1 == LTV_KEY_MAX_LEN, "key length");
+
+    std::vector<uint8_t> out;
+    ltv::writer<vector_sink> w(vector_sink{ &out, 0 });
+    w.key(KEY_LONG);
+    w.flush();
+
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, expected, sizeof(expected));
+    ltv_string(&e, "kkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkk");
+    if (out.size() != e.offset || memcmp(out.data(), expected, e.offset) != 0) {
+        fail("long key output differs from ltv_string");
+    }
+}
+
+int main() {
+    check_writer();
+    check_values();
+    check_long_key();
+
+    printf("C++ tests finished successfully\n");
+    return 0;
+}
@@ -0,0 +1,264 @@
+// Tests for code generated by tools/ltvgen.py from gen_test.ltvs. The
+// generated encoder and decoder are checked against ltv_schema_encode and
+// ltv_schema_decode with the equivalent field table: the same bytes out, and
+// the same status and struct contents for each input.
+//
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_schema.h"
+#include "gen_test_gen.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const ltv_field_t channel_fields[] = {
+    LTV_FIELD(Channel, id, LTV_U8),
+    LTV_FIELD(Channel, gain, LTV_F32),
+    LTV_FIELD(Channel, enabled, LTV_BOOL),
+};
+static const ltv_schema_t channel_schema = LTV_SCHEMA(Channel, channel_fields);
+
+static const ltv_field_t device_fields[] = {
+    LTV_FIELD_STRING(Device, name),
+    LTV_FIELD(Device, a, LTV_U32),
+    LTV_FIELD(Device, b, LTV_I32),
+    LTV_FIELD(Device, c, LTV_F32),
+    LTV_FIELD(Device, d, LTV_F64),
+    LTV_FIELD_ARRAY(Device, levels, LTV_I16),
+    LTV_FIELD_STRUCT(Device, primary, channel_schema),
+    LTV_FIELD_STRUCT_ARRAY(Device, channels, channel_schema),
+    LTV_FIELD(Device, big, LTV_U64),
+    LTV_FIELD(Device, small, LTV_I8),
+    LTV_FIELD_ARRAY(Device, flags, LTV_BOOL),
+    { LTV_KEY("sample-rate"), offsetof(Device, rate), LTV_U16, 0, NULL },
+    LTV_FIELD(Device, offset, LTV_I64),
+    LTV_FIELD(Device, mode, LTV_U8),
+    { LTV_KEY("Gr\303\266\303\237e"), offsetof(Device, size), LTV_F32, 0, NULL },
+    { LTV_KEY("a\"b\\c"), offsetof(Device, quoted), LTV_U8, 0, NULL },
+};
+static const ltv_schema_t device_schema = LTV_SCHEMA(Device, device_fields);
+
+static uint8_t buf[4096];
+static uint8_t expected[4096];
+
+void fail(const char *msg) {
+    printf("%s\n", msg);
+    exit(1);
+}
+
+void make_device(Device *dev) {
+    memset(dev, 0, sizeof(*dev));
+    strcpy(dev->name, "probe-7");
+    dev->a = 4000000000u;
+    dev->b = -123456;
+    dev->c = 1.25f;
+    dev->d = -2.5e100;
+    for (int i = 0; i < 8; i++) dev->levels[i] = i * 1000 - 4000;
+    dev->primary = (Channel){ 9, 0.5f, true };
+    for (int i = 0; i < 4; i++) dev->channels[i] = (Channel){ i, i * 2.0f, i & 1 };
+    dev->big = UINT64_MAX;
+    dev->small = -128;
+    dev->flags[1] = true;
+    dev->rate = 48000;
+    dev->offset = INT64_MIN;
+    dev->mode = 3;
+}
+
+// Decode 'len' bytes of 'buf' with both decoders and compare the results.
+void check_same_decode(size_t len, const char *what) {
+    static Device gen, table;
+    ltv_decoder_t d;
+
+    memset(&gen, 0, sizeof(gen));
+    memset(&table, 0, sizeof(table));
+
+    ltv_decoder_init(&d, buf, len);
+    int gen_status = Device_decode(&d, &gen);
+    ltv_decoder_init(&d, buf, len);
+    int table_status = ltv_schema_decode(&d, &device_schema, &table);
+
+    if (gen_status != table_status || memcmp(&gen, &table, sizeof(gen)) != 0) {
+        printf("%s: generated decoder returned %d, schema decoder %d\n", what, gen_status, table_status);
+        exit(1);
+    }
+}
+
+void check_encode(const Device *dev) {
+    ltv_encoder_t e, t;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_encoder_init_memory(&t, expected, sizeof(expected));
+
+    Device_encode(&e, dev);
+    ltv_schema_encode(&t, &device_schema, dev);
+
+    if (e.status != 0 || e.offset != t.offset || memcmp(buf, expected, e.offset) != 0) {
+        fail("generated encoding differs from schema encoding");
+    }
+
+    // A name filling its whole array has no NUL.
+    Device full = *dev;
+    memset(full.name, 'x', sizeof(full.name));
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_encoder_init_memory(&t, expected, sizeof(expected));
+    Device_encode(&e, &full);
+    ltv_schema_encode(&t, &device_schema, &full);
+    if (e.offset != t.offset || memcmp(buf, expected, e.offset) != 0) {
+        fail("unterminated name");
+    }
+}
+
+void check_round_trip(const Device *dev) {
+    ltv_encoder_t e;
+    ltv_decoder_t d;
+    Device out;
+
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    Device_encode(&e, dev);
+
+    memset(&out, 0, sizeof(out));
+    ltv_decoder_init(&d, buf, e.offset);
+    if (Device_decode(&d, &out) != LTV_SUCCESS || memcmp(&out, dev, sizeof(out)) != 0) {
+        fail("round trip mismatch");
+    }
+    if (ltv_next(&d, &(ltv_data_t){0}) != LTV_DECODE_EOF) {
+        fail("round trip didn't consume the struct");
+    }
+
+    // Every truncation of the encoding.
+    for (size_t len = 0; len < e.offset; len++) {
+        check_same_decode(len, "truncated");
+    }
+}
+
+// Values of every type, in range and out of range for the fields.
+static void write_u8(ltv_encoder_t *e) { ltv_u8(e, 200); }
+static void write_u16(ltv_encoder_t *e) { ltv_u16(e, 60000); }
+static void write_u32(ltv_encoder_t *e) { ltv_u32(e, 0x80000000u); }
+static void write_u64(ltv_encoder_t *e) { ltv_u64(e, UINT64_MAX); }
+static void write_u64_small(ltv_encoder_t *e) { ltv_u64(e, 100); }
+static void write_i8(ltv_encoder_t *e) { ltv_i8(e, -1); }
+static void write_i16(ltv_encoder_t *e) { ltv_i16(e, -300); }
+static void write_i32(ltv_encoder_t *e) { ltv_i32(e, INT32_MIN); }
+static void write_i64(ltv_encoder_t *e) { ltv_i64(e, INT64_MIN); }
+static void write_i64_pos(ltv_encoder_t *e) { ltv_i64(e, 0x100000000ll); }
+static void write_i64_small(ltv_encoder_t *e) { ltv_i64(e, 42); }
+static void write_f32(ltv_encoder_t *e) { ltv_f32(e, -1.5f); }
+static void write_f64(ltv_encoder_t *e) { ltv_f64(e, 0.1); }
+static void write_f64_huge(ltv_encoder_t *e) { ltv_f64(e, 1e300); }
+static void write_f64_inf(ltv_encoder_t *e) { ltv_f64(e, -INFINITY); }
+static void write_bool(ltv_encoder_t *e) { ltv_bool(e, true); }
+static void write_nil(ltv_encoder_t *e) { ltv_nil(e); }
+static void write_string(ltv_encoder_t *e) { ltv_string(e, "7"); }
+static void write_long_string(ltv_encoder_t *e) { ltv_string(e, "0123456789abcdef"); }
+static void write_i16_vec(ltv_encoder_t *e) { static int16_t v[3] = { 1, 2, 3 }; ltv_i16_vec(e, v, 3); }
+static void write_i16_vec_long(ltv_encoder_t *e) { static int16_t v[9]; ltv_i16_vec(e, v, 9); }
+static void write_i32_vec(ltv_encoder_t *e) { static int32_t v[2]; ltv_i32_vec(e, v, 2); }
+static void write_bool_vec(ltv_encoder_t *e) { static bool v[2] = { true, true }; ltv_bool_vec(e, v, 2); }
+static void write_bool_vec_long(ltv_encoder_t *e) { static bool v[4]; ltv_bool_vec(e, v, 4); }
+static void write_bool_vec_bytes(ltv_encoder_t *e) { static const uint8_t v[2] = { 2, 255 }; ltv_write_vector(e, LTV_BOOL, v, 2); }
+static void write_struct(ltv_encoder_t *e) {
+    ltv_struct_start(e);
+    ltv_string(e, "gain"); ltv_u16(e, 7);
+    ltv_string(e, "extra"); ltv_string(e, "x");
+    ltv_string(e, "id"); ltv_i8(e, 5);
+    ltv_struct_end(e);
+}
+static void write_struct_bad(ltv_encoder_t *e) {
+    ltv_struct_start(e); ltv_string(e, "enabled"); ltv_u8(e, 1); ltv_struct_end(e);
+}
+static void write_list(ltv_encoder_t *e) {
+    ltv_list_start(e); write_struct(e); write_struct(e); ltv_list_end(e);
+}
+static void write_list_long(ltv_encoder_t *e) {
+    ltv_list_start(e);
+    for (int i = 0; i < 5; i++) { ltv_struct_start(e); ltv_struct_end(e); }
+    ltv_list_end(e);
+}
+static void write_list_scalar(ltv_encoder_t *e) { ltv_list_start(e); ltv_u8(e, 1); ltv_list_end(e); }
+
+void check_values(void) {
+    static const char *keys[] = {
+        "name", "a", "b", "c", "d", "levels", "primary", "channels", "big", "small", "flags",
+        "sample-rate", "offset", "mode", "rate", "e", "nam", "mod",
+        "Gr\303\266\303\237e", "Gr\303\266\303\237", "Gr\303\203\302\266\303\203\302\237e", "a\"b\\c", "size", "quoted",
+        // Members of 'primary'
+        "id", "gain", "enabled", "enable",
+    };
+    static void (*const writers[])(ltv_encoder_t*) = {
+        write_u8, write_u16, write_u32, write_u64, write_u64_small, write_i8, write_i16, write_i32,
+        write_i64, write_i64_pos, write_i64_small, write_f32, write_f64, write_f64_huge, write_f64_inf,
+        write_bool, write_nil, write_string, write_long_string, write_i16_vec, write_i16_vec_long,
+        write_i32_vec, write_bool_vec, write_bool_vec_long, write_bool_vec_bytes, write_struct, write_struct_bad,
+        write_list, write_list_long, write_list_scalar,
+    };
+
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+        bool nested = k >= sizeof(keys) / sizeof(keys[0]) - 4;
+        for (size_t w = 0; w < sizeof(writers) / sizeof(writers[0]); w++) {
+            ltv_encoder_t e;
+            char what[64];
+            ltv_encoder_init_memory(&e, buf, sizeof(buf));
+            ltv_struct_start(&e);
+            if (nested) {
+                ltv_string(&e, "primary");
+                ltv_struct_start(&e);
+            }
+            ltv_string(&e, keys[k]);
+            writers[w](&e);
+            ltv_string(&e, "mode"); ltv_u8(&e, 1);
+            ltv_struct_end(&e);
+            if (nested) {
+                ltv_struct_end(&e);
+            }
+
+            snprintf(what, sizeof(what), "key %s, writer %zu", keys[k], w);
+            check_same_decode(e.offset, what);
+        }
+    }
+
+    // Non-string keys are skipped with their values.
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_struct_start(&e);
+    ltv_u8(&e, 1); write_list(&e);
+    ltv_string(&e, "a"); ltv_u8(&e, 1);
+    ltv_struct_end(&e);
+    check_same_decode(e.offset, "numeric key");
+
+    // Not a struct
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_u8(&e, 1);
+    check_same_decode(e.offset, "not a struct");
+}
+
+// Random corruptions of a valid encoding.
+void check_mutations(const Device *dev) {
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, expected, sizeof(expected));
+    Device_encode(&e, dev);
+
+    srand(1);
+    for (int i = 0; i < 20000; i++) {
+        memcpy(buf, expected, e.offset);
+        int flips = 1 + rand() % 3;
+        for (int n = 0; n < flips; n++) {
+            buf[rand() % e.offset] = (uint8_t)rand();
+        }
+        check_same_decode(e.offset, "mutated");
+    }
+}
+
+int main() {
+    Device dev;
+    make_device(&dev);
+
+    check_encode(&dev);
+    check_round_trip(&dev);
+    check_values();
+    check_mutations(&dev);
+
+    printf("Generated code tests finished successfully\n");
+    return 0;
+}
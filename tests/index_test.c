@@ -0,0 +1,205 @@
+// Tests for the structural index in litevectors_index.
+//
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_index.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint8_t buf[8192];
+static ltv_index_entry_t entries[512];
+
+void fail(const char *msg) {
+    printf("%s\n", msg);
+    exit(1);
+}
+
+// {"id": 7, "name": "probe", "samples": [1, 2, 3, 4, 5], "children": [{"id": 100}, nil, {"id": 101}, [true]], 
+//  "raw": i16[3], "tail": nil}
+size_t encode(void) {
+    static int16_t raw[] = { -1, 0, 1 };
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+
+    ltv_struct_start(&e);
+    ltv_string(&e, "id"); ltv_u32(&e, 7);
+    ltv_string(&e, "name"); ltv_string(&e, "probe");
+    ltv_string(&e, "samples");
+    ltv_list_start(&e);
+    for (int i = 1; i <= 5; i++) {
+        ltv_i8(&e, -i);
+    }
+    ltv_list_end(&e);
+    ltv_string(&e, "children");
+    ltv_list_start(&e);
+        ltv_struct_start(&e); ltv_string(&e, "id"); ltv_u32(&e, 100); ltv_struct_end(&e);
+        ltv_nil(&e);
+        ltv_struct_start(&e); ltv_string(&e, "id"); ltv_u32(&e, 101); ltv_struct_end(&e);
+        ltv_list_start(&e); ltv_bool(&e, true); ltv_list_end(&e);
+    ltv_list_end(&e);
+    ltv_string(&e, "raw"); ltv_i16_vec(&e, raw, 3);
+    ltv_string(&e, "tail"); ltv_nil(&e);
+    ltv_struct_end(&e);
+
+    return e.offset;
+}
+
+// Every entry decodes to the same element as a plain ltv_next pass.
+void check_entries(ltv_index_t *x, size_t len) {
+    ltv_decoder_t d;
+    ltv_data_t expected, actual;
+    size_t i = 0;
+
+    ltv_decoder_init(&d, buf, len);
+    while (ltv_next(&d, &expected) == LTV_SUCCESS) {
+        if (ltv_index_get(x, i, &actual) != LTV_SUCCESS ||
+            actual.type_code != expected.type_code || actual.size_code != expected.size_code ||
+            actual.length != expected.length || actual.val.v_uint != expected.val.v_uint) {
+            printf("entry %zu mismatch\n", i);
+            exit(1);
+        }
+        i++;
+    }
+    if (i != x->count) {
+        fail("entry count mismatch");
+    }
+}
+
+void check_queries(ltv_index_t *x) {
+    ltv_data_t d;
+
+    size_t id = ltv_index_field(x, 0, "id");
+    if (id == LTV_INDEX_NONE || ltv_index_get(x, id, &d) != LTV_SUCCESS || d.val.v_uint != 7) {
+        fail("field id");
+    }
+
+    size_t name = ltv_index_field(x, 0, "name");
+    if (name == LTV_INDEX_NONE || ltv_index_get(x, name, &d) != LTV_SUCCESS || !is_string_eq(&d, "probe")) {
+        fail("field name");
+    }
+
+    if (ltv_index_field(x, 0, "missing") != LTV_INDEX_NONE || ltv_index_field(x, id, "id") != LTV_INDEX_NONE) {
+        fail("missing field found");
+    }
+
+    // Flat list: direct lookup
+    size_t samples = ltv_index_field(x, 0, "samples");
+    if (samples == LTV_INDEX_NONE || !x->entries[samples].flat) {
+        fail("samples not flat");
+    }
+    for (size_t n = 0; n < 5; n++) {
+        size_t i = ltv_index_element(x, samples, n);
+        if (i == LTV_INDEX_NONE || ltv_index_get(x, i, &d) != LTV_SUCCESS || d.val.v_int != -(int64_t)(n + 1)) {
+            fail("samples element");
+        }
+    }
+    if (ltv_index_element(x, samples, 5) != LTV_INDEX_NONE) {
+        fail("samples out of range");
+    }
+
+    // Nested list: stepping over containers
+    size_t children = ltv_index_field(x, 0, "children");
+    if (children == LTV_INDEX_NONE || x->entries[children].flat || x->entries[0].flat) {
+        fail("children flat");
+    }
+    size_t second = ltv_index_element(x, children, 2);
+    size_t child_id = ltv_index_field(x, second, "id");
+    if (child_id == LTV_INDEX_NONE || ltv_index_get(x, child_id, &d) != LTV_SUCCESS || d.val.v_uint != 101) {
+        fail("children[2].id");
+    }
+    if (ltv_index_get(x, ltv_index_element(x, children, 1), &d) != LTV_SUCCESS || d.type_code != LTV_NIL) {
+        fail("children[1]");
+    }
+    if (ltv_index_element(x, children, 4) != LTV_INDEX_NONE) {
+        fail("children out of range");
+    }
+
+    // Skipping the children list lands on the next key.
+    if (ltv_index_get(x, x->entries[children].next, &d) != LTV_SUCCESS || !is_string_eq(&d, "raw")) {
+        fail("skip children");
+    }
+
+    size_t raw = ltv_index_field(x, 0, "raw");
+    if (raw == LTV_INDEX_NONE || ltv_index_get(x, raw, &d) != LTV_SUCCESS || d.type_code != LTV_I16 || d.length != 6) {
+        fail("field raw");
+    }
+
+    // The top level struct's next is past the end of the buffer.
+    if (x->entries[0].next != x->count) {
+        fail("root next");
+    }
+}
+
+// Without validation, a struct may hold a key with no value or keys that
+// aren't strings. Lookups stay inside the struct and skip such keys.
+void check_trusted(void) {
+    static uint8_t trusted[64];
+    ltv_index_entry_t *few = malloc(4 * sizeof(ltv_index_entry_t));
+    ltv_index_t x;
+    ltv_encoder_t e;
+    ltv_data_t d;
+
+    ltv_encoder_init_memory(&e, trusted, sizeof(trusted));
+    ltv_struct_start(&e); ltv_string(&e, "a"); ltv_struct_end(&e);
+    ltv_index_init(&x, trusted, e.offset, LTV_VALIDATE_TRUSTED, few, 4);
+    if (ltv_index_build(&x) != LTV_DECODE_EOF || x.count != 3) {
+        fail("trusted index build");
+    }
+    if (ltv_index_field(&x, 0, "a") != LTV_INDEX_NONE || ltv_index_field(&x, 0, "b") != LTV_INDEX_NONE) {
+        fail("key without a value");
+    }
+    free(few);
+
+    ltv_encoder_init_memory(&e, trusted, sizeof(trusted));
+    ltv_struct_start(&e);
+    ltv_u32(&e, 0x64636261); ltv_u8(&e, 1);
+    ltv_string(&e, "abcd"); ltv_u8(&e, 2);
+    ltv_struct_end(&e);
+    ltv_index_init(&x, trusted, e.offset, LTV_VALIDATE_TRUSTED, entries, 512);
+    if (ltv_index_build(&x) != LTV_DECODE_EOF) {
+        fail("trusted index build");
+    }
+    size_t i = ltv_index_field(&x, 0, "abcd");
+    if (i == LTV_INDEX_NONE || ltv_index_get(&x, i, &d) != LTV_SUCCESS || d.val.v_uint != 2) {
+        fail("key that isn't a string matched");
+    }
+}
+
+int main() {
+    ltv_index_t x;
+    size_t len = encode();
+
+    // Enough entries
+    ltv_index_init(&x, buf, len, LTV_VALIDATE_FULL, entries, 512);
+    if (ltv_index_build(&x) != LTV_DECODE_EOF) {
+        fail("index build failed");
+    }
+    check_entries(&x, len);
+    check_queries(&x);
+
+    // Growing a few entries at a time
+    static ltv_index_entry_t small[512];
+    size_t size = 3;
+    int status;
+    ltv_index_init(&x, buf, len, LTV_VALIDATE_FULL, small, size);
+    while ((status = ltv_index_build(&x)) == LTV_INDEX_FULL) {
+        size += 3;
+        ltv_index_resize(&x, small, size);
+    }
+    if (status != LTV_DECODE_EOF || memcmp(small, entries, x.count * sizeof(ltv_index_entry_t)) != 0) {
+        fail("resumed index mismatch");
+    }
+
+    // Decoder errors are passed on.
+    ltv_index_init(&x, buf, len - 1, LTV_VALIDATE_FULL, entries, 512);
+    if (ltv_index_build(&x) != LTV_DECODE_UNEXPECTED_EOF) {
+        fail("truncated buffer not reported");
+    }
+
+    check_trusted();
+
+    printf("Index tests finished successfully\n");
+    return 0;
+}
@@ -0,0 +1,263 @@
+// Tests for compiled path queries in litevectors_query.
+//
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_query.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint8_t buf[8192];
+
+void fail(const char *msg) {
+    printf("%s\n", msg);
+    exit(1);
+}
+
+// Two messages, each:
+// {"name": "probe", "channels": [{"id": n, "calibration": {"gain": g, "offset": -1}}, ... x5],
+//  "tags": ["a", "b"], "raw": i16[4]}
+// then a top level u8 7.
+size_t encode(void) {
+    static int16_t raw[] = { 1, 2, 3, 4 };
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+
+    for (int m = 0; m < 2; m++) {
+        ltv_struct_start(&e);
+        ltv_string(&e, "name"); ltv_string(&e, "probe");
+        ltv_string(&e, "channels");
+        ltv_list_start(&e);
+        for (int i = 0; i < 5; i++) {
+            ltv_struct_start(&e);
+            ltv_string(&e, "id"); ltv_u32(&e, m * 10 + i);
+            ltv_string(&e, "calibration");
+            ltv_struct_start(&e);
+            ltv_string(&e, "gain"); ltv_f32(&e, m * 10 + i + 0.5f);
+            ltv_string(&e, "offset"); ltv_i8(&e, -1);
+            ltv_struct_end(&e);
+            ltv_struct_end(&e);
+        }
+        ltv_list_end(&e);
+        ltv_string(&e, "tags");
+        ltv_list_start(&e); ltv_string(&e, "a"); ltv_string(&e, "b"); ltv_list_end(&e);
+        ltv_string(&e, "raw"); ltv_i16_vec(&e, raw, 4);
+        ltv_struct_end(&e);
+    }
+    ltv_u8(&e, 7);
+
+    return e.offset;
+}
+
+typedef struct {
+    ltv_data_t hits[32];
+    size_t count;
+} hits_t;
+
+bool collect(const ltv_data_t *data, ltv_decoder_t *d, void *user_data) {
+    (void) d;
+    hits_t *h = (hits_t*)user_data;
+    if (h->count < 32) {
+        h->hits[h->count] = *data;
+    }
+    h->count++;
+    return true;
+}
+
+// Run 'path' over the whole buffer, collecting the hits.
+void run(const char *path, size_t len, hits_t *h) {
+    ltv_query_t q;
+    ltv_decoder_t d;
+
+    if (ltv_query_compile(&q, path) != LTV_SUCCESS) {
+        printf("compile failed: %s\n", path);
+        exit(1);
+    }
+    h->count = 0;
+    ltv_decoder_init(&d, buf, len);
+    if (ltv_query_run(&q, &d, collect, h) != LTV_DECODE_EOF) {
+        printf("query did not reach the end: %s\n", path);
+        exit(1);
+    }
+}
+
+// The callback reads one member of each channel and leaves the rest.
+bool read_id(const ltv_data_t *data, ltv_decoder_t *d, void *user_data) {
+    ltv_data_t key, value;
+    if (data->type_code != LTV_STRUCT || ltv_next(d, &key) != LTV_SUCCESS || !is_string_eq(&key, "id") ||
+        ltv_next(d, &value) != LTV_SUCCESS) {
+        fail("read_id");
+    }
+    *(uint64_t*)user_data += value.val.v_uint;
+    return true;
+}
+
+void check_paths(size_t len) {
+    hits_t h;
+
+    run("channels[3].calibration.gain", len, &h);
+    if (h.count != 2 || h.hits[0].type_code != LTV_F32 || h.hits[0].val.v_float32 != 3.5f ||
+        h.hits[1].val.v_float32 != 13.5f) {
+        fail("channels[3].calibration.gain");
+    }
+
+    run("channels[*].id", len, &h);
+    if (h.count != 10) {
+        fail("channels[*].id count");
+    }
+    for (size_t i = 0; i < 10; i++) {
+        if (h.hits[i].val.v_uint != (i / 5) * 10 + i % 5) {
+            fail("channels[*].id value");
+        }
+    }
+
+    run("channels[*].*.offset", len, &h);
+    if (h.count != 10 || h.hits[9].val.v_int != -1) {
+        fail("channels[*].*.offset");
+    }
+
+    // Every member value of each message. The trailing u8 isn't a struct.
+    run("*", len, &h);
+    if (h.count != 8 || h.hits[1].type_code != LTV_LIST || h.hits[3].type_code != LTV_I16 || h.hits[3].length != 8) {
+        fail("*");
+    }
+
+    // An empty path matches each top level value.
+    run("", len, &h);
+    if (h.count != 3 || h.hits[0].type_code != LTV_STRUCT || h.hits[2].val.v_uint != 7) {
+        fail("empty path");
+    }
+
+    run("tags[1]", len, &h);
+    if (h.count != 2 || !is_string_eq(&h.hits[0], "b")) {
+        fail("tags[1]");
+    }
+
+    // Paths that lead nowhere.
+    static const char *missing[] = {
+        "channels[5].id", "channels[0].missing", "name[0]", "name.x", "tags.a", "channels.id", "raw[0]", "[0]",
+    };
+    for (size_t i = 0; i < sizeof(missing) / sizeof(missing[0]); i++) {
+        run(missing[i], len, &h);
+        if (h.count != 0) {
+            printf("unexpected hit: %s\n", missing[i]);
+            exit(1);
+        }
+    }
+
+    // A callback reading part of a container.
+    ltv_query_t q;
+    ltv_decoder_t d;
+    uint64_t sum = 0;
+    ltv_query_compile(&q, "channels[*]");
+    ltv_decoder_init(&d, buf, len);
+    if (ltv_query_run(&q, &d, read_id, &sum) != LTV_DECODE_EOF || sum != 10 + 60) {
+        fail("partial read in callback");
+    }
+}
+
+void check_first(size_t len) {
+    ltv_query_t q;
+    ltv_decoder_t d;
+    ltv_data_t data;
+
+    // A container hit leaves the decoder inside it.
+    ltv_query_compile(&q, "channels[2]");
+    ltv_decoder_init(&d, buf, len);
+    if (ltv_query_first(&q, &d, &data) != LTV_SUCCESS || data.type_code != LTV_STRUCT ||
+        ltv_next(&d, &data) != LTV_SUCCESS || !is_string_eq(&data, "id") ||
+        ltv_next(&d, &data) != LTV_SUCCESS || data.val.v_uint != 2) {
+        fail("first container");
+    }
+
+    // Continuing from there finds the next message's match.
+    if (ltv_query_first(&q, &d, &data) != LTV_SUCCESS || ltv_next(&d, &data) != LTV_SUCCESS ||
+        ltv_next(&d, &data) != LTV_SUCCESS || data.val.v_uint != 12) {
+        fail("first continued");
+    }
+
+    ltv_query_compile(&q, "missing");
+    ltv_decoder_init(&d, buf, len);
+    if (ltv_query_first(&q, &d, &data) != LTV_DECODE_EOF) {
+        fail("first missing");
+    }
+
+    // Decoder errors are passed on, even from skipped values.
+    ltv_query_compile(&q, "name");
+    ltv_decoder_init(&d, buf, len - 3);
+    int status;
+    while ((status = ltv_query_first(&q, &d, &data)) == LTV_SUCCESS);
+    if (status != LTV_DECODE_UNEXPECTED_EOF) {
+        fail("truncated buffer not reported");
+    }
+
+    // Without validation, keys that aren't strings never match, even with
+    // the same length as the path key.
+    static uint8_t abcd[] = { 'a', 'b', 'c', 'd' };
+    uint8_t trusted[64];
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, trusted, sizeof(trusted));
+    ltv_struct_start(&e);
+    ltv_u32(&e, 0x64636261); ltv_u8(&e, 1);
+    ltv_u8_vec(&e, abcd, 4); ltv_u8(&e, 2);
+    ltv_string(&e, "abcd"); ltv_u8(&e, 3);
+    ltv_struct_end(&e);
+
+    ltv_query_compile(&q, "abcd");
+    ltv_decoder_init_validation(&d, trusted, e.offset, LTV_VALIDATE_TRUSTED);
+    if (ltv_query_first(&q, &d, &data) != LTV_SUCCESS || data.val.v_uint != 3) {
+        fail("key that isn't a string matched");
+    }
+
+    // A one character string may be encoded as a single value.
+    static const uint8_t single_char[] = {
+        LTV_STRUCT << 4, (LTV_STRING << 4) | LTV_SINGLE, 'x', (LTV_U8 << 4) | LTV_SINGLE, 5, LTV_END << 4,
+    };
+    ltv_query_compile(&q, "x");
+    ltv_decoder_init(&d, single_char, sizeof(single_char));
+    if (ltv_query_first(&q, &d, &data) != LTV_SUCCESS || data.val.v_uint != 5) {
+        fail("single character key");
+    }
+}
+
+void check_compile(void) {
+    static const char *invalid[] = {
+        ".a", "a..b", "a.", "[x]", "[3", "[]", "a[1]b", "[4294967295]", "a[-1]",
+    };
+    ltv_query_t q;
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        if (ltv_query_compile(&q, invalid[i]) != LTV_QUERY_INVALID_PATH) {
+            printf("invalid path compiled: %s\n", invalid[i]);
+            exit(1);
+        }
+    }
+
+    if (ltv_query_compile(&q, "a[12].*[*].bc") != LTV_SUCCESS || q.step_count != 5 ||
+        q.steps[0].kind != LTV_QUERY_KEY || q.steps[1].kind != LTV_QUERY_INDEX || q.steps[1].index != 12 ||
+        q.steps[2].kind != LTV_QUERY_ANY_KEY || q.steps[3].kind != LTV_QUERY_ANY_INDEX ||
+        q.steps[4].key_len != 2 || memcmp(&q.keys[q.steps[4].key_offset], "bc", 2) != 0) {
+        fail("compiled steps");
+    }
+
+    // Too many steps
+    char deep[LTV_QUERY_MAX_STEPS * 3 + 8] = "";
+    for (int i = 0; i <= LTV_QUERY_MAX_STEPS; i++) {
+        strcat(deep, "[0]");
+    }
+    if (ltv_query_compile(&q, deep) != LTV_QUERY_INVALID_PATH) {
+        fail("too many steps");
+    }
+}
+
+int main() {
+    size_t len = encode();
+
+    check_compile();
+    check_paths(len);
+    check_first(len);
+
+    printf("Query tests finished successfully\n");
+    return 0;
+}
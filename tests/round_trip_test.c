@@ -1,5 +1,6 @@
 #include "litevectors.h"
 #include "litevectors_util.h"
+#include "litevectors_mem.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -8,128 +9,133 @@
 #include <math.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <unistd.h>
 
-// Write a bunch of LiteVector data to a buffer.
-void serialize(static_buffer_t *buf) {
-    ltv_encoder_t c;
-    ltv_encoder_init(&c, static_buffer_writer, buf);
-
-    ltv_struct_start(&c);
+// Write a bunch of LiteVector data to an encoder.
+void serialize_values(ltv_encoder_t *c) {
+    ltv_struct_start(c);
 
-    ltv_string(&c, "nil"); ltv_nil(&c);
+    ltv_string(c, "nil"); ltv_nil(c);
 
-    ltv_string(&c, "bool_false"); ltv_bool(&c, false);
-    ltv_string(&c, "bool_true"); ltv_bool(&c, true);
+    ltv_string(c, "bool_false"); ltv_bool(c, false);
+    ltv_string(c, "bool_true"); ltv_bool(c, true);
 
-    ltv_string(&c, "i8"); ltv_i8(&c, -123);
-    ltv_string(&c, "u8"); ltv_u8(&c, 225);
+    ltv_string(c, "i8"); ltv_i8(c, -123);
+    ltv_string(c, "u8"); ltv_u8(c, 225);
 
-    ltv_string(&c, "i16"); ltv_i16(&c, 1234);
-    ltv_string(&c, "u16"); ltv_u16(&c, 50000);
+    ltv_string(c, "i16"); ltv_i16(c, 1234);
+    ltv_string(c, "u16"); ltv_u16(c, 50000);
 
-    ltv_string(&c, "i32"); ltv_i32(&c, -40);
-    ltv_string(&c, "u32"); ltv_u32(&c, 3000000000);
+    ltv_string(c, "i32"); ltv_i32(c, -40);
+    ltv_string(c, "u32"); ltv_u32(c, 3000000000);
 
-    ltv_string(&c, "i64"); ltv_i64(&c, -123456);
-    ltv_string(&c, "u64"); ltv_u64(&c, 99);
+    ltv_string(c, "i64"); ltv_i64(c, -123456);
+    ltv_string(c, "u64"); ltv_u64(c, 99);
 
-    ltv_string(&c, "f32"); ltv_f32(&c, 123.45678901234566789);
-    ltv_string(&c, "f64"); ltv_f64(&c, 123.45678901234566789);
+    ltv_string(c, "f32"); ltv_f32(c, 123.45678901234566789);
+    ltv_string(c, "f64"); ltv_f64(c, 123.45678901234566789);
 
-    ltv_string(&c, "f64_nan"); ltv_f64(&c, NAN);
-    ltv_string(&c, "f64_infinity"); ltv_f64(&c, INFINITY);
-    ltv_string(&c, "f64_neg_infinity"); ltv_f64(&c, -INFINITY);
+    ltv_string(c, "f64_nan"); ltv_f64(c, NAN);
+    ltv_string(c, "f64_infinity"); ltv_f64(c, INFINITY);
+    ltv_string(c, "f64_neg_infinity"); ltv_f64(c, -INFINITY);
 
-    ltv_string(&c, "string"); ltv_string(&c, "HOOP! (There it is)");
-    ltv_string(&c, "string_non_ascii"); ltv_string(&c, "𝐋ṍ𝒓ḝм ℹꝑȿ𝘂м ԁ𝙤ŀ𝖔𝒓 𝘴𝝸ť 𝒂ᵯ𝕖ṯ");
+    ltv_string(c, "string"); ltv_string(c, "HOOP! (There it is)");
+    ltv_string(c, "string_non_ascii"); ltv_string(c, "𝐋ṍ𝒓ḝм ℹꝑȿ𝘂м ԁ𝙤ŀ𝖔𝒓 𝘴𝝸ť 𝒂ᵯ𝕖ṯ");
 
     bool bools[] = { false, true, true, false, true, false, false, true };
-    ltv_string(&c, "bool[]"); ltv_bool_vec(&c, bools, 8);
+    ltv_string(c, "bool[]"); ltv_bool_vec(c, bools, 8);
 
     int8_t i8_nums[] = { 1, 2, 3, 4, 5, -1, INT8_MIN, INT8_MAX };
-    ltv_string(&c, "i8[]"); ltv_i8_vec(&c, i8_nums, 8);
+    ltv_string(c, "i8[]"); ltv_i8_vec(c, i8_nums, 8);
 
     uint8_t u8_nums[] = { 1, 2, 3, 7, 8, 9, 0, UINT8_MAX };
-    ltv_string(&c, "u8[]"); ltv_u8_vec(&c, u8_nums, 8);
+    ltv_string(c, "u8[]"); ltv_u8_vec(c, u8_nums, 8);
 
     int16_t i16_nums[] = { 123, -123, 7, 8, 9, -1, INT16_MIN, INT16_MAX };
-    ltv_string(&c, "i16[]"); ltv_i16_vec(&c, i16_nums, 8);
+    ltv_string(c, "i16[]"); ltv_i16_vec(c, i16_nums, 8);
 
     uint16_t u16_nums[] = { 123, 456, 789, 1011, 1213, 0, 1, UINT16_MAX };
-    ltv_string(&c, "u16[]"); ltv_u16_vec(&c, u16_nums, 8);
+    ltv_string(c, "u16[]"); ltv_u16_vec(c, u16_nums, 8);
 
     int32_t i32_nums[] = { 123, 456, 789, 101112, 131415, -1, INT32_MIN, INT32_MAX };
-    ltv_string(&c, "i32[]"); ltv_i32_vec(&c, i32_nums, 8);
+    ltv_string(c, "i32[]"); ltv_i32_vec(c, i32_nums, 8);
 
     uint32_t u32_nums[] = { 123, 456, 789, 101112, 131415, 0, 1, UINT32_MAX };
-    ltv_string(&c, "u32[]"); ltv_u32_vec(&c, u32_nums, 8);
+    ltv_string(c, "u32[]"); ltv_u32_vec(c, u32_nums, 8);
 
     int64_t i64_nums[] = { 123, 456, 789, 101112, 131415, -1, INT64_MIN, INT64_MAX };
-    ltv_string(&c, "i64[]"); ltv_i64_vec(&c, i64_nums, 8);
+    ltv_string(c, "i64[]"); ltv_i64_vec(c, i64_nums, 8);
 
     uint64_t u64_nums[] = { 123, 456, 789, 101112, 131415, 0, 1, UINT64_MAX };
-    ltv_string(&c, "u64[]"); ltv_u64_vec(&c, u64_nums, 8);
+    ltv_string(c, "u64[]"); ltv_u64_vec(c, u64_nums, 8);
 
     float f32_nums[] = { 1.23, 4.56, 7.89, 1.01112, 1.31415, -1.0, FLT_MIN, FLT_MAX};
-    ltv_string(&c, "f32[]"); ltv_f32_vec(&c, f32_nums, 8);
+    ltv_string(c, "f32[]"); ltv_f32_vec(c, f32_nums, 8);
 
     double f64_nums[] = { 1.23, 4.56, 7.89, 1.01112, 1.31415, -1.0, DBL_MIN, DBL_MAX };
-    ltv_string(&c, "f64[]"); ltv_f64_vec(&c, f64_nums, 8);
-
-    ltv_string(&c, "list"); 
-    ltv_list_start(&c);
-        ltv_u32(&c, 123456789);
-        ltv_nil(&c);
-        ltv_bool(&c, true);
-        ltv_string(&c, "A string");
-    ltv_list_end(&c);
-
-    ltv_string(&c, "map");
-    ltv_struct_start(&c);
-        ltv_string(&c, "level"); ltv_i8(&c, 1);
-        ltv_string(&c, "nested"); ltv_bool(&c, 1);
-        ltv_string(&c, "next");
-        ltv_struct_start(&c);
-            ltv_string(&c, "level"); ltv_i8(&c, 2);
-            ltv_string(&c, "nested"); ltv_bool(&c, 1);
-        ltv_struct_end(&c);
-    ltv_struct_end(&c);
-
-    ltv_string(&c, "boundaries");
-    ltv_struct_start(&c);
-        ltv_string(&c, "int8_MIN"); ltv_i8(&c, SCHAR_MIN);
-        ltv_string(&c, "int16_MIN"); ltv_i16(&c, SHRT_MIN);
-        ltv_string(&c, "int32_MIN"); ltv_i32(&c, INT_MIN);
-        ltv_string(&c, "int64_MIN"); ltv_i64(&c, LLONG_MIN);
-
-        ltv_string(&c, "int8_MAX"); ltv_i8(&c, SCHAR_MAX);
-        ltv_string(&c, "int16_MAX"); ltv_i16(&c, SHRT_MAX);
-        ltv_string(&c, "int32_MAX"); ltv_i32(&c, INT_MAX);
-        ltv_string(&c, "int64_MAX"); ltv_i64(&c, LLONG_MAX);
-
-        ltv_string(&c, "uint8_MAX"); ltv_u8(&c, UCHAR_MAX);
-        ltv_string(&c, "uint16_MAX"); ltv_u16(&c, USHRT_MAX);
-        ltv_string(&c, "uint32_MAX"); ltv_u32(&c, UINT_MAX);
-        ltv_string(&c, "uint64_MAX"); ltv_u64(&c, ULLONG_MAX);
-
-        ltv_string(&c, "float32_MIN"); ltv_f32(&c, FLT_MIN);
-        ltv_string(&c, "float32_MAX"); ltv_f32(&c, FLT_MAX);
-        ltv_string(&c, "float32_pos_zero"); ltv_f32(&c, +0.0f);
-        ltv_string(&c, "float32_neg_zero"); ltv_f32(&c, -0.0f);
-        ltv_string(&c, "float32_pos_infinity"); ltv_f32(&c, INFINITY);
-        ltv_string(&c, "float32_neg_infinity"); ltv_f32(&c, -INFINITY);
-        ltv_string(&c, "float32_nan"); ltv_f32(&c, NAN);
-
-        ltv_string(&c, "float64_MIN"); ltv_f64(&c, DBL_MIN);
-        ltv_string(&c, "float64_MAX"); ltv_f64(&c, DBL_MAX);
-        ltv_string(&c, "float64_pos_zero"); ltv_f64(&c, +0.0);
-        ltv_string(&c, "float64_neg_zero"); ltv_f64(&c, -0.0);
-        ltv_string(&c, "float64_pos_infinity"); ltv_f64(&c, INFINITY);
-        ltv_string(&c, "float64_neg_infinity"); ltv_f64(&c, -INFINITY);
-        ltv_string(&c, "float64_nan"); ltv_f64(&c, NAN);
-    ltv_struct_end(&c);
-
-    ltv_struct_end(&c);
+    ltv_string(c, "f64[]"); ltv_f64_vec(c, f64_nums, 8);
+
+    ltv_string(c, "list"); 
+    ltv_list_start(c);
+        ltv_u32(c, 123456789);
+        ltv_nil(c);
+        ltv_bool(c, true);
+        ltv_string(c, "A string");
+    ltv_list_end(c);
+
+    ltv_string(c, "map");
+    ltv_struct_start(c);
+        ltv_string(c, "level"); ltv_i8(c, 1);
+        ltv_string(c, "nested"); ltv_bool(c, 1);
+        ltv_string(c, "next");
+        ltv_struct_start(c);
+            ltv_string(c, "level"); ltv_i8(c, 2);
+            ltv_string(c, "nested"); ltv_bool(c, 1);
+        ltv_struct_end(c);
+    ltv_struct_end(c);
+
+    ltv_string(c, "boundaries");
+    ltv_struct_start(c);
+        ltv_string(c, "int8_MIN"); ltv_i8(c, SCHAR_MIN);
+        ltv_string(c, "int16_MIN"); ltv_i16(c, SHRT_MIN);
+        ltv_string(c, "int32_MIN"); ltv_i32(c, INT_MIN);
+        ltv_string(c, "int64_MIN"); ltv_i64(c, LLONG_MIN);
+
+        ltv_string(c, "int8_MAX"); ltv_i8(c, SCHAR_MAX);
+        ltv_string(c, "int16_MAX"); ltv_i16(c, SHRT_MAX);
+        ltv_string(c, "int32_MAX"); ltv_i32(c, INT_MAX);
+        ltv_string(c, "int64_MAX"); ltv_i64(c, LLONG_MAX);
+
+        ltv_string(c, "uint8_MAX"); ltv_u8(c, UCHAR_MAX);
+        ltv_string(c, "uint16_MAX"); ltv_u16(c, USHRT_MAX);
+        ltv_string(c, "uint32_MAX"); ltv_u32(c, UINT_MAX);
+        ltv_string(c, "uint64_MAX"); ltv_u64(c, ULLONG_MAX);
+
+        ltv_string(c, "float32_MIN"); ltv_f32(c, FLT_MIN);
+        ltv_string(c, "float32_MAX"); ltv_f32(c, FLT_MAX);
+        ltv_string(c, "float32_pos_zero"); ltv_f32(c, +0.0f);
+        ltv_string(c, "float32_neg_zero"); ltv_f32(c, -0.0f);
+        ltv_string(c, "float32_pos_infinity"); ltv_f32(c, INFINITY);
+        ltv_string(c, "float32_neg_infinity"); ltv_f32(c, -INFINITY);
+        ltv_string(c, "float32_nan"); ltv_f32(c, NAN);
+
+        ltv_string(c, "float64_MIN"); ltv_f64(c, DBL_MIN);
+        ltv_string(c, "float64_MAX"); ltv_f64(c, DBL_MAX);
+        ltv_string(c, "float64_pos_zero"); ltv_f64(c, +0.0);
+        ltv_string(c, "float64_neg_zero"); ltv_f64(c, -0.0);
+        ltv_string(c, "float64_pos_infinity"); ltv_f64(c, INFINITY);
+        ltv_string(c, "float64_neg_infinity"); ltv_f64(c, -INFINITY);
+        ltv_string(c, "float64_nan"); ltv_f64(c, NAN);
+    ltv_struct_end(c);
+
+    ltv_struct_end(c);
+}
+
+// Write a bunch of LiteVector data to a buffer.
+void serialize(static_buffer_t *buf) {
+    ltv_encoder_t c;
+    ltv_encoder_init(&c, static_buffer_writer, buf);
+    serialize_values(&c);
 
     if (c.status != 0) {
         printf("Encode error writing to static buffer: %d\n", c.status);
@@ -137,6 +143,1021 @@ void serialize(static_buffer_t *buf) {
     }
 }
 
+// Write the same data through a memory encoder, which must produce identical output.
+void validate_memory(static_buffer_t *expected) {
+    static uint8_t buf[sizeof(expected->data)];
+
+    ltv_encoder_t c;
+    ltv_encoder_init_memory(&c, buf, sizeof(buf));
+    serialize_values(&c);
+
+    if (c.status != 0 || c.offset != expected->size || memcmp(buf, expected->data, c.offset) != 0) {
+        printf("memory encoder output mismatch\n");
+        exit(1);
+    }
+
+    // A buffer one byte short must overflow.
+    ltv_encoder_init_memory(&c, buf, expected->size - 1);
+    serialize_values(&c);
+
+    if (c.status != LTV_ENCODE_BUFFER_FULL) {
+        printf("memory encoder overflow not flagged: %d\n", c.status);
+        exit(1);
+    }
+}
+
+// The inline emitters must match the regular encoder byte for byte.
+void validate_memory_inline() {
+    static uint8_t expected[512];
+    static uint8_t buf[512];
+
+    bool bools[] = { false, true, true };
+    int16_t i16_nums[] = { 123, -123, INT16_MIN };
+    float f32_nums[] = { 1.23, 4.56, FLT_MAX };
+    uint64_t u64_nums[] = { 123, 0, UINT64_MAX };
+    double f64_nums[300] = { 0 };
+
+    ltv_encoder_t c, m;
+    ltv_encoder_init_memory(&c, expected, sizeof(expected));
+    ltv_encoder_init_memory(&m, buf, sizeof(buf));
+
+    ltv_struct_start(&c);                                   ltv_mem_struct_start(&m);
+    ltv_string(&c, "nil"); ltv_nil(&c);                     ltv_mem_string(&m, "nil"); ltv_mem_nil(&m);
+    ltv_string(&c, "b"); ltv_bool(&c, true);                ltv_mem_string(&m, "b"); ltv_mem_bool(&m, true);
+    ltv_string(&c, "i8"); ltv_i8(&c, -5);                   ltv_mem_string(&m, "i8"); ltv_mem_i8(&m, -5);
+    ltv_string(&c, "u16"); ltv_u16(&c, 50000);              ltv_mem_string(&m, "u16"); ltv_mem_u16(&m, 50000);
+    ltv_string(&c, "i32"); ltv_i32(&c, -40);                ltv_mem_string(&m, "i32"); ltv_mem_i32(&m, -40);
+    ltv_string(&c, "u64"); ltv_u64(&c, UINT64_MAX);         ltv_mem_string(&m, "u64"); ltv_mem_u64(&m, UINT64_MAX);
+    ltv_string(&c, "f32"); ltv_f32(&c, 1.5f);               ltv_mem_string(&m, "f32"); ltv_mem_f32(&m, 1.5f);
+    ltv_string(&c, "f64"); ltv_f64(&c, -2.5);               ltv_mem_string(&m, "f64"); ltv_mem_f64(&m, -2.5);
+    ltv_string(&c, "bool[]"); ltv_bool_vec(&c, bools, 3);   ltv_mem_string(&m, "bool[]"); ltv_mem_bool_vec(&m, bools, 3);
+    ltv_string(&c, "i16[]"); ltv_i16_vec(&c, i16_nums, 3);  ltv_mem_string(&m, "i16[]"); ltv_mem_i16_vec(&m, i16_nums, 3);
+    ltv_string(&c, "f32[]"); ltv_f32_vec(&c, f32_nums, 3);  ltv_mem_string(&m, "f32[]"); ltv_mem_f32_vec(&m, f32_nums, 3);
+    ltv_string(&c, "u64[]"); ltv_u64_vec(&c, u64_nums, 3);  ltv_mem_string(&m, "u64[]"); ltv_mem_u64_vec(&m, u64_nums, 3);
+    ltv_list_start(&c); ltv_list_end(&c);                   ltv_mem_list_start(&m); ltv_mem_list_end(&m);
+    ltv_struct_end(&c);                                     ltv_mem_struct_end(&m);
+
+    if (c.status != 0 || m.status != 0 || c.offset != m.offset || memcmp(buf, expected, c.offset) != 0) {
+        printf("inline memory encoder output mismatch\n");
+        exit(1);
+    }
+
+    // A vector that does not fit must be flagged.
+    ltv_mem_f64_vec(&m, f64_nums, 300);
+    if (m.status != LTV_ENCODE_BUFFER_FULL) {
+        printf("inline memory encoder overflow not flagged: %d\n", m.status);
+        exit(1);
+    }
+}
+
+// A measuring encoder must report the exact encoded size.
+void validate_measure(static_buffer_t *expected) {
+    ltv_encoder_t c;
+    ltv_encoder_init_measure(&c);
+    serialize_values(&c);
+
+    if (c.status != 0 || c.offset != expected->size) {
+        printf("measured size mismatch, expected: %zu, got %zu\n", expected->size, c.offset);
+        exit(1);
+    }
+}
+
+// A gather writer that concatenates segments into a static buffer, and 
+// counts segments that reference caller memory rather than the stage.
+static uint8_t gather_stage[LTV_GATHER_COPY_LIMIT];
+static int gather_references = 0;
+
+int gather_writer(const ltv_iovec_t *iov, size_t iov_count, void* user_data) {
+    for (size_t i = 0; i < iov_count; i++) {
+        const uint8_t *base = iov[i].base;
+        if (base < gather_stage || base >= gather_stage + sizeof(gather_stage)) {
+            gather_references++;
+        }
+        if (static_buffer_writer(base, iov[i].len, user_data) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Write the same data through a gather encoder, which must produce identical output.
+void validate_gather(static_buffer_t *expected) {
+    static static_buffer_t buf;
+    ltv_iovec_t iov[4];
+    float payload[64] = { 0 };
+
+    ltv_encoder_t c;
+    ltv_encoder_init_gather(&c, gather_writer, &buf, gather_stage, sizeof(gather_stage), iov, 4);
+    serialize_values(&c);
+
+    if (ltv_flush(&c) != 0 || buf.size != expected->size || memcmp(buf.data, expected->data, buf.size) != 0) {
+        printf("gather encoder output mismatch\n");
+        exit(1);
+    }
+
+    // Large payloads must be passed by reference.
+    gather_references = 0;
+    ltv_f32_vec(&c, payload, 64);
+    ltv_flush(&c);
+    if (gather_references != 1) {
+        printf("gather encoder copied a large payload\n");
+        exit(1);
+    }
+
+    // Stages too small to hold every copied write, and a single iov, are
+    // rejected: tags and lengths are encoded in temporaries that must not be
+    // referenced.
+    uint8_t tiny_stage[16];
+    buf.size = 0;
+    ltv_encoder_init_gather(&c, gather_writer, &buf, tiny_stage, sizeof(tiny_stage), iov, 4);
+    serialize_values(&c);
+    if (ltv_flush(&c) != LTV_ENCODE_GATHER_BUFFERS || buf.size != 0) {
+        printf("gather encoder accepted a tiny stage\n");
+        exit(1);
+    }
+    ltv_encoder_init_gather(&c, gather_writer, &buf, NULL, 0, iov, 4);
+    ltv_u8(&c, 1);
+    if (ltv_flush(&c) != LTV_ENCODE_GATHER_BUFFERS || buf.size != 0) {
+        printf("gather encoder accepted a NULL stage\n");
+        exit(1);
+    }
+    ltv_encoder_init_gather(&c, gather_writer, &buf, gather_stage, sizeof(gather_stage), iov, 1);
+    ltv_u8(&c, 1);
+    if (ltv_flush(&c) != LTV_ENCODE_GATHER_BUFFERS || buf.size != 0) {
+        printf("gather encoder accepted a single iov\n");
+        exit(1);
+    }
+
+    // Write through a file descriptor and read back.
+    FILE *f = tmpfile();
+    int fd = fileno(f);
+    uint8_t iov_stage[LTV_GATHER_COPY_LIMIT];
+    ltv_encoder_init_gather(&c, fd_gather_writer, &fd, iov_stage, sizeof(iov_stage), iov, 4);
+    serialize_values(&c);
+    if (ltv_flush(&c) != 0) {
+        printf("fd_gather_writer failed: %d\n", c.status);
+        exit(1);
+    }
+
+    rewind(f);
+    static uint8_t readback[sizeof(expected->data)];
+    size_t nread = fread(readback, 1, sizeof(readback), f);
+    fclose(f);
+    if (nread != expected->size || memcmp(readback, expected->data, nread) != 0) {
+        printf("fd_gather_writer output mismatch\n");
+        exit(1);
+    }
+}
+
+// Pre-encoded keys must match ltv_string output.
+void validate_keys() {
+    static const ltv_key_t key_literal = LTV_KEY("Setting_A");
+    static const ltv_key_t key_empty = LTV_KEY("");
+    uint8_t expected[64], buf[64];
+    ltv_key_t key_runtime;
+
+    if (!ltv_key_init(&key_runtime, "CalibrationVector")) {
+        printf("ltv_key_init failed\n");
+        exit(1);
+    }
+
+    ltv_encoder_t c, k;
+    ltv_encoder_init_memory(&c, expected, sizeof(expected));
+    ltv_encoder_init_memory(&k, buf, sizeof(buf));
+
+    ltv_string(&c, "Setting_A");                ltv_key(&k, &key_literal);
+    ltv_string(&c, "");                         ltv_key(&k, &key_empty);
+    ltv_string_n(&c, "CalibrationVector", 17);  ltv_mem_key(&k, &key_runtime);
+
+    if (c.offset != k.offset || memcmp(buf, expected, c.offset) != 0) {
+        printf("pre-encoded key output mismatch\n");
+        exit(1);
+    }
+
+    char too_long[LTV_KEY_MAX_LEN + 2];
+    memset(too_long, 'a', sizeof(too_long) - 1);
+    too_long[sizeof(too_long) - 1] = 0;
+    if (ltv_key_init(&key_runtime, too_long)) {
+        printf("ltv_key_init accepted an oversized key\n");
+        exit(1);
+    }
+}
+
+// Check a vector of 'count' u16 values 0, 1, 2... decodes from 'buf'.
+void check_incremental(const uint8_t *buf, size_t len, size_t count) {
+    ltv_decoder_t dec;
+    ltv_data_t d;
+    ltv_decoder_init(&dec, buf, len);
+
+    if (ltv_next(&dec, &d) != LTV_SUCCESS || d.type_code != LTV_U16 || d.length != count * 2) {
+        printf("incremental vector did not decode\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint16_t v;
+        memcpy(&v, d.val.v_buffer + i * 2, 2);
+        if (v != i) {
+            printf("incremental vector value mismatch at %zu\n", i);
+            exit(1);
+        }
+    }
+}
+
+// Incremental vectors must match ltv_write_vector, and unsized vectors must
+// have their length patched.
+void validate_incremental() {
+    static uint8_t expected[4096], buf[4096];
+    static static_buffer_t sbuf;
+    uint16_t values[1000];
+    uint8_t stage[64];
+    ltv_encoder_t c, e;
+
+    for (int i = 0; i < 1000; i++) {
+        values[i] = i;
+    }
+
+    // Known count, appended in uneven pieces. Start at an odd offset to force padding.
+    ltv_encoder_init_memory(&c, expected, sizeof(expected));
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_nil(&c);                                    ltv_nil(&e);
+    ltv_u16_vec(&c, values, 1000);                  ltv_vector_begin(&e, LTV_U16, 1000);
+    for (int i = 0; i < 1000; i += 333) {
+        ltv_vector_append(&e, &values[i], i + 333 > 1000 ? 1000 - i : 333);
+    }
+    ltv_vector_end(&e);
+
+    if (e.status != 0 || c.offset != e.offset || memcmp(buf, expected, c.offset) != 0) {
+        printf("incremental vector output mismatch\n");
+        exit(1);
+    }
+
+    // Appending too much or too little is an error.
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_vector_begin(&e, LTV_U16, 3);
+    ltv_vector_append(&e, values, 4);
+    if (e.status != LTV_ENCODE_VECTOR_LENGTH) {
+        printf("incremental vector overrun not flagged\n");
+        exit(1);
+    }
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_vector_begin(&e, LTV_U16, 3);
+    ltv_vector_append(&e, values, 2);
+    ltv_vector_end(&e);
+    if (e.status != LTV_ENCODE_VECTOR_LENGTH) {
+        printf("incremental vector underrun not flagged\n");
+        exit(1);
+    }
+
+    // Unsized, patched in memory.
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_vector_begin_unsized(&e, LTV_U16);
+    ltv_vector_append(&e, values, 10);
+    ltv_vector_append(&e, &values[10], 90);
+    ltv_vector_end(&e);
+    check_incremental(buf, e.offset, 100);
+
+    // Unsized, patched in a buffered encoder's stage.
+    sbuf.size = 0;
+    ltv_encoder_init_buffered(&e, static_buffer_writer, &sbuf, stage, sizeof(stage));
+    ltv_vector_begin_unsized(&e, LTV_U16);
+    ltv_vector_append(&e, values, 5);
+    ltv_vector_end(&e);
+    ltv_flush(&e);
+    check_incremental(sbuf.data, sbuf.size, 5);
+
+    // Unsized, patched in a gather encoder's stage.
+    sbuf.size = 0;
+    ltv_iovec_t iov[4];
+    ltv_encoder_init_gather(&e, gather_writer, &sbuf, gather_stage, sizeof(gather_stage), iov, 4);
+    ltv_vector_begin_unsized(&e, LTV_U16);
+    ltv_vector_append(&e, values, 500);
+    ltv_vector_append(&e, &values[500], 3);
+    ltv_vector_end(&e);
+    ltv_flush(&e);
+    check_incremental(sbuf.data, sbuf.size, 503);
+
+    // Unsized, without a patcher once the length has left the encoder.
+    sbuf.size = 0;
+    ltv_encoder_init(&e, static_buffer_writer, &sbuf);
+    ltv_vector_begin_unsized(&e, LTV_U16);
+    ltv_vector_append(&e, values, 100);
+    ltv_vector_end(&e);
+    if (e.status != LTV_ENCODE_NOT_SEEKABLE) {
+        printf("unpatchable vector not flagged\n");
+        exit(1);
+    }
+
+    // Unsized, patched through a patcher.
+    sbuf.size = 0;
+    ltv_encoder_init_buffered(&e, static_buffer_writer, &sbuf, stage, sizeof(stage));
+    ltv_encoder_set_patcher(&e, static_buffer_patcher);
+    ltv_vector_begin_unsized(&e, LTV_U16);
+    ltv_vector_append(&e, values, 100);
+    ltv_vector_append(&e, &values[100], 100);
+    ltv_vector_end(&e);
+    ltv_flush(&e);
+    check_incremental(sbuf.data, sbuf.size, 200);
+
+    // Unsized, patched through a file descriptor.
+    FILE *f = tmpfile();
+    int fd = fileno(f);
+    ltv_encoder_init(&e, fd_writer, &fd);
+    ltv_encoder_set_patcher(&e, fd_patcher);
+    ltv_vector_begin_unsized(&e, LTV_U16);
+    ltv_vector_append(&e, values, 1000);
+    ltv_vector_end(&e);
+    rewind(f);
+    size_t nread = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    check_incremental(buf, nread, 1000);
+}
+
+// Spliced fragments must match encoding the values directly, at any offset.
+void validate_fragments() {
+    static uint8_t frag_buf[8192], nested_buf[8192], expected[8192], buf[8192];
+    ltv_align_record_t records[32], nested_records[32];
+    ltv_fragment_t frag, nested;
+    ltv_encoder_t c, e;
+
+    ltv_fragment_init(&frag, frag_buf, sizeof(frag_buf), records, 32);
+    serialize_values(&frag.encoder);
+
+    for (int prefix = 0; prefix < 8; prefix++) {
+        ltv_encoder_init_memory(&c, expected, sizeof(expected));
+        ltv_encoder_init_memory(&e, buf, sizeof(buf));
+        for (int i = 0; i < prefix; i++) {
+            ltv_nil(&c);
+            ltv_nil(&e);
+        }
+        serialize_values(&c);
+        ltv_fragment_splice(&e, &frag);
+
+        if (e.status != 0 || c.offset != e.offset || memcmp(buf, expected, c.offset) != 0) {
+            printf("spliced fragment mismatch at offset %d\n", prefix);
+            exit(1);
+        }
+    }
+
+    // A fragment spliced into a fragment at an odd offset.
+    ltv_fragment_init(&nested, nested_buf, sizeof(nested_buf), nested_records, 32);
+    ltv_list_start(&nested.encoder);
+    ltv_nil(&nested.encoder);
+    ltv_fragment_splice(&nested.encoder, &frag);
+    ltv_list_end(&nested.encoder);
+
+    ltv_encoder_init_memory(&c, expected, sizeof(expected));
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_u16(&c, 1); ltv_list_start(&c); ltv_nil(&c); serialize_values(&c); ltv_list_end(&c);
+    ltv_u16(&e, 1); ltv_fragment_splice(&e, &nested);
+
+    if (e.status != 0 || c.offset != e.offset || memcmp(buf, expected, c.offset) != 0) {
+        printf("nested fragment mismatch\n");
+        exit(1);
+    }
+
+    // Running out of records fails the fragment, and the splice.
+    ltv_fragment_init(&frag, frag_buf, sizeof(frag_buf), records, 2);
+    serialize_values(&frag.encoder);
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_fragment_splice(&e, &frag);
+    if (e.status != LTV_ENCODE_BUFFER_FULL) {
+        printf("fragment record overflow not flagged\n");
+        exit(1);
+    }
+}
+
+// Write through an async file, with buffers small enough to force back-pressure.
+void validate_async_file(static_buffer_t *expected) {
+    static uint8_t readback[sizeof(expected->data)];
+    FILE *f = tmpfile();
+    async_file_t af;
+
+    if (async_file_open(&af, fileno(f), 100, 2, ASYNC_FILE_SYNC_CLOSE) != 0) {
+        printf("async_file_open failed\n");
+        exit(1);
+    }
+
+    ltv_encoder_t c;
+    for (int i = 0; i < 3; i++) {
+        ltv_encoder_init(&c, async_file_writer, &af);
+        serialize_values(&c);
+        if (c.status != 0) {
+            printf("async file write failed: %d\n", c.status);
+            exit(1);
+        }
+    }
+
+    if (async_file_close(&af) != 0) {
+        printf("async_file_close failed\n");
+        exit(1);
+    }
+
+    rewind(f);
+    for (int i = 0; i < 3; i++) {
+        size_t nread = fread(readback, 1, expected->size, f);
+        if (nread != expected->size || memcmp(readback, expected->data, nread) != 0) {
+            printf("async file output mismatch\n");
+            exit(1);
+        }
+    }
+    fclose(f);
+
+    // Write errors are reported to the encoder.
+    if (async_file_open(&af, -1, 100, 2, ASYNC_FILE_SYNC_NONE) != 0) {
+        printf("async_file_open failed\n");
+        exit(1);
+    }
+    ltv_encoder_init(&c, async_file_writer, &af);
+    for (int i = 0; i < 3; i++) {
+        serialize_values(&c);
+    }
+    if (c.status == 0 || async_file_close(&af) == 0) {
+        printf("async file write error not reported\n");
+        exit(1);
+    }
+}
+
+// Skip the value at every element position in turn, under each structural
+// policy, and check the decoder lands on the element following that value.
+void validate_skip(static_buffer_t *buf) {
+    static const uint8_t policies[] = { LTV_VALIDATE_FULL, LTV_VALIDATE_TRUSTED };
+    ltv_decoder_t ref, dec;
+    ltv_data_t d;
+
+    size_t count = 0;
+    ltv_decoder_init(&ref, buf->data, buf->size);
+    while (ltv_next(&ref, &d) == LTV_SUCCESS) {
+        count++;
+    }
+
+    for (size_t p = 0; p < sizeof(policies); p++) {
+        for (size_t k = 0; k < count; k++) {
+            ltv_decoder_init_validation(&dec, buf->data, buf->size, policies[p]);
+            ltv_decoder_init_validation(&ref, buf->data, buf->size, policies[p]);
+            for (size_t i = 0; i < k; i++) {
+                ltv_next(&dec, &d);
+                ltv_next(&ref, &d);
+            }
+
+            // The reference decoder steps to the end of the value.
+            size_t depth = ref.nest_depth;
+            do {
+                ltv_next(&ref, &d);
+            } while (ref.nest_depth > depth);
+
+            if (ltv_skip(&dec) != LTV_SUCCESS || dec.idx != ref.idx || dec.nest_depth != ref.nest_depth ||
+                memcmp(dec.nest_stack, ref.nest_stack, dec.nest_depth) != 0) {
+                printf("ltv_skip mismatch at element %zu\n", k);
+                exit(1);
+            }
+
+            // Decoding carries on normally after a skip.
+            int status;
+            while ((status = ltv_next(&dec, &d)) == LTV_SUCCESS);
+            if (status != LTV_DECODE_EOF) {
+                printf("decode failed after ltv_skip at element %zu\n", k);
+                exit(1);
+            }
+        }
+    }
+
+    // Skipping a value in place of a struct key is a structure error.
+    ltv_decoder_init(&dec, buf->data, buf->size);
+    ltv_next(&dec, &d);
+    ltv_skip(&dec);
+    dec.nest_stack[0] = LTV_STRUCT;
+    if (ltv_skip(&dec) != LTV_DECODE_INVALID_STRUCT_KEY) {
+        printf("ltv_skip did not check struct keys\n");
+        exit(1);
+    }
+}
+
+// Decoding in batches of every size matches decoding one value at a time,
+// including where and how decoding stops on a truncated buffer.
+void validate_batch(static_buffer_t *buf) {
+    static ltv_data_t expected[512], actual[512];
+    static uint8_t tags[512];
+    static size_t offsets[512], lengths[512];
+    ltv_batch_t soa = { tags, offsets, lengths };
+
+    for (size_t len = buf->size; len > buf->size - 40; len -= 13) {
+        ltv_decoder_t ref, dec, soa_dec;
+        size_t count = 0;
+        int expected_status;
+
+        ltv_decoder_init(&ref, buf->data, len);
+        while ((expected_status = ltv_next(&ref, &expected[count])) == LTV_SUCCESS) {
+            count++;
+        }
+
+        for (size_t batch = 1; batch < 10; batch++) {
+            size_t total = 0, n;
+            int status;
+
+            ltv_decoder_init(&dec, buf->data, len);
+            while ((status = ltv_next_batch(&dec, &actual[total], batch, &n)) == LTV_SUCCESS) {
+                total += n;
+            }
+            total += n;
+
+            if (status != expected_status || total != count || dec.idx != ref.idx || dec.nest_depth != ref.nest_depth) {
+                printf("ltv_next_batch(%zu) stopped differently\n", batch);
+                exit(1);
+            }
+
+            total = 0;
+            ltv_decoder_init(&soa_dec, buf->data, len);
+            do {
+                ltv_batch_t out = { &tags[total], &offsets[total], &lengths[total] };
+                status = ltv_next_batch_soa(&soa_dec, &out, batch, &n);
+                total += n;
+            } while (status == LTV_SUCCESS);
+
+            if (status != expected_status || total != count || soa_dec.idx != ref.idx) {
+                printf("ltv_next_batch_soa(%zu) stopped differently\n", batch);
+                exit(1);
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                ltv_data_t *e = &expected[i];
+                if (actual[i].type_code != e->type_code || actual[i].size_code != e->size_code ||
+                    actual[i].length != e->length || actual[i].val.v_uint != e->val.v_uint ||
+                    soa.tags[i] != ((e->type_code << 4) | e->size_code) || soa.lengths[i] != e->length) {
+                    printf("batch element %zu mismatch\n", i);
+                    exit(1);
+                }
+                if ((e->type_code == LTV_STRING || e->size_code != LTV_SINGLE) && 
+                    &buf->data[soa.offsets[i]] != e->val.v_buffer) {
+                    printf("batch element %zu offset mismatch\n", i);
+                    exit(1);
+                }
+            }
+        }
+    }
+}
+
+// Decode a stream fed in chunks of random sizes. Every element must match
+// decoding the whole buffer at once.
+void check_stream(const uint8_t *buf, size_t len, size_t carry_size, unsigned seed) {
+    static ltv_data_t expected[512];
+    static uint8_t carry[512];
+    static uint8_t chunk[64];
+    ltv_stream_decoder_t s;
+    ltv_decoder_t ref;
+    ltv_data_t d;
+    size_t count = 0, fed = 0, i = 0;
+    int expected_status, status;
+
+    ltv_decoder_init(&ref, buf, len);
+    while ((expected_status = ltv_next(&ref, &expected[count])) == LTV_SUCCESS) {
+        count++;
+    }
+
+    srand(seed);
+    ltv_stream_init(&s, carry, carry_size, LTV_VALIDATE_FULL);
+    for (;;) {
+        status = ltv_stream_next(&s, &d);
+        if (status == LTV_DECODE_NEED_DATA) {
+            if (fed == len) {
+                ltv_stream_finish(&s);
+                continue;
+            }
+
+            // Chunks are copied into one reused buffer, so nothing may point
+            // back into an earlier chunk.
+            size_t n = 1 + rand() % sizeof(chunk);
+            n = n < len - fed ? n : len - fed;
+            memcpy(chunk, &buf[fed], n);
+            memset(&chunk[n], 0xAA, sizeof(chunk) - n);
+            ltv_stream_feed(&s, chunk, n);
+            fed += n;
+            continue;
+        }
+        if (status != LTV_SUCCESS) {
+            break;
+        }
+
+        ltv_data_t *e = &expected[i++];
+        bool by_ref = e->type_code == LTV_STRING || (e->size_code != LTV_SINGLE && e->type_code > LTV_END);
+        if (d.type_code != e->type_code || d.size_code != e->size_code || d.length != e->length ||
+            (by_ref ? memcmp(d.val.v_buffer, e->val.v_buffer, d.length) != 0 : d.val.v_uint != e->val.v_uint)) {
+            printf("stream element %zu mismatch\n", i - 1);
+            exit(1);
+        }
+    }
+
+    if (status != expected_status || i != count) {
+        printf("stream ended with %d after %zu elements, expected %d after %zu\n", status, i, expected_status, count);
+        exit(1);
+    }
+}
+
+void validate_stream(static_buffer_t *buf) {
+    for (unsigned seed = 0; seed < 200; seed++) {
+        check_stream(buf->data, buf->size, 512, seed);
+        check_stream(buf->data, buf->size - 1 - seed % 50, 512, seed);
+    }
+
+    // Values that don't fit the carry buffer.
+    ltv_stream_decoder_t s;
+    ltv_data_t d;
+    uint8_t carry[8];
+    size_t fed = 0;
+    int status;
+    ltv_stream_init(&s, carry, sizeof(carry), LTV_VALIDATE_FULL);
+    while ((status = ltv_stream_next(&s, &d)) == LTV_SUCCESS || (status == LTV_DECODE_NEED_DATA && fed < buf->size)) {
+        if (status == LTV_DECODE_NEED_DATA) {
+            size_t n = buf->size - fed < 40 ? buf->size - fed : 40;
+            ltv_stream_feed(&s, &buf->data[fed], n);
+            fed += n;
+        }
+    }
+    if (status != LTV_DECODE_CARRY_FULL) {
+        printf("carry overflow not reported: %d\n", status);
+        exit(1);
+    }
+
+    // Bytes needed to finish a split value.
+    static int64_t values[10];
+    uint8_t msg[128];
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, msg, sizeof(msg));
+    ltv_i64_vec(&e, values, 10);
+
+    uint8_t big_carry[128];
+    ltv_stream_init(&s, big_carry, sizeof(big_carry), LTV_VALIDATE_FULL);
+    size_t tag = e.offset - 82;
+    ltv_stream_feed(&s, msg, tag + 1);
+    if (ltv_stream_next(&s, &d) != LTV_DECODE_NEED_DATA || ltv_stream_needed(&s) != 1) {
+        printf("stream needed for length\n");
+        exit(1);
+    }
+    ltv_stream_feed(&s, &msg[tag + 1], 11);
+    if (ltv_stream_next(&s, &d) != LTV_DECODE_NEED_DATA || ltv_stream_needed(&s) != 70) {
+        printf("stream needed for payload: %zu\n", ltv_stream_needed(&s));
+        exit(1);
+    }
+    ltv_stream_feed(&s, &msg[tag + 12], 70);
+    if (ltv_stream_next(&s, &d) != LTV_SUCCESS || d.length != 80 || ltv_stream_needed(&s) != 1) {
+        printf("stream split vector\n");
+        exit(1);
+    }
+}
+
+// Find each name of a key matcher as decoded keys, in order and shuffled.
+void check_key_matcher(size_t count) {
+    static char storage[2000][24];
+    static const char *names[2000];
+    static uint8_t buf[2000 * 32];
+    key_matcher_t m;
+
+    // Similar names: a shared prefix, and lengths either side of 8 and 16.
+    for (size_t i = 0; i < count; i++) {
+        snprintf(storage[i], sizeof(storage[i]), i % 3 ? "field_%zu" : "sensor_channel_%zu", i);
+        names[i] = storage[i];
+    }
+    if (count > 0) {
+        storage[0][0] = 0;
+    }
+    if (!key_matcher_init(&m, names, count)) {
+        printf("key_matcher_init failed for %zu names\n", count);
+        exit(1);
+    }
+
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    for (size_t i = 0; i < count; i++) {
+        ltv_string(&e, names[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        ltv_string(&e, names[(i * 7919) % count]);
+    }
+    ltv_string(&e, "field_x");
+    ltv_string(&e, "sensor_channel_1");
+    ltv_u8(&e, 0);
+
+    ltv_decoder_t d;
+    ltv_data_t key;
+    ltv_decoder_init(&d, buf, e.offset);
+    for (size_t i = 0; i < count * 2; i++) {
+        size_t expected = i < count ? i : (i * 7919) % count;
+        ltv_next(&d, &key);
+        if (key_matcher_find(&m, &key) != expected) {
+            printf("key matcher (%zu names) mismatch at %zu\n", count, i);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        ltv_next(&d, &key);
+        if (key_matcher_find(&m, &key) != KEY_MATCHER_NONE) {
+            printf("key matcher (%zu names) found a missing key\n", count);
+            exit(1);
+        }
+    }
+    key_matcher_free(&m);
+}
+
+void validate_key_matcher() {
+    static const size_t counts[] = {0, 1, 2, 3, 10, 50, 200, 2000};
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        check_key_matcher(counts[i]);
+    }
+
+    // Repeated names can't be told apart.
+    static const char *repeated[] = {"a", "b", "a"};
+    key_matcher_t m;
+    if (key_matcher_init(&m, repeated, 3)) {
+        printf("key_matcher_init accepted a repeated name\n");
+        exit(1);
+    }
+}
+
+// Check that a mapped file holds the expected data and decodes to the end.
+void check_mapped_file(mapped_file_t *f, static_buffer_t *expected, bool mapped) {
+    ltv_data_t data;
+    int status;
+
+    if (f->mapped != mapped || f->size != expected->size || memcmp(f->data, expected->data, f->size) != 0) {
+        printf("mapped file contents mismatch\n");
+        exit(1);
+    }
+    while ((status = ltv_next(&f->decoder, &data)) == LTV_SUCCESS);
+    if (status != LTV_DECODE_EOF) {
+        printf("mapped file decode failed: %d\n", status);
+        exit(1);
+    }
+    mapped_file_close(f);
+}
+
+// Decode a regular file, which is mapped, and a pipe, which is read.
+void validate_mapped_file(static_buffer_t *expected) {
+    mapped_file_t mf;
+    FILE *f = tmpfile();
+    fwrite(expected->data, 1, expected->size, f);
+    fflush(f);
+
+    if (mapped_file_open_fd(&mf, fileno(f), LTV_VALIDATE_FULL) != 0) {
+        printf("mapped_file_open_fd failed\n");
+        exit(1);
+    }
+    check_mapped_file(&mf, expected, true);
+    fclose(f);
+
+    int fds[2];
+    if (pipe(fds) != 0 || write(fds[1], expected->data, expected->size) != (ssize_t)expected->size) {
+        printf("pipe setup failed\n");
+        exit(1);
+    }
+    close(fds[1]);
+    if (mapped_file_open_fd(&mf, fds[0], LTV_VALIDATE_FULL) != 0) {
+        printf("mapped_file_open_fd failed on a pipe\n");
+        exit(1);
+    }
+    check_mapped_file(&mf, expected, false);
+    close(fds[0]);
+
+    if (mapped_file_open(&mf, "/nonexistent/file.ltv", LTV_VALIDATE_FULL) == 0) {
+        printf("mapped_file_open of a missing file succeeded\n");
+        exit(1);
+    }
+}
+
+// Input for a reader decoder, handed out in reads of random sizes.
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+} memory_reader_t;
+
+int memory_reader(void *buf, size_t len, size_t *n, void *user_data) {
+    memory_reader_t *m = (memory_reader_t*)user_data;
+    size_t count = 1 + rand() % 100;
+    count = count < len ? count : len;
+    count = count < m->len - m->pos ? count : m->len - m->pos;
+    memcpy(buf, &m->data[m->pos], count);
+    m->pos += count;
+    *n = count;
+    return 0;
+}
+
+// Decode through a reader, reading streamed payloads in pieces of random
+// sizes (or skipping them). Every element must match decoding the whole 
+// buffer at once.
+void check_reader(const uint8_t *buf, size_t len, size_t buf_size, size_t threshold, unsigned seed) {
+    static ltv_data_t expected[512];
+    static uint8_t read_buf[512];
+    static uint8_t payload[4096];
+    memory_reader_t m = { buf, len, 0 };
+    ltv_reader_decoder_t r;
+    ltv_decoder_t ref;
+    ltv_data_t d;
+    size_t count = 0, i = 0;
+    int expected_status, status;
+
+    ltv_decoder_init(&ref, buf, len);
+    while ((expected_status = ltv_next(&ref, &expected[count])) == LTV_SUCCESS) {
+        count++;
+    }
+
+    srand(seed);
+    ltv_reader_init(&r, memory_reader, &m, read_buf, buf_size, threshold, LTV_VALIDATE_FULL);
+    while ((status = ltv_reader_next(&r, &d)) == LTV_SUCCESS) {
+        ltv_data_t *e = &expected[i++];
+        bool by_ref = e->type_code == LTV_STRING || (e->size_code != LTV_SINGLE && e->type_code > LTV_END);
+        const uint8_t *value = d.val.v_buffer;
+
+        if (by_ref && value == NULL) {
+            if (d.length <= threshold || e->type_code == LTV_STRING) {
+                printf("reader element %zu streamed below the threshold\n", i - 1);
+                exit(1);
+            }
+            if (rand() % 4 == 0) {
+                continue;
+            }
+
+            // Room for less than an element is an error, and reads nothing.
+            size_t got = 0, n;
+            do {
+                size_t max = 1 + rand() % 40;
+                if (max < r.payload_type_size) {
+                    uint64_t remaining = r.payload_remaining;
+                    n = 12345;
+                    if (ltv_reader_payload(&r, &payload[got], max, &n) != LTV_DECODE_PAYLOAD_TOO_SMALL ||
+                        n != 12345 || r.payload_remaining != remaining) {
+                        printf("reader payload accepted a short buffer at element %zu\n", i - 1);
+                        exit(1);
+                    }
+                    continue;
+                }
+                if (ltv_reader_payload(&r, &payload[got], max, &n) != LTV_SUCCESS || n % (r.payload_type_size) != 0) {
+                    printf("reader payload error at element %zu\n", i - 1);
+                    exit(1);
+                }
+                got += n;
+            } while (r.payload_remaining > 0);
+            if (ltv_reader_payload(&r, payload, 40, &n) != LTV_SUCCESS || n != 0) {
+                printf("reader payload not finished at element %zu\n", i - 1);
+                exit(1);
+            }
+            value = payload;
+        }
+
+        if (d.type_code != e->type_code || d.size_code != e->size_code || d.length != e->length ||
+            (by_ref ? memcmp(value, e->val.v_buffer, d.length) != 0 : d.val.v_uint != e->val.v_uint)) {
+            printf("reader element %zu mismatch\n", i - 1);
+            exit(1);
+        }
+    }
+
+    if (status != expected_status || i != count) {
+        printf("reader ended with %d after %zu elements, expected %d after %zu\n", status, i, expected_status, count);
+        exit(1);
+    }
+}
+
+void validate_reader(static_buffer_t *buf) {
+    for (unsigned seed = 0; seed < 100; seed++) {
+        check_reader(buf->data, buf->size, 512, 400, seed);
+        check_reader(buf->data, buf->size, 512, 16, seed);
+        check_reader(buf->data, buf->size - 1 - seed % 50, 512, 16, seed);
+    }
+
+    // A vector many times the size of the read buffer.
+    static int32_t values[100000];
+    static uint8_t msg[sizeof(values) + 64];
+    for (size_t i = 0; i < 100000; i++) {
+        values[i] = (int32_t)(i * 2654435761u);
+    }
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, msg, sizeof(msg));
+    ltv_list_start(&e);
+    ltv_i32_vec(&e, values, 100000);
+    ltv_u8(&e, 7);
+    ltv_list_end(&e);
+
+    for (int truncate = 0; truncate < 2; truncate++) {
+        memory_reader_t m = { msg, truncate ? e.offset - 100 : e.offset, 0 };
+        ltv_reader_decoder_t r;
+        ltv_data_t d;
+        uint8_t read_buf[64];
+        int32_t out[3];
+        size_t n, got = 0;
+        int status;
+
+        ltv_reader_init(&r, memory_reader, &m, read_buf, sizeof(read_buf), 32, LTV_VALIDATE_FULL);
+        ltv_reader_next(&r, &d);
+        if (ltv_reader_next(&r, &d) != LTV_SUCCESS || d.type_code != LTV_I32 || d.length != sizeof(values) || d.val.v_buffer != NULL) {
+            printf("reader large vector header\n");
+            exit(1);
+        }
+        while ((status = ltv_reader_payload(&r, out, 10, &n)) == LTV_SUCCESS && n > 0) {
+            if (n != 8 || memcmp(out, &values[got / 4], n) != 0) {
+                printf("reader large vector payload at %zu\n", got);
+                exit(1);
+            }
+            got += n;
+        }
+
+        if (truncate) {
+            if (status != LTV_DECODE_UNEXPECTED_EOF) {
+                printf("reader truncated payload not reported: %d\n", status);
+                exit(1);
+            }
+            continue;
+        }
+        if (status != LTV_SUCCESS || got != sizeof(values) ||
+            ltv_reader_next(&r, &d) != LTV_SUCCESS || d.val.v_uint != 7 ||
+            ltv_reader_next(&r, &d) != LTV_SUCCESS || d.type_code != LTV_END ||
+            ltv_reader_next(&r, &d) != LTV_DECODE_EOF) {
+            printf("reader large vector\n");
+            exit(1);
+        }
+    }
+}
+
+// Allocator hooks that count allocations made by a dynamic buffer.
+static int resize_count = 0;
+
+void* counting_resize(void *ptr, size_t old_size, size_t new_size, void *user_data) {
+    (void) old_size;
+    (*(int*)user_data)++;
+    return realloc(ptr, new_size);
+}
+
+void counting_release(void *ptr, size_t size, void *user_data) {
+    (void) size;
+    (void) user_data;
+    free(ptr);
+}
+
+// Write the same data to a dynamic buffer, which must produce identical output.
+void validate_dynamic(static_buffer_t *expected) {
+    const ltv_allocator_t allocator = { counting_resize, counting_release, &resize_count };
+    dynamic_buffer_t buf;
+
+    if (!dynamic_buffer_init(&buf, 0, &allocator)) {
+        printf("dynamic buffer init failed\n");
+        exit(1);
+    }
+
+    ltv_encoder_t c;
+    for (int i = 0; i < 3; i++) {
+        dynamic_buffer_reset(&buf);
+        ltv_encoder_init(&c, dynamic_buffer_writer, &buf);
+        serialize_values(&c);
+
+        if (c.status != 0 || buf.size != expected->size || memcmp(buf.data, expected->data, buf.size) != 0) {
+            printf("dynamic buffer output mismatch\n");
+            exit(1);
+        }
+    }
+
+    // Reuse after reset must not allocate again.
+    int count = resize_count;
+    dynamic_buffer_reset(&buf);
+    ltv_encoder_init(&c, dynamic_buffer_writer, &buf);
+    serialize_values(&c);
+    if (resize_count != count) {
+        printf("dynamic buffer reallocated after reset\n");
+        exit(1);
+    }
+
+    size_t size, capacity;
+    uint8_t *data = dynamic_buffer_detach(&buf, &size, &capacity);
+    if (size != expected->size || buf.data != NULL || buf.capacity != 0) {
+        printf("dynamic buffer detach failed\n");
+        exit(1);
+    }
+    counting_release(data, capacity, NULL);
+    dynamic_buffer_free(&buf);
+}
+
+// Write the same data through a buffered encoder, which must produce identical output.
+void validate_buffered(static_buffer_t *expected, size_t stage_size) {
+    static static_buffer_t buf;
+    uint8_t stage[256];
+    buf.size = 0;
+
+    ltv_encoder_t c;
+    ltv_encoder_init_buffered(&c, static_buffer_writer, &buf, stage, stage_size);
+    serialize_values(&c);
+
+    if (c.offset != expected->size) {
+        printf("buffered encoder offset mismatch, expected: %zu, got %zu\n", expected->size, c.offset);
+        exit(1);
+    }
+
+    if (ltv_flush(&c) != 0) {
+        printf("Encode error flushing buffered encoder: %d\n", c.status);
+        exit(1);
+    }
+
+    if (buf.size != expected->size || memcmp(buf.data, expected->data, buf.size) != 0) {
+        printf("buffered encoder output mismatch (stage size %zu)\n", stage_size);
+        exit(1);
+    }
+}
+
 void assert_type(ltv_data_t *d, int expected) {
     if (d->type_code != expected) {
         printf("type code mismatch, expected: %d, got %d\n", expected, d->type_code);
@@ -307,6 +1328,24 @@ int main() {
     serialize(&buf);
     validate(&buf);
 
+    validate_buffered(&buf, 16);
+    validate_buffered(&buf, 256);
+    validate_memory(&buf);
+    validate_memory_inline();
+    validate_dynamic(&buf);
+    validate_measure(&buf);
+    validate_gather(&buf);
+    validate_keys();
+    validate_incremental();
+    validate_fragments();
+    validate_async_file(&buf);
+    validate_skip(&buf);
+    validate_batch(&buf);
+    validate_stream(&buf);
+    validate_reader(&buf);
+    validate_mapped_file(&buf);
+    validate_key_matcher();
+
     printf("Round trip test finished successfully\n");
     return 0;
 }
@@ -30,13 +30,47 @@ void printLtvData(ltv_data_t *d) {
     printf("  length:   %zu\n", d->length);
 }
 
+// Errors the trusted validation policy doesn't check for.
+bool isSkippedWhenTrusted(int status) {
+    return status == LTV_DECODE_INVALID_UTF8 || status == LTV_DECODE_INVALID_STRUCT_KEY ||
+        status == LTV_DECODE_EXPECTED_STRUCT_VALUE || status == LTV_DECODE_INVALID_VECTOR_LENGTH;
+}
+
+// Decode a whole buffer with a validation policy, returning the final status.
+// Strings are checked with ltv_validate_string after they are decoded, as 
+// an application using the keys-only or deferred policies would.
+int decodeAll(const uint8_t *buf, size_t len, uint8_t validation, ltv_data_t *data) {
+    ltv_decoder_t dec;
+    int status;
+
+    ltv_decoder_init_validation(&dec, buf, len, validation);
+    while ((status = ltv_next(&dec, data)) == LTV_SUCCESS) {
+        if (validation == LTV_VALIDATE_KEYS || validation == LTV_VALIDATE_DEFERRED) {
+            status = ltv_validate_string(data);
+            if (status != LTV_SUCCESS) {
+                break;
+            }
+        }
+    }
+    return status;
+}
+
+// Skip over every top level value, returning the final status.
+int skipAll(const uint8_t *buf, size_t len, uint8_t validation) {
+    ltv_decoder_t dec;
+    int status;
+
+    ltv_decoder_init_validation(&dec, buf, len, validation);
+    while ((status = ltv_skip(&dec)) == LTV_SUCCESS);
+    return status;
+}
+
 // Read and process a test vector file. 
 // if positive is true, all vectors should parse successfully
 // if positive if false, all vectors should throw an error
-void processTestVector(const char* fileName, bool positive) {
+void processTestVector(const char* fileName, bool positive, uint8_t validation) {
 
     int status;
-    ltv_decoder_t dec;
     ltv_data_t data;
 
     FILE *fd = fopen(fileName, "r");
@@ -54,17 +88,31 @@ void processTestVector(const char* fileName, bool positive) {
             binBuf[dataLen] = hex2num(dataBuf[i]) << 4 | hex2num(dataBuf[i+1]);
         }
 
-        // Intialize the decoder
-        ltv_decoder_init(&dec, binBuf, dataLen);
-
         // Parse through the data
-        do {
-            status = ltv_next(&dec, &data);
-        } while(status == LTV_SUCCESS);
+        status = decodeAll(binBuf, dataLen, validation, &data);
+
+        // Skipping checks everything except UTF-8.
+        int skipStatus = skipAll(binBuf, dataLen, validation);
+        if (positive ? skipStatus != LTV_DECODE_EOF : 
+            skipStatus == LTV_DECODE_EOF && status != LTV_DECODE_INVALID_UTF8 && validation != LTV_VALIDATE_TRUSTED) {
+            printf("Test: %s", descBuf);
+            printf("Data: %s", dataBuf);
+            printf("Validation policy: %d\n", validation);
+            printf("Unexpected ltv_skip result: %s\n", ltv_status_text(skipStatus));
+            exit(-1);
+        }
+
+        // Trusted decoding only has to catch errors that would otherwise
+        // read outside the buffer.
+        if (!positive && validation == LTV_VALIDATE_TRUSTED && status == LTV_DECODE_EOF &&
+            isSkippedWhenTrusted(decodeAll(binBuf, dataLen, LTV_VALIDATE_FULL, &data))) {
+            continue;
+        }
 
         if (positive && status != LTV_DECODE_EOF) {
             printf("Test: %s", descBuf);
             printf("Data: %s", dataBuf);
+            printf("Validation policy: %d\n", validation);
             printf("Unexpected error decoding positive vector: %s\n", ltv_status_text(status));
             printLtvData(&data);
             exit(-1);
@@ -73,16 +121,23 @@ void processTestVector(const char* fileName, bool positive) {
         if (!positive && status == LTV_DECODE_EOF) {
             printf("Test: %s", descBuf);
             printf("Data: %s", dataBuf);
+            printf("Validation policy: %d\n", validation);
             printf("Unflagged decode error in negative vector\n");
             printLtvData(&data);
             exit(-1);
         }
     }
+    fclose(fd);
 }
 
 int main() {
-    processTestVector("litevectors_positive.txt", true);
-    processTestVector("litevectors_negative.txt", false);
+    static const uint8_t policies[] = {
+        LTV_VALIDATE_FULL, LTV_VALIDATE_KEYS, LTV_VALIDATE_DEFERRED, LTV_VALIDATE_TRUSTED
+    };
+    for (size_t i = 0; i < sizeof(policies); i++) {
+        processTestVector("litevectors_positive.txt", true, policies[i]);
+        processTestVector("litevectors_negative.txt", false, policies[i]);
+    }
     printf("Tests Completed Successfully\n");
     return 0;
 }
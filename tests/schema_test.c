@@ -0,0 +1,373 @@
+// Tests for the schema binding in litevectors_schema.
+//
+#include "litevectors.h"
+#include "litevectors_util.h"
+#include "litevectors_schema.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    uint8_t id;
+    float gain;
+    bool enabled;
+} channel_t;
+
+typedef struct {
+    char name[16];
+    uint32_t a;
+    int32_t b;
+    float c;
+    double d;
+    int16_t levels[8];
+    channel_t primary;
+    channel_t channels[4];
+    uint64_t big;
+    int8_t small;
+    bool flags[3];
+} device_t;
+
+static const ltv_field_t channel_fields[] = {
+    LTV_FIELD(channel_t, id, LTV_U8),
+    LTV_FIELD(channel_t, gain, LTV_F32),
+    LTV_FIELD(channel_t, enabled, LTV_BOOL),
+};
+static const ltv_schema_t channel_schema = LTV_SCHEMA(channel_t, channel_fields);
+
+static const ltv_field_t device_fields[] = {
+    LTV_FIELD_STRING(device_t, name),
+    LTV_FIELD(device_t, a, LTV_U32),
+    LTV_FIELD(device_t, b, LTV_I32),
+    LTV_FIELD(device_t, c, LTV_F32),
+    LTV_FIELD(device_t, d, LTV_F64),
+    LTV_FIELD_ARRAY(device_t, levels, LTV_I16),
+    LTV_FIELD_STRUCT(device_t, primary, channel_schema),
+    LTV_FIELD_STRUCT_ARRAY(device_t, channels, channel_schema),
+    LTV_FIELD(device_t, big, LTV_U64),
+    LTV_FIELD(device_t, small, LTV_I8),
+    LTV_FIELD_ARRAY(device_t, flags, LTV_BOOL),
+};
+static const ltv_schema_t device_schema = LTV_SCHEMA(device_t, device_fields);
+
+static uint8_t buf[4096];
+static uint8_t expected[4096];
+
+void fail(const char *msg) {
+    printf("%s\n", msg);
+    exit(1);
+}
+
+void make_device(device_t *dev) {
+    memset(dev, 0, sizeof(*dev));
+    strcpy(dev->name, "probe-7");
+    dev->a = 4000000000u;
+    dev->b = -123456;
+    dev->c = 1.25f;
+    dev->d = -2.5e100;
+    for (int i = 0; i < 8; i++) dev->levels[i] = i * 1000 - 4000;
+    dev->primary = (channel_t){ 9, 0.5f, true };
+    for (int i = 0; i < 4; i++) dev->channels[i] = (channel_t){ i, i * 2.0f, i & 1 };
+    dev->big = UINT64_MAX;
+    dev->small = -128;
+    dev->flags[1] = true;
+}
+
+void encode_channel(ltv_encoder_t *e, const channel_t *c) {
+    ltv_struct_start(e);
+    ltv_string(e, "id"); ltv_u8(e, c->id);
+    ltv_string(e, "gain"); ltv_f32(e, c->gain);
+    ltv_string(e, "enabled"); ltv_bool(e, c->enabled);
+    ltv_struct_end(e);
+}
+
+// The schema encoder writes the same as the equivalent hand-written code.
+void check_encode(const device_t *dev) {
+    ltv_encoder_t e, h;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_encoder_init_memory(&h, expected, sizeof(expected));
+
+    ltv_schema_encode(&e, &device_schema, dev);
+
+    ltv_struct_start(&h);
+    ltv_string(&h, "name"); ltv_string(&h, dev->name);
+    ltv_string(&h, "a"); ltv_u32(&h, dev->a);
+    ltv_string(&h, "b"); ltv_i32(&h, dev->b);
+    ltv_string(&h, "c"); ltv_f32(&h, dev->c);
+    ltv_string(&h, "d"); ltv_f64(&h, dev->d);
+    ltv_string(&h, "levels"); ltv_i16_vec(&h, (int16_t*)dev->levels, 8);
+    ltv_string(&h, "primary"); encode_channel(&h, &dev->primary);
+    ltv_string(&h, "channels");
+    ltv_list_start(&h);
+    for (int i = 0; i < 4; i++) encode_channel(&h, &dev->channels[i]);
+    ltv_list_end(&h);
+    ltv_string(&h, "big"); ltv_u64(&h, dev->big);
+    ltv_string(&h, "small"); ltv_i8(&h, dev->small);
+    ltv_string(&h, "flags"); ltv_bool_vec(&h, (bool*)dev->flags, 3);
+    ltv_struct_end(&h);
+
+    if (e.status != 0 || e.offset != h.offset || memcmp(buf, expected, e.offset) != 0) {
+        fail("schema encoding differs from hand-written encoding");
+    }
+
+    // A name filling its whole array has no NUL.
+    device_t full = *dev;
+    memset(full.name, 'x', sizeof(full.name));
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_schema_encode(&e, &device_schema, &full);
+
+    ltv_decoder_t d;
+    ltv_data_t data;
+    ltv_decoder_init(&d, buf, e.offset);
+    ltv_next(&d, &data);
+    ltv_next(&d, &data);
+    if (ltv_next(&d, &data) != LTV_SUCCESS || data.length != sizeof(full.name)) {
+        fail("unterminated name");
+    }
+}
+
+void check_round_trip(const device_t *dev) {
+    ltv_encoder_t e;
+    ltv_decoder_t d;
+    device_t out;
+
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_schema_encode(&e, &device_schema, dev);
+
+    memset(&out, 0, sizeof(out));
+    ltv_decoder_init(&d, buf, e.offset);
+    if (ltv_schema_decode(&d, &device_schema, &out) != LTV_SUCCESS || memcmp(&out, dev, sizeof(out)) != 0) {
+        fail("round trip mismatch");
+    }
+    if (ltv_next(&d, &(ltv_data_t){0}) != LTV_DECODE_EOF) {
+        fail("round trip didn't consume the struct");
+    }
+}
+
+// Keys out of order, unknown keys, missing fields and converted numbers.
+void check_loose(const ltv_schema_t *schema) {
+    static int16_t short_levels[] = { 1, 2, 3 };
+    static const uint8_t flag_bytes[] = { 2, 0, 255 };
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_struct_start(&e);
+    ltv_string(&e, "small"); ltv_i64(&e, 5);
+    ltv_string(&e, "unknown");
+    ltv_list_start(&e); ltv_struct_start(&e); ltv_string(&e, "a"); ltv_u8(&e, 1); ltv_struct_end(&e); ltv_list_end(&e);
+    ltv_string(&e, "a"); ltv_u64(&e, 7);
+    ltv_string(&e, "c"); ltv_i8(&e, -3);
+    ltv_string(&e, "d"); ltv_f32(&e, 0.5f);
+    ltv_string(&e, "b"); ltv_u8(&e, 200);
+    ltv_string(&e, "levels"); ltv_i16_vec(&e, short_levels, 3);
+    ltv_string(&e, "channels");
+    ltv_list_start(&e);
+    ltv_struct_start(&e); ltv_string(&e, "gain"); ltv_f64(&e, 4.0); ltv_struct_end(&e);
+    ltv_list_end(&e);
+    ltv_string(&e, "name"); ltv_string(&e, "");
+    ltv_string(&e, "flags"); ltv_write_vector(&e, LTV_BOOL, flag_bytes, 3);
+    ltv_struct_end(&e);
+
+    device_t out;
+    ltv_decoder_t d;
+    memset(&out, 0xAB, sizeof(out));
+    ltv_decoder_init(&d, buf, e.offset);
+    if (ltv_schema_decode(&d, schema, &out) != LTV_SUCCESS) {
+        fail("loose decode failed");
+    }
+    if (out.small != 5 || out.a != 7 || out.c != -3.0f || out.d != 0.5 || out.b != 200 ||
+        out.levels[2] != 3 || (uint16_t)out.levels[3] != 0xABAB || out.channels[0].gain != 4.0f ||
+        out.channels[0].id != 0xAB || out.channels[1].id != 0xAB || out.name[0] != 0 || out.big != 0xABABABABABABABABull) {
+        fail("loose decode values");
+    }
+
+    // Bools are stored as 0 or 1, whatever the bytes in the data.
+    uint8_t flags[3];
+    memcpy(flags, out.flags, 3);
+    if (flags[0] != 1 || flags[1] != 0 || flags[2] != 1) {
+        fail("bool array not normalized");
+    }
+}
+
+// A wide struct with its keys shuffled decodes the same with and without an
+// index.
+#define WIDE_FIELDS 200
+
+void check_index(void) {
+    static char names[WIDE_FIELDS][16];
+    static ltv_field_t fields[WIDE_FIELDS];
+    static uint32_t linear[WIDE_FIELDS], indexed[WIDE_FIELDS];
+    static uint8_t wide_buf[8192];
+    ltv_schema_t schema = { fields, WIDE_FIELDS, sizeof(linear), NULL };
+    size_t order[WIDE_FIELDS];
+
+    for (size_t i = 0; i < WIDE_FIELDS; i++) {
+        snprintf(names[i], sizeof(names[i]), "field_%zu", i);
+        ltv_key_init(&fields[i].key, names[i]);
+        fields[i].offset = i * sizeof(uint32_t);
+        fields[i].type_code = LTV_U32;
+        order[i] = i;
+    }
+    srand(7);
+    for (size_t i = WIDE_FIELDS - 1; i > 0; i--) {
+        size_t j = rand() % (i + 1), t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    ltv_encoder_t e;
+    ltv_encoder_init_memory(&e, wide_buf, sizeof(wide_buf));
+    ltv_struct_start(&e);
+    for (size_t i = 0; i < WIDE_FIELDS; i++) {
+        ltv_key(&e, &fields[order[i]].key);
+        ltv_u32(&e, order[i] * 3);
+        if (i % 50 == 0) {
+            ltv_string(&e, "unknown"); ltv_nil(&e);
+        }
+    }
+    ltv_struct_end(&e);
+
+    ltv_decoder_t d;
+    ltv_decoder_init(&d, wide_buf, e.offset);
+    if (ltv_schema_decode(&d, &schema, linear) != LTV_SUCCESS) {
+        fail("wide decode failed");
+    }
+    if (!ltv_schema_index(&schema)) {
+        fail("index failed");
+    }
+    ltv_decoder_init(&d, wide_buf, e.offset);
+    if (ltv_schema_decode(&d, &schema, indexed) != LTV_SUCCESS) {
+        fail("indexed wide decode failed");
+    }
+    for (size_t i = 0; i < WIDE_FIELDS; i++) {
+        if (linear[i] != i * 3 || indexed[i] != i * 3) {
+            printf("wide field %zu: %u, indexed %u\n", i, linear[i], indexed[i]);
+            exit(1);
+        }
+    }
+    ltv_schema_index_free(&schema);
+    if (schema.matcher != NULL) {
+        fail("index not freed");
+    }
+
+    // Repeated keys can't be indexed.
+    fields[1].key = fields[0].key;
+    if (ltv_schema_index(&schema) || schema.matcher != NULL) {
+        fail("repeated keys indexed");
+    }
+}
+
+// Encode {key: value} with 'value' written by 'fn', and decode it.
+int decode_one(const char *key, void (*fn)(ltv_encoder_t*)) {
+    ltv_encoder_t e;
+    ltv_decoder_t d;
+    device_t out;
+
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_struct_start(&e);
+    ltv_string(&e, key);
+    fn(&e);
+    ltv_struct_end(&e);
+
+    ltv_decoder_init(&d, buf, e.offset);
+    return ltv_schema_decode(&d, &device_schema, &out);
+}
+
+static void write_long_string(ltv_encoder_t *e) { ltv_string(e, "0123456789abcdef"); }
+static void write_string(ltv_encoder_t *e) { ltv_string(e, "7"); }
+static void write_u16_300(ltv_encoder_t *e) { ltv_u16(e, 300); }
+static void write_i8_neg(ltv_encoder_t *e) { ltv_i8(e, -1); }
+static void write_u32_big(ltv_encoder_t *e) { ltv_u32(e, 0x80000000u); }
+static void write_f64_huge(ltv_encoder_t *e) { ltv_f64(e, 1e300); }
+static void write_f32(ltv_encoder_t *e) { ltv_f32(e, 1.0f); }
+static void write_u8(ltv_encoder_t *e) { ltv_u8(e, 1); }
+static void write_i32_vec(ltv_encoder_t *e) { static int32_t v[2]; ltv_i32_vec(e, v, 2); }
+static void write_i16_vec_long(ltv_encoder_t *e) { static int16_t v[9]; ltv_i16_vec(e, v, 9); }
+static void write_list_long(ltv_encoder_t *e) {
+    ltv_list_start(e);
+    for (int i = 0; i < 5; i++) { ltv_struct_start(e); ltv_struct_end(e); }
+    ltv_list_end(e);
+}
+static void write_list_scalar(ltv_encoder_t *e) { ltv_list_start(e); ltv_u8(e, 1); ltv_list_end(e); }
+static void write_struct(ltv_encoder_t *e) { ltv_struct_start(e); ltv_struct_end(e); }
+
+void check_errors(void) {
+    static const struct {
+        const char *key;
+        void (*fn)(ltv_encoder_t*);
+        int status;
+    } cases[] = {
+        {"name", write_long_string, LTV_SCHEMA_RANGE},
+        {"name", write_u8, LTV_SCHEMA_TYPE_MISMATCH},
+        {"a", write_string, LTV_SCHEMA_TYPE_MISMATCH},
+        {"a", write_f32, LTV_SCHEMA_TYPE_MISMATCH},
+        {"a", write_i8_neg, LTV_SCHEMA_RANGE},
+        {"b", write_u32_big, LTV_SCHEMA_RANGE},
+        {"small", write_u16_300, LTV_SCHEMA_RANGE},
+        {"c", write_f64_huge, LTV_SCHEMA_RANGE},
+        {"c", write_string, LTV_SCHEMA_TYPE_MISMATCH},
+        {"flags", write_u8, LTV_SCHEMA_TYPE_MISMATCH},
+        {"levels", write_i32_vec, LTV_SCHEMA_TYPE_MISMATCH},
+        {"levels", write_i16_vec_long, LTV_SCHEMA_RANGE},
+        {"levels", write_u8, LTV_SCHEMA_TYPE_MISMATCH},
+        {"channels", write_list_long, LTV_SCHEMA_RANGE},
+        {"channels", write_list_scalar, LTV_SCHEMA_TYPE_MISMATCH},
+        {"channels", write_struct, LTV_SCHEMA_TYPE_MISMATCH},
+        {"primary", write_u8, LTV_SCHEMA_TYPE_MISMATCH},
+        {"primary", write_struct, LTV_SUCCESS},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int status = decode_one(cases[i].key, cases[i].fn);
+        if (status != cases[i].status) {
+            printf("case %zu (%s): expected %d, got %d\n", i, cases[i].key, cases[i].status, status);
+            exit(1);
+        }
+    }
+
+    // Not a struct
+    ltv_encoder_t e;
+    ltv_decoder_t d;
+    device_t out;
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_u8(&e, 1);
+    ltv_decoder_init(&d, buf, e.offset);
+    if (ltv_schema_decode(&d, &device_schema, &out) != LTV_SCHEMA_TYPE_MISMATCH) {
+        fail("non-struct accepted");
+    }
+
+    // Decoder errors are passed on.
+    device_t dev;
+    make_device(&dev);
+    ltv_encoder_init_memory(&e, buf, sizeof(buf));
+    ltv_schema_encode(&e, &device_schema, &dev);
+    for (size_t len = 0; len < e.offset; len++) {
+        ltv_decoder_init(&d, buf, len);
+        int status = ltv_schema_decode(&d, &device_schema, &out);
+        if (status != LTV_DECODE_UNEXPECTED_EOF && !(len == 0 && status == LTV_DECODE_EOF)) {
+            printf("truncated at %zu: %d\n", len, status);
+            exit(1);
+        }
+    }
+}
+
+int main() {
+    device_t dev;
+    make_device(&dev);
+
+    check_encode(&dev);
+    check_round_trip(&dev);
+    check_loose(&device_schema);
+    check_index();
+
+    // The same with an index, which the nested channel schema doesn't have.
+    ltv_schema_t indexed = device_schema;
+    if (!ltv_schema_index(&indexed)) {
+        fail("index failed");
+    }
+    check_loose(&indexed);
+    ltv_schema_index_free(&indexed);
+    check_errors();
+
+    printf("Schema tests finished successfully\n");
+    return 0;
+}
@@ -0,0 +1,192 @@
+// Tests for decoder UTF-8 validation. Strings of every length around the
+// vector block sizes are checked against a simple reference decoder, with
+// valid text, single byte corruptions and random bytes.
+//
+#include "litevectors.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_LEN 300
+
+static uint8_t buf[MAX_LEN + 16];
+
+// Reference: decode one code point at a time.
+bool reference_valid(const uint8_t *s, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        uint32_t c = s[i];
+        size_t n;
+        uint32_t min;
+        if (c < 0x80) { i++; continue; }
+        else if ((c & 0xE0) == 0xC0) { n = 1; min = 0x80; c &= 0x1F; }
+        else if ((c & 0xF0) == 0xE0) { n = 2; min = 0x800; c &= 0x0F; }
+        else if ((c & 0xF8) == 0xF0) { n = 3; min = 0x10000; c &= 0x07; }
+        else return false;
+
+        if (len - i <= n) return false;
+        for (size_t k = 1; k <= n; k++) {
+            if ((s[i + k] & 0xC0) != 0x80) return false;
+            c = (c << 6) | (s[i + k] & 0x3F);
+        }
+        if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) return false;
+        i += n + 1;
+    }
+    return true;
+}
+
+// Validate a string by decoding it.
+bool decoder_valid(const uint8_t *s, size_t len) {
+    static uint8_t out[MAX_LEN + 16];
+    ltv_encoder_t e;
+    ltv_decoder_t d;
+    ltv_data_t data;
+
+    ltv_encoder_init_memory(&e, out, sizeof(out));
+    ltv_string_n(&e, (const char*)s, len);
+    ltv_decoder_init(&d, out, e.offset);
+
+    int status = ltv_next(&d, &data);
+    if (status != LTV_SUCCESS && status != LTV_DECODE_INVALID_UTF8) {
+        printf("unexpected decode status %d\n", status);
+        exit(1);
+    }
+    return status == LTV_SUCCESS;
+}
+
+void check(const uint8_t *s, size_t len, const char *what) {
+    bool expected = reference_valid(s, len);
+    if (decoder_valid(s, len) != expected) {
+        printf("UTF-8 validation mismatch (%s, length %zu, expected %d):", what, len, expected);
+        for (size_t i = 0; i < len; i++) {
+            printf(" %02x", s[i]);
+        }
+        printf("\n");
+        exit(1);
+    }
+}
+
+// Append a code point, returning the new length (or len if it doesn't fit).
+size_t put_code_point(uint8_t *s, size_t len, size_t cap, uint32_t c) {
+    uint8_t tmp[4];
+    size_t n;
+    if (c < 0x80) { tmp[0] = c; n = 1; }
+    else if (c < 0x800) { tmp[0] = 0xC0 | (c >> 6); tmp[1] = 0x80 | (c & 0x3F); n = 2; }
+    else if (c < 0x10000) { tmp[0] = 0xE0 | (c >> 12); tmp[1] = 0x80 | ((c >> 6) & 0x3F); tmp[2] = 0x80 | (c & 0x3F); n = 3; }
+    else { tmp[0] = 0xF0 | (c >> 18); tmp[1] = 0x80 | ((c >> 12) & 0x3F); tmp[2] = 0x80 | ((c >> 6) & 0x3F); tmp[3] = 0x80 | (c & 0x3F); n = 4; }
+    if (len + n > cap) {
+        return len;
+    }
+    memcpy(&s[len], tmp, n);
+    return len + n;
+}
+
+// Random valid code point, weighted towards boundaries and ASCII runs.
+uint32_t random_code_point(void) {
+    static const uint32_t edges[] = {0x7F, 0x80, 0x7FF, 0x800, 0xD7FF, 0xE000, 0xFFFF, 0x10000, 0x10FFFF};
+    switch (rand() % 6) {
+        case 0: return edges[rand() % (sizeof(edges) / sizeof(edges[0]))];
+        case 1: return 0x800 + rand() % (0xD800 - 0x800);
+        case 2: return 0x10000 + rand() % 0x100000;
+        default: return rand() % 0x80;
+    }
+}
+
+// Decode {key: value} with a validation policy, returning the first error.
+int decode_pair(const char *key, const char *value, uint8_t validation) {
+    static uint8_t out[64];
+    ltv_encoder_t e;
+    ltv_decoder_t d;
+    ltv_data_t data;
+    int status;
+
+    ltv_encoder_init_memory(&e, out, sizeof(out));
+    ltv_struct_start(&e);
+    ltv_string(&e, key);
+    ltv_string(&e, value);
+    ltv_struct_end(&e);
+
+    ltv_decoder_init_validation(&d, out, e.offset, validation);
+    while ((status = ltv_next(&d, &data)) == LTV_SUCCESS);
+    return status == LTV_DECODE_EOF ? LTV_SUCCESS : status;
+}
+
+// Which strings each validation policy checks while decoding.
+void validate_policies(void) {
+    static const struct {
+        uint8_t validation;
+        int bad_key;
+        int bad_value;
+    } cases[] = {
+        {LTV_VALIDATE_FULL, LTV_DECODE_INVALID_UTF8, LTV_DECODE_INVALID_UTF8},
+        {LTV_VALIDATE_KEYS, LTV_DECODE_INVALID_UTF8, LTV_SUCCESS},
+        {LTV_VALIDATE_DEFERRED, LTV_SUCCESS, LTV_SUCCESS},
+        {LTV_VALIDATE_TRUSTED, LTV_SUCCESS, LTV_SUCCESS},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (decode_pair("ok", "fine", cases[i].validation) != LTV_SUCCESS ||
+            decode_pair("bad\xC0", "fine", cases[i].validation) != cases[i].bad_key ||
+            decode_pair("ok", "bad\xC0", cases[i].validation) != cases[i].bad_value) {
+            printf("validation policy %d mismatch\n", cases[i].validation);
+            exit(1);
+        }
+    }
+}
+
+int main() {
+    srand(1234);
+
+    for (int iter = 0; iter < 4000; iter++) {
+        size_t cap = rand() % MAX_LEN;
+        size_t len = 0;
+        while (len < cap) {
+            size_t next = put_code_point(buf, len, cap, random_code_point());
+            if (next == len) break;
+            len = next;
+        }
+        check(buf, len, "valid");
+
+        // Corrupt one byte, anywhere including block boundaries.
+        if (len > 0) {
+            static const uint8_t bad[] = {0x80, 0xBF, 0xC0, 0xC1, 0xE0, 0xED, 0xF0, 0xF4, 0xF5, 0xFF, 0x00, 'a'};
+            size_t pos = rand() % len;
+            buf[pos] = bad[rand() % sizeof(bad)];
+            check(buf, len, "corrupt");
+        }
+
+        // Truncate in the middle of a character.
+        if (len > 1) {
+            check(buf, len - 1, "truncated");
+        }
+
+        // Random bytes, mostly ASCII.
+        for (size_t i = 0; i < cap; i++) {
+            buf[i] = rand() % 8 == 0 ? rand() : rand() % 0x80;
+        }
+        check(buf, cap, "random");
+    }
+
+    // A lead byte at every position of a long ASCII string, with and without
+    // its continuation bytes.
+    static const uint8_t seqs[][4] = {
+        {0xC3, 0xA9}, {0xE2, 0x82, 0xAC}, {0xF0, 0x9F, 0x98, 0x80}, {0xED, 0xA0, 0x80}, {0xF4, 0x90, 0x80, 0x80}
+    };
+    for (size_t s = 0; s < sizeof(seqs) / sizeof(seqs[0]); s++) {
+        size_t n = seqs[s][3] ? 4 : seqs[s][2] ? 3 : 2;
+        for (size_t pos = 0; pos + n <= 100; pos++) {
+            for (size_t drop = 0; drop < n; drop++) {
+                memset(buf, 'x', 100);
+                memcpy(&buf[pos], seqs[s], n - drop);
+                check(buf, 100, "positioned");
+                check(buf, pos + n - drop, "at end");
+            }
+        }
+    }
+
+    validate_policies();
+
+    printf("UTF-8 tests finished successfully\n");
+    return 0;
+}
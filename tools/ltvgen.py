@@ -0,0 +1,485 @@
+# Generate specialized LiteVectors encoders and decoders from a schema file.
+#
+#     python3 ltvgen.py mydata.ltvs -o mydata_gen
+#
+# writes mydata_gen.h (the C structs and prototypes) and mydata_gen.c. A
+# schema file holds struct definitions:
+#
+#     # Comments run to the end of the line
+#     struct Channel {
+#         u8 id;
+#         f32 gain;
+#         bool enabled = "Enabled";   # key differs from the member name
+#         f32 size = "Größe";         # any UTF-8; \" and \\ are escapes
+#     }
+#
+#     struct Device {
+#         string name[32];            # char array, NUL terminated
+#         i16 levels[8];              # array, encoded as a vector
+#         Channel primary;            # nested struct
+#         Channel channels[4];        # array of structs, encoded as a list
+#     }
+#
+# Types are bool, u8, u16, u32, u64, i8, i16, i32, i64, f32, f64, string and
+# previously defined structs. For each struct Name the generated code has
+#
+#     void Name_encode(ltv_encoder_t *e, const Name *v);
+#     int Name_decode(ltv_decoder_t *d, Name *v);
+#
+# which produce and accept the same data as ltv_schema_encode and
+# ltv_schema_decode (litevectors_schema.h) with the equivalent field table,
+# with the same status codes. The code is straight-line per field: keys are
+# pre-encoded constants, incoming keys are matched with a switch on length
+# and a distinguishing byte, and only the range checks that a value type can
+# actually fail are generated.
+
+import argparse
+import re
+import sys
+from pathlib import Path
+
+# name: (C type, LTV type code, encoder function, min, max)
+NUMBERS = {
+    "bool": ("bool", "LTV_BOOL", "ltv_bool", None, None),
+    "u8": ("uint8_t", "LTV_U8", "ltv_u8", 0, 2**8 - 1),
+    "u16": ("uint16_t", "LTV_U16", "ltv_u16", 0, 2**16 - 1),
+    "u32": ("uint32_t", "LTV_U32", "ltv_u32", 0, 2**32 - 1),
+    "u64": ("uint64_t", "LTV_U64", "ltv_u64", 0, 2**64 - 1),
+    "i8": ("int8_t", "LTV_I8", "ltv_i8", -2**7, 2**7 - 1),
+    "i16": ("int16_t", "LTV_I16", "ltv_i16", -2**15, 2**15 - 1),
+    "i32": ("int32_t", "LTV_I32", "ltv_i32", -2**31, 2**31 - 1),
+    "i64": ("int64_t", "LTV_I64", "ltv_i64", -2**63, 2**63 - 1),
+    "f32": ("float", "LTV_F32", "ltv_f32", None, None),
+    "f64": ("double", "LTV_F64", "ltv_f64", None, None),
+}
+
+INTEGERS = [t for t in NUMBERS if t[0] in "ui"]
+
+KEY_MAX_LEN = 62
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, type_name, name, count, key, line):
+        self.type_name = type_name
+        self.name = name
+        self.count = count
+        self.key = key
+        self.line = line
+
+
+class Struct:
+    def __init__(self, name):
+        self.name = name
+        self.fields = []
+
+
+TOKEN = re.compile(r'\s*(?:(#.*)|([A-Za-z_]\w*)|(\d+)|("(?:[^"\\]|\\.)*")|(\S))', re.ASCII)
+
+
+def unquote(token, line):
+    """The text of a string token, with its \\" and \\\\ escapes replaced."""
+    def escape(m):
+        if m.group(1) not in '"\\':
+            raise SchemaError("line %d: unknown escape \\%s in %s" % (line, m.group(1), token))
+        return m.group(1)
+    return re.sub(r'\\(.)', escape, token[1:-1])
+
+
+def tokenize(text):
+    for line, source in enumerate(text.splitlines(), 1):
+        for m in TOKEN.finditer(source):
+            for kind, value in zip(("name", "number", "string", "punct"), m.groups()[1:]):
+                if value is not None:
+                    yield kind, value, line
+
+
+def parse(text):
+    tokens = list(tokenize(text))
+    pos = 0
+    structs = []
+    by_name = {}
+
+    def peek():
+        return tokens[pos][1] if pos < len(tokens) else None
+
+    def next_token(expected_kind=None, expected_value=None):
+        nonlocal pos
+        if pos == len(tokens):
+            raise SchemaError("unexpected end of schema")
+        kind, value, line = tokens[pos]
+        if (expected_kind and kind != expected_kind) or (expected_value and value != expected_value):
+            raise SchemaError("line %d: expected %s, found '%s'" % (line, expected_value or expected_kind, value))
+        pos += 1
+        return value, line
+
+    while pos < len(tokens):
+        next_token("name", "struct")
+        name, line = next_token("name")
+        if name in by_name or name in NUMBERS or name == "string":
+            raise SchemaError("line %d: struct %s is already defined" % (line, name))
+        s = Struct(name)
+        next_token("punct", "{")
+
+        while peek() not in ("}", None):
+            type_name, line = next_token("name")
+            if type_name not in NUMBERS and type_name != "string" and type_name not in by_name:
+                raise SchemaError("line %d: unknown type %s" % (line, type_name))
+            field_name, _ = next_token("name")
+            count = 0
+            if peek() == "[":
+                next_token()
+                count = int(next_token("number")[0])
+                next_token("punct", "]")
+                if count == 0:
+                    raise SchemaError("line %d: %s has no elements" % (line, field_name))
+            if type_name == "string" and count == 0:
+                raise SchemaError("line %d: string %s needs a size" % (line, field_name))
+            key = field_name
+            if peek() == "=":
+                next_token()
+                key = unquote(*next_token("string"))
+            next_token("punct", ";")
+
+            if len(key.encode()) > KEY_MAX_LEN:
+                raise SchemaError("line %d: key '%s' is longer than %d bytes" % (line, key, KEY_MAX_LEN))
+            if any(f.name == field_name for f in s.fields):
+                raise SchemaError("line %d: %s is already a member of %s" % (line, field_name, name))
+            if any(f.key == key for f in s.fields):
+                raise SchemaError("line %d: key '%s' is already used in %s" % (line, key, name))
+            s.fields.append(Field(type_name, field_name, count, key, line))
+
+        next_token("punct", "}")
+        if not s.fields:
+            raise SchemaError("line %d: struct %s has no members" % (line, name))
+        structs.append(s)
+        by_name[name] = s
+
+    return structs
+
+
+def c_string(s):
+    out = '"'
+    for b in s.encode():
+        if b in (0x22, 0x5C):
+            out += "\\" + chr(b)
+        elif 0x20 <= b < 0x7F and chr(b) != "?":
+            out += chr(b)
+        else:
+            out += '\\%03o' % b
+    return out + '"'
+
+
+class Writer:
+    def __init__(self):
+        self.lines = []
+        self.depth = 0
+
+    def __call__(self, text=""):
+        self.lines.append(("    " * self.depth + text) if text else "")
+
+    def indent(self):
+        self.depth += 1
+
+    def dedent(self):
+        self.depth -= 1
+
+    def text(self):
+        return "\n".join(self.lines) + "\n"
+
+
+def c_limit(value):
+    if value == 2**64 - 1:
+        return "UINT64_MAX"
+    if value == -2**63:
+        return "INT64_MIN"
+    if value == 2**63 - 1:
+        return "INT64_MAX"
+    return str(value) + ("u" if value > 2**31 - 1 else "")
+
+
+def gen_store_number(w, f, target):
+    """Checks and store of a single number in 'target', from 'x'."""
+    c_type, code, _, lo, hi = NUMBERS[f.type_name]
+    w("if (x.size_code != LTV_SINGLE) return LTV_SCHEMA_TYPE_MISMATCH;")
+
+    if f.type_name == "bool":
+        w("if (x.type_code != LTV_BOOL) return LTV_SCHEMA_TYPE_MISMATCH;")
+        w("%s = x.val.v_uint != 0;" % target)
+        return
+
+    w("switch (x.type_code) {")
+    w.indent()
+    if f.type_name in ("f32", "f64"):
+        if f.type_name == "f64":
+            w("case LTV_F32: %s = x.val.v_float32; break;" % target)
+            w("case LTV_F64: %s = x.val.v_float64; break;" % target)
+        else:
+            w("case LTV_F32: %s = x.val.v_float32; break;" % target)
+            w("case LTV_F64:")
+            w.indent()
+            w("if ((x.val.v_float64 > FLT_MAX || x.val.v_float64 < -FLT_MAX) && !isinf(x.val.v_float64)) return LTV_SCHEMA_RANGE;")
+            w("%s = (float)x.val.v_float64;" % target)
+            w("break;")
+            w.dedent()
+        unsigned = [t for t in INTEGERS if t[0] == "u"]
+        signed = [t for t in INTEGERS if t[0] == "i"]
+        via = "(float)(double)" if f.type_name == "f32" else "(double)"
+        w(" ".join("case %s:" % NUMBERS[t][1] for t in unsigned) + " %s = %sx.val.v_uint; break;" % (target, via))
+        w(" ".join("case %s:" % NUMBERS[t][1] for t in signed) + " %s = %sx.val.v_int; break;" % (target, via))
+    else:
+        # Group source types by the checks they need.
+        groups = {}
+        for t in INTEGERS:
+            _, src_code, _, src_lo, src_hi = NUMBERS[t]
+            is_signed = t[0] == "i"
+            checks = []
+            value = "x.val.v_int" if is_signed else "x.val.v_uint"
+            if src_lo < lo:
+                checks.append("%s < %s" % (value, c_limit(lo)))
+            if src_hi > hi:
+                checks.append("%s > %s" % (value, c_limit(hi)))
+            groups.setdefault((value, tuple(checks)), []).append(src_code)
+        for (value, checks), codes in groups.items():
+            cases = " ".join("case %s:" % c for c in codes)
+            if checks:
+                w(cases)
+                w.indent()
+                w("if (%s) return LTV_SCHEMA_RANGE;" % " || ".join(checks))
+                w("%s = (%s)%s;" % (target, c_type, value))
+                w("break;")
+                w.dedent()
+            else:
+                w("%s %s = (%s)%s; break;" % (cases, target, c_type, value))
+    w("default: return LTV_SCHEMA_TYPE_MISMATCH;")
+    w.dedent()
+    w("}")
+
+
+def gen_decode_field(w, s, f):
+    """Decode the value for field 'f' into v->name."""
+    target = "v->" + f.name
+    w("if ((status = ltv_next(d, &x)) != LTV_SUCCESS) return status;")
+
+    if f.type_name == "string":
+        w("if (x.type_code != LTV_STRING) return LTV_SCHEMA_TYPE_MISMATCH;")
+        w("if (x.length >= %d) return LTV_SCHEMA_RANGE;" % f.count)
+        w("memcpy(%s, x.val.v_buffer, x.length);" % target)
+        w("%s[x.length] = 0;" % target)
+    elif f.type_name in NUMBERS and f.count > 0:
+        w("if (x.type_code != %s || x.size_code == LTV_SINGLE) return LTV_SCHEMA_TYPE_MISMATCH;" % NUMBERS[f.type_name][1])
+        w("if (x.length > sizeof(%s)) return LTV_SCHEMA_RANGE;" % target)
+        if f.type_name == "bool":
+            w("for (size_t n = 0; n < x.length; n++) %s[n] = x.val.v_buffer[n] != 0;" % target)
+        else:
+            w("memcpy(%s, x.val.v_buffer, x.length);" % target)
+    elif f.type_name in NUMBERS:
+        gen_store_number(w, f, target)
+    elif f.count == 0:
+        w("if (x.type_code != LTV_STRUCT) return LTV_SCHEMA_TYPE_MISMATCH;")
+        w("if ((status = %s_decode_fields(d, &%s)) != LTV_SUCCESS) return status;" % (f.type_name, target))
+    else:
+        w("if (x.type_code != LTV_LIST) return LTV_SCHEMA_TYPE_MISMATCH;")
+        w("for (size_t n = 0; ; n++) {")
+        w.indent()
+        w("if ((status = ltv_next(d, &x)) != LTV_SUCCESS) return status;")
+        w("if (x.type_code == LTV_END) break;")
+        w("if (n == %d) return LTV_SCHEMA_RANGE;" % f.count)
+        w("if (x.type_code != LTV_STRUCT) return LTV_SCHEMA_TYPE_MISMATCH;")
+        w("if ((status = %s_decode_fields(d, &%s[n])) != LTV_SUCCESS) return status;" % (f.type_name, target))
+        w.dedent()
+        w("}")
+    w("continue;")
+
+
+def c_char(byte):
+    if 0x20 <= byte < 0x7F and chr(byte) not in "'\\":
+        return "'%s'" % chr(byte)
+    return str(byte)
+
+
+def gen_key_match(w, s, fields, checked=()):
+    """Match 'key' (of a length shared by 'fields') and decode the value.
+    The bytes at the 'checked' positions are already known to match."""
+    if len(fields) == 1:
+        f = fields[0]
+        key = f.key.encode()
+        if len(checked) == len(key):
+            w("{")
+        else:
+            w("if (memcmp(key, %s, %d) == 0) {" % (c_string(f.key), len(key)))
+        w.indent()
+        gen_decode_field(w, s, f)
+        w.dedent()
+        w("}")
+        return
+
+    # Switch on the byte that splits the keys into the most groups.
+    keys = [f.key.encode() for f in fields]
+    best = max(range(len(keys[0])), key=lambda i: len(set(k[i] for k in keys)))
+    w("switch (key[%d]) {" % best)
+    groups = {}
+    for f, k in zip(fields, keys):
+        groups.setdefault(k[best], []).append(f)
+    for byte, group in sorted(groups.items()):
+        w("case %s:" % c_char(byte))
+        w.indent()
+        gen_key_match(w, s, group, checked + (best,))
+        w("break;")
+        w.dedent()
+    w("}")
+
+
+def generate(structs, schema_name, base_name):
+    guard = "_" + re.sub(r"\W", "_", base_name).upper() + "_H"
+    h = Writer()
+    h("// Generated by tools/ltvgen.py from %s. Do not edit." % schema_name)
+    h("#ifndef %s" % guard)
+    h("#define %s" % guard)
+    h()
+    h('#include "litevectors.h"')
+    h('#include "litevectors_schema.h"')
+    h()
+    for s in structs:
+        h("typedef struct %s {" % s.name)
+        h.indent()
+        for f in s.fields:
+            if f.type_name == "string":
+                h("char %s[%d];" % (f.name, f.count))
+            else:
+                c_type = NUMBERS[f.type_name][0] if f.type_name in NUMBERS else f.type_name
+                h("%s %s%s;" % (c_type, f.name, "[%d]" % f.count if f.count else ""))
+        h.dedent()
+        h("} %s;" % s.name)
+        h()
+    for s in structs:
+        h("void %s_encode(ltv_encoder_t *e, const %s *v);" % (s.name, s.name))
+        h("int %s_decode(ltv_decoder_t *d, %s *v);" % (s.name, s.name))
+        h()
+    h("#endif //%s" % guard)
+
+    c = Writer()
+    c("// Generated by tools/ltvgen.py from %s. Do not edit." % schema_name)
+    c('#include "%s.h"' % Path(base_name).name)
+    c()
+    c("#include <string.h>")
+    c("#include <float.h>")
+    c("#include <math.h>")
+    c()
+    for s in structs:
+        for f in s.fields:
+            c("static const ltv_key_t %s_key_%s = LTV_KEY(%s);" % (s.name, f.name, c_string(f.key)))
+    c()
+    if any(f.type_name == "string" for s in structs for f in s.fields):
+        c("// Length of a string in a char array that may fill it.")
+        c("static size_t ltvgen_strlen(const char *s, size_t size) {")
+        c("    const char *end = memchr(s, 0, size);")
+        c("    return end != NULL ? (size_t)(end - s) : size;")
+        c("}")
+        c()
+    for s in structs:
+        c("static int %s_decode_fields(ltv_decoder_t *d, %s *v);" % (s.name, s.name))
+    c()
+
+    for s in structs:
+        c("void %s_encode(ltv_encoder_t *e, const %s *v) {" % (s.name, s.name))
+        c.indent()
+        c("ltv_struct_start(e);")
+        for f in s.fields:
+            c("ltv_key(e, &%s_key_%s);" % (s.name, f.name))
+            target = "v->" + f.name
+            if f.type_name == "string":
+                c("ltv_string_n(e, %s, ltvgen_strlen(%s, %d));" % (target, target, f.count))
+            elif f.type_name in NUMBERS and f.count > 0:
+                c_type, _, fn, _, _ = NUMBERS[f.type_name]
+                c("%s_vec(e, (%s*)%s, %d);" % (fn, c_type, target, f.count))
+            elif f.type_name in NUMBERS:
+                c("%s(e, %s);" % (NUMBERS[f.type_name][2], target))
+            elif f.count == 0:
+                c("%s_encode(e, &%s);" % (f.type_name, target))
+            else:
+                c("ltv_list_start(e);")
+                c("for (size_t n = 0; n < %d; n++) {" % f.count)
+                c("    %s_encode(e, &%s[n]);" % (f.type_name, target))
+                c("}")
+                c("ltv_list_end(e);")
+        c("ltv_struct_end(e);")
+        c.dedent()
+        c("}")
+        c()
+
+        c("static int %s_decode_fields(ltv_decoder_t *d, %s *v) {" % (s.name, s.name))
+        c.indent()
+        c("ltv_data_t k, x;")
+        c("int status;")
+        c()
+        c("for (;;) {")
+        c.indent()
+        c("if ((status = ltv_next(d, &k)) != LTV_SUCCESS) return status;")
+        c("if (k.type_code == LTV_END) return LTV_SUCCESS;")
+        c()
+        by_len = {}
+        for f in s.fields:
+            by_len.setdefault(len(f.key.encode()), []).append(f)
+        if by_len:
+            c("if (k.type_code == LTV_STRING) {")
+            c.indent()
+            c("const uint8_t *key = k.val.v_buffer;")
+            c("switch (k.length) {")
+            for length, fields in sorted(by_len.items()):
+                c("case %d:" % length)
+                c.indent()
+                gen_key_match(c, s, fields)
+                c("break;")
+                c.dedent()
+            c("}")
+            c.dedent()
+            c("}")
+            c()
+        c("// Not a member: step over the value.")
+        c("if ((status = ltv_skip(d)) != LTV_SUCCESS) {")
+        c("    return status == LTV_DECODE_EOF ? LTV_DECODE_UNEXPECTED_EOF : status;")
+        c("}")
+        c.dedent()
+        c("}")
+        c.dedent()
+        c("}")
+        c()
+
+        c("int %s_decode(ltv_decoder_t *d, %s *v) {" % (s.name, s.name))
+        c("    ltv_data_t x;")
+        c("    int status = ltv_next(d, &x);")
+        c("    if (status != LTV_SUCCESS) return status;")
+        c("    if (x.type_code != LTV_STRUCT) return LTV_SCHEMA_TYPE_MISMATCH;")
+        c("    return %s_decode_fields(d, v);" % s.name)
+        c("}")
+        c()
+
+    return h.text(), c.text().rstrip("\n") + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate LiteVectors encoders and decoders from a schema.")
+    parser.add_argument("schema", help="schema file")
+    parser.add_argument("-o", "--output", help="output base name (default: schema name + _gen)")
+    args = parser.parse_args()
+
+    schema_path = Path(args.schema)
+    base = args.output or str(schema_path.with_suffix("")) + "_gen"
+    try:
+        structs = parse(schema_path.read_text(encoding="utf-8"))
+    except SchemaError as e:
+        print("%s: %s" % (schema_path, e), file=sys.stderr)
+        return 1
+
+    header, source = generate(structs, schema_path.name, base)
+    Path(base + ".h").write_text(header)
+    Path(base + ".c").write_text(source)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())